@@ -2,6 +2,11 @@
 #define APP_MQTT_CLIENT_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "heart_rate.h"
+#include "hr_session.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -13,8 +18,26 @@ void mqtt_init(void);
 // Publish heart rate BPM value
 bool mqtt_publish_heart_rate(int bpm);
 
-// Publish workout JSON data from BLE
-bool mqtt_publish_workout_data(const char* json_data);
+// Publish rolling HRV metrics plus the RR intervals since the last call
+bool mqtt_publish_hrv(const heart_rate_hrv_t *hrv, const heart_rate_rr_t *rr, size_t rr_count);
+
+// Publish signal quality alongside the BPM it qualifies
+bool mqtt_publish_quality(const heart_rate_quality_t *quality, int bpm);
+
+// Publish one binary waveform frame (heart_rate_wave_sink_t)
+bool mqtt_publish_waveform(const uint8_t *frame, size_t len);
+
+// Publish one lap of a tracker's HR timeline (index of count laps in its
+// workout) to pulsetracker/hrTimeline/<peer>
+bool mqtt_publish_hr_timeline(const char *peer, const hr_lap_timeline_t *lap, size_t index,
+                              size_t count);
+
+// Publish workout JSON data from one tracker to pulsetracker/workout/<peer>
+// (len bytes, need not be NUL-terminated)
+bool mqtt_publish_workout_data(const char *peer, const char* json_data, size_t len);
+
+// Publish a BLE link telemetry snapshot (ble_telemetry_json) to pulsetracker/diag
+bool mqtt_publish_diag(const char *json, size_t len);
 
 // Get current mode string
 const char* mqtt_get_mode(void);
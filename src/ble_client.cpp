@@ -1,11 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <atomic>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 // NimBLE includes
 #include "nimble/nimble_port.h"
@@ -16,8 +19,18 @@
 
 #include "ble_client.h"
 #include "app_mqtt.h"
+#include "ble_conn_policy.h"
+#include "ble_frag.h"
+#include "ble_gatt_cache.h"
+#include "ble_telemetry.h"
 #include "hr_session.h"
 #include "led.h"
+#include "workout_codec.h"
+#include "workout_event.h"
+
+#if defined(CONFIG_BT_NIMBLE_MAX_CONNECTIONS) && CONFIG_BT_NIMBLE_MAX_CONNECTIONS < BLE_MAX_PEERS
+#error "CONFIG_BT_NIMBLE_MAX_CONNECTIONS must allow BLE_MAX_PEERS connections"
+#endif
 
 static const char *TAG = "BLE_CLIENT";
 
@@ -36,28 +49,187 @@ static const ble_uuid128_t rx_char_uuid =
 
 #define TARGET_DEVICE_NAME "MAX32655"
 
-// Connection state
-static uint16_t conn_handle = BLE_HS_CONN_HANDLE_NONE;
-static uint16_t tx_char_handle = 0;
-static uint16_t tx_char_def_handle = 0;
-static uint16_t tx_cccd_handle = 0;
-static uint16_t rx_char_handle = 0;
-static uint16_t rx_char_def_handle = 0;
-static uint16_t service_start_handle = 0;
-static uint16_t service_end_handle = 0;
-static bool connected = false;
-static bool service_discovered = false;
-static bool mtu_exchanged = false;
+// Finding trackers: a directed connect to each known address not yet
+// connected, then a scan that only reports those addresses, then a scan
+// by name. Once a tracker is connected the scans run at a low duty cycle
+// so they do not starve its link.
+#define DIRECT_CONNECT_MS  2000
+#define ACCEPT_SCAN_MS     4000
+#define NAME_SCAN_MS      30000
+
+// A stage that cannot start (controller busy, out of memory) is retried
+// from the host task after a backoff that doubles up to the cap
+#define FIND_RETRY_MS        500
+#define FIND_RETRY_MAX_MS  16000
+
+// A cycle through every stage that found nobody waits before the next,
+// longer each time, so a tracker that stays away does not keep the radio
+// busy; a connection or a link loss starts over from the shortest pause
+#define FIND_PAUSE_MS       1000
+#define FIND_PAUSE_MAX_MS  60000
+
+typedef enum {
+    FIND_DIRECT,
+    FIND_ACCEPT_LIST,
+    FIND_NAME,
+    FIND_STAGES
+} find_stage_t;
+
+static const char *const find_stage_names[FIND_STAGES] = {
+    "direct connect", "accept-list scan", "name scan"
+};
+
+typedef enum {
+    FIND_IDLE,          // All slots in use, or between stages
+    FIND_SCANNING,
+    FIND_CONNECTING
+} find_state_t;
+
+#define FRAG_RX_BUF_LEN   2048
+#define TX_QUEUE_LEN      8     // Outbound messages, all trackers together
+
+// One connected tracker. The host task owns the connection and GATT
+// fields; atomics are read by the workers and senders. Each worker keeps
+// its own section. generation is bumped on every connect, so work queued
+// for an earlier connection in the same slot can be recognised and dropped.
+typedef struct {
+    bool connected;
+    uint16_t conn_handle;
+    ble_gatt_handles_t handles;     // In use
+    ble_gatt_handles_t disc;        // Found by the discovery in progress
+    bool service_discovered;
+    bool mtu_exchanged;
+    bool cache_hit;                 // Subscribed straight from cached handles
+    bool validating;                // Discovery re-checking a cache hit
+    ble_addr_t id_addr;             // GATT cache key
+    ble_addr_t ota_addr;            // What we connect to
+    char name[8];                   // Last three address bytes, for logs and topics
+    int64_t connect_us;
+    bool first_notify_pending;
+
+    // Set once the MAX accepts our binary codec / fragmentation offer
+    std::atomic<bool> binary;
+    std::atomic<bool> frag;
+    // Negotiated ATT MTU; a write carries at most MTU - 3 bytes
+    std::atomic<uint16_t> mtu;
+    // Connection interval, the pace at which the controller frees TX buffers
+    std::atomic<uint16_t> itvl_ms;
+    std::atomic<uint32_t> generation;
+    // Connection update results, counted so the RX worker sees new ones
+    std::atomic<uint32_t> update_results;
+    std::atomic<int> update_status;
+    // A write request is waiting for its response; set by the TX worker,
+    // cleared by the host task on the response or the disconnect
+    std::atomic<bool> att_pending;
+    // The response, tagged with the request's sequence number
+    std::atomic<uint32_t> ack_done;
+    std::atomic<int> ack_status;
+
+    // RX worker
+    ble_frag_rx_t frag_rx;
+    uint8_t frag_rx_buf[FRAG_RX_BUF_LEN];
+    uint32_t rx_generation;
+    ble_conn_policy_t policy;
+    uint32_t policy_results_seen;
+    uint32_t rx_count;              // Notifications since the last rate log
+
+    // TX worker: this tracker's messages in order, as pool indices. The
+    // head stays queued while its write request awaits a response, or
+    // while it waits for credits part way through.
+    ble_frag_tx_t frag_tx;
+    uint32_t tx_generation;
+    uint32_t tx_credits;
+    int64_t tx_refill_us;
+    size_t tx_offset;               // Bytes of the head already written
+    int64_t tx_stall_us;            // Head out of credits, no progress since
+    uint8_t tx_fifo[TX_QUEUE_LEN];
+    uint8_t tx_fifo_head;
+    uint8_t tx_fifo_len;
+    bool tx_awaiting_ack;
+    uint32_t tx_ack_seq;
+    int64_t tx_ack_us;              // Write request issued
+    int tx_ack_attempts;            // Retries after an error response
+    int64_t tx_att_wait_us;         // Head waiting on an earlier request since
+    uint16_t tx_ack_len;
+    uint8_t tx_ack_buf[BLE_ATT_MTU_MAX]; // Write request payload, for a retry
+} ble_peer_t;
+
+static ble_peer_t peers[BLE_MAX_PEERS];
+
+// Peer finding; all on the host task
+static find_stage_t find_stage = FIND_NAME;
+static find_state_t find_state = FIND_IDLE;
+static ble_addr_t known_peers[BLE_MAX_PEERS];   // Most recent first
+static int known_count = 0;
+static int direct_next = 0;                     // Next absent known peer to try
+static struct ble_npl_callout find_retry;
+static uint32_t find_retry_ms = FIND_RETRY_MS;
+static uint32_t find_pause_ms = FIND_PAUSE_MS;
+
+// Link loss to connected again, by the stage that found the peer
+static struct {
+    ble_addr_t addr;
+    int64_t us;
+} link_lost[BLE_MAX_PEERS];
+static struct {
+    uint32_t count;
+    uint32_t total_ms;
+    uint32_t max_ms;
+} reconnect_stats[FIND_STAGES];
+
+// Connect to first notification, [0] after discovery, [1] from the cache
+static struct {
+    uint32_t count;
+    uint32_t total_ms;
+    uint32_t min_ms;
+    uint32_t max_ms;
+} first_notify[2] = { { 0, 0, UINT32_MAX, 0 }, { 0, 0, UINT32_MAX, 0 } };
+
+// Connection parameters follow each tracker's workout and notification
+// rate; the policy runs on the RX worker, which sees both
+#define POLICY_POLL_MS 1000
+
+// Link telemetry: RSSI is read on the RX worker's policy pass, and a
+// snapshot goes to MQTT at the publish interval
+#define RSSI_SAMPLE_MS       2000
+#define TELEMETRY_PUBLISH_MS 30000
+#define TELEMETRY_JSON_LEN   1536
 
 // Callback for workout data
 static ble_workout_callback_t workout_callback = NULL;
 
 // Forward declarations
 static void ble_app_scan(void);
+static void find_peer(find_stage_t stage);
 static int ble_gap_event(struct ble_gap_event *event, void *arg);
-static void exchange_mtu(void);
-static void request_conn_params_update(void);
+static void exchange_mtu(ble_peer_t *p);
+static void request_conn_profile(ble_peer_t *p, ble_conn_profile_t profile);
+static void discover_services(ble_peer_t *p);
+
+
+static uint8_t peer_index(const ble_peer_t *p)
+{
+    return (uint8_t)(p - peers);
+}
 
+static ble_peer_t *peer_by_conn(uint16_t conn_handle)
+{
+    for (int i = 0; i < BLE_MAX_PEERS; i++) {
+        if (peers[i].connected && peers[i].conn_handle == conn_handle) {
+            return &peers[i];
+        }
+    }
+    return NULL;
+}
+
+static int connected_count(void)
+{
+    int n = 0;
+    for (int i = 0; i < BLE_MAX_PEERS; i++) {
+        n += peers[i].connected ? 1 : 0;
+    }
+    return n;
+}
 
 static void format_time(uint32_t ms, char *buf, size_t buf_len)
 {
@@ -68,241 +240,1327 @@ static void format_time(uint32_t ms, char *buf, size_t buf_len)
              (unsigned long)minutes, (unsigned long)seconds, (unsigned long)millis);
 }
 
-static bool json_get_string(const char *json, const char *key, char *out, size_t out_len)
+// Messages and bytes received in each encoding, worker task only
+static struct {
+    uint32_t json;
+    uint32_t json_bytes;
+    uint32_t bin;
+    uint32_t bin_bytes;
+} rx_codec;
+
+// Green while any tracker has a workout running, red otherwise. RX
+// worker, which owns the policies.
+static void show_workout_leds(void)
+{
+    bool active = false;
+    for (int i = 0; i < BLE_MAX_PEERS; i++) {
+        active = active || peers[i].policy.workout;
+    }
+    if (active) {
+        green_led_on();
+        red_led_off();
+    } else {
+        red_led_on();
+        green_led_off();
+    }
+}
+
+// Notification payloads are parsed in place in the mbuf; workout_event
+// decodes them in one pass without needing a NUL terminator. Binary
+// frames are told apart by their first byte and re-rendered as JSON for
+// the log, the callback and MQTT.
+static void process_workout_event(ble_peer_t *p, const char *json_data, uint16_t len)
+{
+    workout_event_t ev;
+    char time_str[16] = {0};
+    char frame_json[128];
+    bool parsed;
+
+    if (workout_codec_is_frame((const uint8_t *)json_data, len)) {
+        rx_codec.bin++;
+        rx_codec.bin_bytes += len;
+        if (!workout_codec_decode((const uint8_t *)json_data, len, &ev)) {
+            ESP_LOGW(TAG, "[%s] Malformed binary frame (%d bytes)", p->name, len);
+            return;
+        }
+        int n = workout_codec_event_json(&ev, frame_json, sizeof(frame_json));
+        if (n < 0) {
+            ESP_LOGW(TAG, "[%s] Binary frame has no JSON rendering", p->name);
+            return;
+        }
+        json_data = frame_json;
+        len = n < (int)sizeof(frame_json) ? n : sizeof(frame_json) - 1;
+        parsed = true;
+    } else {
+        rx_codec.json++;
+        rx_codec.json_bytes += len;
+        parsed = workout_event_parse(json_data, len, &ev);
+    }
+
+    if (parsed && ev.type == WORKOUT_EVT_HR_REQ) {
+        int32_t lap = ev.lap;
+        uint32_t window_ms = ev.window_ms;
+        // Laps are u16 on the wire; anything else would land on another lap
+        if (lap < 0 || lap > UINT16_MAX) {
+            ESP_LOGW(TAG, "[%s] HR request for lap %ld out of range", p->name, (long)lap);
+            return;
+        }
+        ESP_LOGI(TAG, "[%s] HR request received from MAX - lap %ld (%lu ms)", p->name,
+                 (long)lap, (unsigned long)(window_ms > 0 ? window_ms : HR_SESSION_WINDOW_MS));
+        hr_session_start(peer_index(p), (uint16_t)lap, window_ms);
+        return;
+    }
+
+    if (parsed && ev.type == WORKOUT_EVT_CAPS) {
+        bool binary = strcmp(ev.codec, WORKOUT_CODEC_NAME) == 0;
+        p->binary.store(binary, std::memory_order_relaxed);
+        p->frag.store(ev.frag != 0, std::memory_order_relaxed);
+        ESP_LOGI(TAG, "[%s] MAX codec: %s, fragmentation %s", p->name,
+                 binary ? WORKOUT_CODEC_NAME : "json", ev.frag ? "on" : "off");
+        return;
+    }
+
+    ESP_LOGI(TAG, "[%s] Raw workout data (%d bytes): %.*s", p->name, len, len, json_data);
+
+    // Forward raw JSON to MQTT
+    if (workout_callback) {
+        workout_callback(peer_index(p), json_data, len);
+    }
+
+    // Also publish to MQTT directly
+    mqtt_publish_workout_data(p->name, json_data, len);
+
+    if (!parsed || ev.type == WORKOUT_EVT_NONE) {
+        ESP_LOGW(TAG, "Could not parse event type");
+        return;
+    }
+
+    printf("\n========================================\n");
+    printf("    Tracker: %s\n", p->name);
+
+    switch (ev.type) {
+    case WORKOUT_EVT_START:
+        printf(">>> WORKOUT STARTED!\n");
+        printf("    Mode: %s (%d laps)\n", ev.mode, (int)ev.laps);
+
+        hr_session_workout_begin(peer_index(p));
+        ble_conn_policy_workout(&p->policy, true);
+        show_workout_leds();
+        break;
+
+    case WORKOUT_EVT_LAP:
+        format_time(ev.lap_ms, time_str, sizeof(time_str));
+        printf(">>> LAP %d COMPLETE\n", (int)ev.lap);
+        printf("    Lap Time:   %s\n", time_str);
+
+        format_time(ev.split_ms, time_str, sizeof(time_str));
+        printf("    Split Time: %s\n", time_str);
+        break;
+
+    case WORKOUT_EVT_DONE:
+        format_time(ev.total_ms, time_str, sizeof(time_str));
+        printf(">>> WORKOUT COMPLETE!\n");
+        printf("    Total Laps: %d\n", (int)ev.laps);
+        printf("    Total Time: %s\n", time_str);
+
+        hr_session_workout_end(peer_index(p));
+        ble_conn_policy_workout(&p->policy, false);
+        show_workout_leds();
+        break;
+
+    case WORKOUT_EVT_STOP:
+        format_time(ev.total_ms, time_str, sizeof(time_str));
+        printf(">>> WORKOUT STOPPED\n");
+        printf("    Laps Completed: %d\n", (int)ev.laps);
+        printf("    Time: %s\n", time_str);
+
+        hr_session_workout_end(peer_index(p));
+        ble_conn_policy_workout(&p->policy, false);
+        show_workout_leds();
+        break;
+
+    case WORKOUT_EVT_STATUS:
+        format_time(ev.elapsed_ms, time_str, sizeof(time_str));
+        printf(">>> STATUS UPDATE\n");
+        printf("    State: %s\n", ev.state);
+        printf("    Current Lap: %d\n", (int)ev.lap);
+        printf("    Elapsed: %s\n", time_str);
+        break;
+
+    default:
+        printf(">>> Unknown Event: %s\n", ev.name);
+        break;
+    }
+
+    printf("========================================\n\n");
+}
+
+
+// Notification hand-off: the host task only parks the received mbuf in a
+// descriptor from a static pool and queues it; the worker task parses,
+// prints, drives the LEDs and publishes, then returns the descriptor
+#define RX_POOL_SIZE          8
+#define RX_WORKER_STACK_WORDS 4096
+#define RX_STATS_LOG_EVERY    32
+#define RX_RATE_LOG_MS        10000
+
+typedef struct {
+    struct os_mbuf *om;
+    uint16_t attr_handle;
+    uint8_t peer;
+    uint32_t generation;    // Of the peer's connection it arrived on
+    int64_t rx_us;          // When the host task received it
+} rx_desc_t;
+
+static rx_desc_t rx_pool[RX_POOL_SIZE];
+
+// Free descriptor indices and queued work, both sized to the whole pool
+// so a send to either can never fail for want of room
+static QueueHandle_t rx_free_queue = NULL;
+static QueueHandle_t rx_work_queue = NULL;
+static StaticQueue_t rx_free_queue_struct;
+static StaticQueue_t rx_work_queue_struct;
+static uint8_t rx_free_storage[RX_POOL_SIZE * sizeof(uint8_t)];
+static uint8_t rx_work_storage[RX_POOL_SIZE * sizeof(uint8_t)];
+static StaticTask_t rx_worker_tcb;
+static StackType_t rx_worker_stack[RX_WORKER_STACK_WORDS];
+
+// Host task side
+static struct {
+    uint32_t queued;
+    uint32_t pool_full;     // No free descriptor: notification dropped
+    uint32_t max_us;        // Longest time spent in the GAP callback
+    uint32_t stack_min;     // Host task stack high-water (bytes free)
+} rx_host_stats = { 0, 0, 0, UINT32_MAX };
+
+// Worker side
+static struct {
+    uint32_t count;
+    uint32_t in_place;      // Single mbuf, parsed where it lies
+    uint32_t pulled_up;     // Chain made contiguous inside the mbuf pool
+    uint32_t copied;        // Chain too long for one block: heap copy
+    uint32_t failed;
+    uint32_t stale;         // Queued before its peer reconnected
+    uint32_t in_use_max;    // Most descriptors outstanding at once
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t max_wait_us;   // Longest time a notification sat queued
+    uint32_t stack_min;     // Worker stack high-water (bytes free)
+} rx_stats = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, UINT32_MAX };
+
+static int64_t rx_rate_us;
+
+static void log_rx_stats(void)
+{
+    ESP_LOGI(TAG, "RX host: %lu queued, %lu dropped (pool full), %lu us max in callback, "
+                  "stack min free %lu B",
+             (unsigned long)rx_host_stats.queued, (unsigned long)rx_host_stats.pool_full,
+             (unsigned long)rx_host_stats.max_us, (unsigned long)rx_host_stats.stack_min);
+    ESP_LOGI(TAG, "RX worker: %lu notifications (%lu in place, %lu pulled up, %lu copied, "
+                  "%lu failed, %lu stale), %lu us avg, %lu us max, %lu us max queued, "
+                  "%lu/%d descriptors peak, stack min free %lu B",
+             (unsigned long)rx_stats.count, (unsigned long)rx_stats.in_place,
+             (unsigned long)rx_stats.pulled_up, (unsigned long)rx_stats.copied,
+             (unsigned long)rx_stats.failed, (unsigned long)rx_stats.stale,
+             (unsigned long)(rx_stats.total_us / rx_stats.count),
+             (unsigned long)rx_stats.max_us, (unsigned long)rx_stats.max_wait_us,
+             (unsigned long)rx_stats.in_use_max, RX_POOL_SIZE,
+             (unsigned long)rx_stats.stack_min);
+    ESP_LOGI(TAG, "RX codec: %lu json (%lu B avg), %lu binary (%lu B avg)",
+             (unsigned long)rx_codec.json,
+             (unsigned long)(rx_codec.json ? rx_codec.json_bytes / rx_codec.json : 0),
+             (unsigned long)rx_codec.bin,
+             (unsigned long)(rx_codec.bin ? rx_codec.bin_bytes / rx_codec.bin : 0));
+    for (int i = 0; i < BLE_MAX_PEERS; i++) {
+        const ble_frag_rx_t *f = &peers[i].frag_rx;
+        if (f->fragments == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "RX frag [%s]: %lu messages from %lu fragments, %lu missing, "
+                      "%lu aborted, %lu oversize, %lu malformed",
+                 peers[i].name, (unsigned long)f->messages, (unsigned long)f->fragments,
+                 (unsigned long)f->missing, (unsigned long)f->aborted,
+                 (unsigned long)f->oversize, (unsigned long)f->malformed);
+    }
+}
+
+// Aggregate and per-tracker notification rate, to see how the gateway
+// scales with the number of trackers
+static void log_rx_rate(int64_t now)
+{
+    if (rx_rate_us == 0) {
+        rx_rate_us = now;
+        return;
+    }
+    int64_t elapsed_ms = (now - rx_rate_us) / 1000;
+    if (elapsed_ms < RX_RATE_LOG_MS) {
+        return;
+    }
+    rx_rate_us = now;
+
+    uint32_t total = 0;
+    char line[96];
+    int n = 0;
+    line[0] = '\0';
+    for (int i = 0; i < BLE_MAX_PEERS; i++) {
+        ble_peer_t *p = &peers[i];
+        if (!p->connected && p->rx_count == 0) {
+            continue;
+        }
+        uint32_t tenths = (uint32_t)((uint64_t)p->rx_count * 10000 / elapsed_ms);
+        total += p->rx_count;
+        p->rx_count = 0;
+        if (n < (int)sizeof(line)) {
+            n += snprintf(line + n, sizeof(line) - n, " %s %lu.%lu", p->name,
+                          (unsigned long)(tenths / 10), (unsigned long)(tenths % 10));
+        }
+    }
+    if (total == 0) {
+        return;
+    }
+
+    uint32_t tenths = (uint32_t)((uint64_t)total * 10000 / elapsed_ms);
+    ESP_LOGI(TAG, "RX rate: %d trackers, %lu.%lu notifications/s (%s )",
+             connected_count(), (unsigned long)(tenths / 10), (unsigned long)(tenths % 10),
+             line);
+}
+
+// A whole message goes straight to the parser; a fragment is reassembled
+// first and the message handled once its last fragment is in
+static void dispatch_notification(ble_peer_t *p, const char *data, uint16_t len)
+{
+    const uint8_t *msg;
+    size_t msg_len;
+
+    if (!ble_frag_is_fragment((const uint8_t *)data, len)) {
+        process_workout_event(p, data, len);
+        return;
+    }
+
+    uint32_t missing = p->frag_rx.missing;
+    if (ble_frag_rx_push(&p->frag_rx, (const uint8_t *)data, len, &msg, &msg_len)) {
+        process_workout_event(p, (const char *)msg, (uint16_t)msg_len);
+    }
+    if (p->frag_rx.missing != missing) {
+        ESP_LOGW(TAG, "[%s] Fragment sequence gap: %lu lost", p->name,
+                 (unsigned long)(p->frag_rx.missing - missing));
+    }
+}
+
+// Parse one notification straight out of its mbuf and free it. A single
+// mbuf is used in place; a chain is pulled up into its first block when
+// it fits, and only copied to the heap when it does not, so there is no
+// fixed size limit.
+static void ingest_notification(ble_peer_t *p, uint16_t attr_handle, struct os_mbuf *om)
+{
+    uint16_t len = OS_MBUF_PKTLEN(om);
+    char *heap = NULL;
+
+    ESP_LOGI(TAG, "[%s] Notification received: handle=%d, len=%d", p->name, attr_handle, len);
+
+    if (len == 0) {
+        os_mbuf_free_chain(om);
+        return;
+    }
+
+    if (om->om_len < len) {
+        // os_mbuf_pullup frees the chain when it fails, so only try it
+        // when the payload fits one block
+        if (len <= om->om_omp->omp_databuf_len - om->om_pkthdr_len) {
+            om = os_mbuf_pullup(om, len);
+            if (om == NULL) {
+                rx_stats.failed++;
+                return;
+            }
+            rx_stats.pulled_up++;
+        } else {
+            heap = (char *)malloc(len);
+            if (heap == NULL || os_mbuf_copydata(om, 0, len, heap) != 0) {
+                free(heap);
+                os_mbuf_free_chain(om);
+                rx_stats.failed++;
+                return;
+            }
+            rx_stats.copied++;
+        }
+    } else {
+        rx_stats.in_place++;
+    }
+
+    dispatch_notification(p, heap ? heap : (const char *)om->om_data, len);
+
+    free(heap);
+    os_mbuf_free_chain(om);
+}
+
+// Start a peer's worker-side state over when its slot has a new connection
+static void rx_sync_generation(ble_peer_t *p, uint32_t now_ms)
+{
+    uint32_t gen = p->generation.load(std::memory_order_relaxed);
+    if (gen == p->rx_generation) {
+        return;
+    }
+    p->rx_generation = gen;
+    ble_frag_rx_reset(&p->frag_rx);
+    ble_conn_policy_reset(&p->policy, now_ms);
+    p->policy_results_seen = p->update_results.load(std::memory_order_relaxed);
+}
+
+static void log_conn_policy(const ble_peer_t *p)
+{
+    const ble_conn_policy_t *pol = &p->policy;
+
+    for (int i = 0; i < BLE_CONN_PROFILES; i++) {
+        ble_tlm_hist_t gaps;
+        ble_telemetry_gaps(peer_index(p), (ble_conn_profile_t)i, &gaps);
+        if (pol->requests[i] == 0 && gaps.total == 0) {
+            continue;
+        }
+        ESP_LOGI(TAG, "  [%s] %s: %lu requests, %lu rejected; %lu notification gaps, "
+                      "p50 < %lu ms, p90 < %lu ms",
+                 p->name, ble_conn_policy_name((ble_conn_profile_t)i),
+                 (unsigned long)pol->requests[i], (unsigned long)pol->rejects[i],
+                 (unsigned long)gaps.total,
+                 (unsigned long)(ble_tlm_hist_percentile(&gaps, ble_tlm_gap_edges_us, 50) / 1000),
+                 (unsigned long)(ble_tlm_hist_percentile(&gaps, ble_tlm_gap_edges_us, 90) / 1000));
+        if (gaps.total > 0) {
+            char line[128];
+            int n = 0;
+            for (int b = 0; b < BLE_TLM_BUCKETS && n < (int)sizeof(line); b++) {
+                n += snprintf(line + n, sizeof(line) - n, " %lu", (unsigned long)gaps.count[b]);
+            }
+            ESP_LOGI(TAG, "    gaps <5/10/20/50/100/200/500/1000/5000/more ms:%s", line);
+        }
+    }
+}
+
+// Feed each tracker's policy what the host task saw since the last pass
+// and ask for new parameters when it wants them
+static void run_conn_policy(void)
+{
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    for (int i = 0; i < BLE_MAX_PEERS; i++) {
+        ble_peer_t *p = &peers[i];
+        if (!p->connected) {
+            continue;
+        }
+        rx_sync_generation(p, now_ms);
+
+        uint32_t results = p->update_results.load(std::memory_order_acquire);
+        if (results != p->policy_results_seen) {
+            p->policy_results_seen = results;
+            ble_conn_policy_result(&p->policy,
+                                   p->update_status.load(std::memory_order_relaxed) == 0, now_ms);
+        }
+
+        ble_conn_profile_t profile;
+        if (ble_conn_policy_poll(&p->policy, now_ms, &profile)) {
+            request_conn_profile(p, profile);
+            ble_conn_policy_requested(&p->policy, profile, now_ms);
+            log_conn_policy(p);
+        }
+    }
+}
+
+static int64_t rssi_sample_us;
+static int64_t telemetry_publish_us;
+static char telemetry_json[TELEMETRY_JSON_LEN];
+
+// Sample each link's RSSI and publish the telemetry snapshot when due
+static void run_telemetry(int64_t now)
+{
+    if (now - rssi_sample_us >= (int64_t)RSSI_SAMPLE_MS * 1000) {
+        rssi_sample_us = now;
+        for (int i = 0; i < BLE_MAX_PEERS; i++) {
+            int8_t rssi;
+            if (!peers[i].connected) {
+                continue;
+            }
+            int rc = ble_gap_conn_rssi(peers[i].conn_handle, &rssi);
+            if (rc == 0) {
+                ble_telemetry_rssi((uint8_t)i, rssi);
+            } else {
+                ble_telemetry_gap_error(BLE_TLM_GAP_RSSI, rc);
+            }
+        }
+    }
+
+    if (telemetry_publish_us == 0) {
+        telemetry_publish_us = now;
+    }
+    if (now - telemetry_publish_us >= (int64_t)TELEMETRY_PUBLISH_MS * 1000) {
+        telemetry_publish_us = now;
+        size_t len = ble_telemetry_json(now, telemetry_json, sizeof(telemetry_json));
+        if (len == 0) {
+            ESP_LOGW(TAG, "Telemetry snapshot does not fit %d B", TELEMETRY_JSON_LEN);
+        } else if (!mqtt_publish_diag(telemetry_json, len)) {
+            ESP_LOGW(TAG, "Telemetry snapshot not published (%u B)", (unsigned)len);
+        }
+    }
+}
+
+static void rx_worker_task(void *param)
+{
+    (void)param;
+    uint8_t idx;
+
+    while (1) {
+        // Wake at least once a poll period so the policy sees a link go
+        // quiet
+        BaseType_t got = xQueueReceive(rx_work_queue, &idx, pdMS_TO_TICKS(POLICY_POLL_MS));
+        run_conn_policy();
+        run_telemetry(esp_timer_get_time());
+        log_rx_rate(esp_timer_get_time());
+        if (got != pdTRUE) {
+            continue;
+        }
+
+        rx_desc_t *desc = &rx_pool[idx];
+        ble_peer_t *p = &peers[desc->peer];
+        int64_t t0 = esp_timer_get_time();
+        uint32_t in_use = RX_POOL_SIZE - uxQueueMessagesWaiting(rx_free_queue);
+        uint32_t wait_us = (uint32_t)(t0 - desc->rx_us);
+
+        rx_sync_generation(p, (uint32_t)(t0 / 1000));
+        bool stale = desc->generation != p->rx_generation;
+        if (stale) {
+            rx_stats.stale++;
+            os_mbuf_free_chain(desc->om);
+        } else {
+            ble_conn_policy_notify(&p->policy, desc->rx_us);
+            p->rx_count++;
+            ingest_notification(p, desc->attr_handle, desc->om);
+        }
+        desc->om = NULL;
+        xQueueSend(rx_free_queue, &idx, 0);
+
+        uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+        if (!stale) {
+            ble_telemetry_notify(desc->peer, p->policy.current, desc->rx_us, us);
+        }
+        uint32_t stack_free = uxTaskGetStackHighWaterMark(NULL);
+
+        rx_stats.count++;
+        rx_stats.total_us += us;
+        if (us > rx_stats.max_us) rx_stats.max_us = us;
+        if (wait_us > rx_stats.max_wait_us) rx_stats.max_wait_us = wait_us;
+        if (in_use > rx_stats.in_use_max) rx_stats.in_use_max = in_use;
+        if (stack_free < rx_stats.stack_min) rx_stats.stack_min = stack_free;
+
+        if (rx_stats.count % RX_STATS_LOG_EVERY == 0) {
+            log_rx_stats();
+        }
+    }
+}
+
+// GAP callback side: two non-blocking queue operations, no parsing
+static void enqueue_notification(ble_peer_t *p, uint16_t attr_handle, struct os_mbuf *om)
+{
+    int64_t t0 = esp_timer_get_time();
+    uint8_t idx;
+
+    if (xQueueReceive(rx_free_queue, &idx, 0) != pdTRUE) {
+        rx_host_stats.pool_full++;
+        os_mbuf_free_chain(om);
+    } else {
+        rx_pool[idx].om = om;
+        rx_pool[idx].attr_handle = attr_handle;
+        rx_pool[idx].peer = peer_index(p);
+        rx_pool[idx].generation = p->generation.load(std::memory_order_relaxed);
+        rx_pool[idx].rx_us = t0;
+        xQueueSend(rx_work_queue, &idx, 0);
+        rx_host_stats.queued++;
+    }
+
+    uint32_t us = (uint32_t)(esp_timer_get_time() - t0);
+    uint32_t stack_free = uxTaskGetStackHighWaterMark(NULL);
+    ble_telemetry_callback(us);
+    if (us > rx_host_stats.max_us) rx_host_stats.max_us = us;
+    if (stack_free < rx_host_stats.stack_min) rx_host_stats.stack_min = stack_free;
+}
+
+static bool rx_worker_init(void)
+{
+    for (int i = 0; i < BLE_MAX_PEERS; i++) {
+        ble_frag_rx_init(&peers[i].frag_rx, peers[i].frag_rx_buf, sizeof(peers[i].frag_rx_buf));
+    }
+
+    rx_free_queue = xQueueCreateStatic(RX_POOL_SIZE, sizeof(uint8_t),
+                                       rx_free_storage, &rx_free_queue_struct);
+    rx_work_queue = xQueueCreateStatic(RX_POOL_SIZE, sizeof(uint8_t),
+                                       rx_work_storage, &rx_work_queue_struct);
+    if (rx_free_queue == NULL || rx_work_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create RX queues");
+        return false;
+    }
+
+    for (uint8_t i = 0; i < RX_POOL_SIZE; i++) {
+        xQueueSend(rx_free_queue, &i, 0);
+    }
+
+    TaskHandle_t task = xTaskCreateStatic(rx_worker_task, "ble_rx", RX_WORKER_STACK_WORDS,
+                                          NULL, 5, rx_worker_stack, &rx_worker_tcb);
+    if (task == NULL) {
+        ESP_LOGE(TAG, "Failed to start RX worker");
+        return false;
+    }
+    return true;
+}
+
+// Outbound queue to the trackers: senders copy a message into a slot
+// from a static pool and return at once; one worker task sorts them into
+// a queue per tracker and writes each tracker's in order, so fragments of
+// different messages never interleave.
+//
+// Writes go without response and are paced by credits: up to TX_CREDITS
+// packets per connection interval, the rate at which the controller
+// reports packets complete and frees their buffers. NimBLE does not pass
+// those completions up to a GATT client, so BLE_HS_ENOMEM from the host
+// is taken as the stack being out of buffers: credits drop to zero and
+// the tracker's head message waits for the next interval, resuming where
+// it stopped, while the worker serves the others. An acked message ends with a
+// write request instead; it stays at the head of its tracker's queue
+// until the MAX responds, while the worker goes on serving the others.
+// Credits are kept per tracker; the pool is shared.
+#define TX_MSG_MAX            512
+#define TX_WORKER_STACK_WORDS 3072
+#define TX_CREDITS            8
+#define TX_STALL_MS           2000  // Give up on a message stuck this long
+#define TX_ACK_TIMEOUT_MS     5000
+#define TX_ACK_RETRIES        2     // On an ATT error response
+#define TX_STATS_LOG_EVERY    16
+
+typedef struct {
+    uint16_t len;
+    uint8_t peer;
+    bool acked;
+    uint32_t generation;    // Of the peer's connection it was queued for
+    int64_t queued_us;
+    uint8_t data[TX_MSG_MAX];
+} tx_msg_t;
+
+static tx_msg_t tx_pool[TX_QUEUE_LEN];
+
+static QueueHandle_t tx_free_queue = NULL;
+static QueueHandle_t tx_work_queue = NULL;
+static StaticQueue_t tx_free_queue_struct;
+static StaticQueue_t tx_work_queue_struct;
+static uint8_t tx_free_storage[TX_QUEUE_LEN * sizeof(uint8_t)];
+static uint8_t tx_work_storage[TX_QUEUE_LEN * sizeof(uint8_t)];
+static StaticTask_t tx_worker_tcb;
+static StackType_t tx_worker_stack[TX_WORKER_STACK_WORDS];
+static TaskHandle_t tx_task = NULL;
+
+// Sender side, from any task
+static std::atomic<uint32_t> tx_queued(0);
+static std::atomic<uint32_t> tx_dropped_full(0);
+static std::atomic<uint32_t> tx_dropped_size(0);
+static std::atomic<uint32_t> tx_depth_max(0);
+
+// Worker side
+static ble_tx_stats_t tx_stats;
+static uint8_t tx_frag_buf[BLE_ATT_MTU_MAX];
+
+// Tags write requests, so a late response is told from the current one
+static uint32_t tx_ack_seq;
+
+static int64_t tx_log_us;
+static uint32_t tx_log_bytes;
+
+static void note_conn_itvl(ble_peer_t *p, uint16_t itvl)
+{
+    // Units of 1.25 ms
+    uint16_t ms = (uint16_t)((itvl * 5 + 3) / 4);
+    p->itvl_ms.store(ms > 0 ? ms : 1, std::memory_order_relaxed);
+}
+
+// Cut short any wait in the worker, e.g. when a link drops
+static void tx_wake(void)
+{
+    if (tx_task != NULL) {
+        xTaskNotifyGive(tx_task);
+    }
+}
+
+static bool tx_link_ready(const ble_peer_t *p, uint32_t gen)
+{
+    return p->connected && p->handles.rx_val != 0 &&
+           p->generation.load(std::memory_order_relaxed) == gen;
+}
+
+static void log_tx_stats(void)
+{
+    ble_tx_stats_t st;
+    ble_client_get_tx_stats(&st);
+
+    int64_t now = esp_timer_get_time();
+    uint32_t rate = 0;
+    if (tx_log_us != 0 && now > tx_log_us) {
+        rate = (uint32_t)((uint64_t)(st.bytes - tx_log_bytes) * 1000000 / (now - tx_log_us));
+    }
+    tx_log_us = now;
+    tx_log_bytes = st.bytes;
+
+    ESP_LOGI(TAG, "TX queue: %lu queued, %lu sent in %lu packets (%lu B, %lu B/s), "
+                  "depth %lu/%d peak, %lu us max queued",
+             (unsigned long)st.queued, (unsigned long)st.sent, (unsigned long)st.packets,
+             (unsigned long)st.bytes, (unsigned long)rate, (unsigned long)st.depth_max,
+             TX_QUEUE_LEN, (unsigned long)st.max_queued_us);
+    ESP_LOGI(TAG, "TX drops: %lu queue full, %lu too long, %lu link; %lu buffer stalls; "
+                  "acked %lu, %lu failed, %lu retries, %lu us max ack",
+             (unsigned long)st.dropped_full, (unsigned long)st.dropped_size,
+             (unsigned long)st.dropped_link, (unsigned long)st.stalls,
+             (unsigned long)st.acked, (unsigned long)st.ack_failed,
+             (unsigned long)st.ack_retries, (unsigned long)st.ack_max_us);
+}
+
+// TX_PARKED: the message waits at the head of its tracker's queue for a
+// write response, and the worker serves the other trackers meanwhile.
+// TX_WAITING: the same, for the tracker's next credit refill.
+typedef enum {
+    TX_FAILED,
+    TX_SENT,
+    TX_PARKED,
+    TX_WAITING
+} tx_result_t;
+
+static int64_t refill_due(const ble_peer_t *p)
+{
+    return p->tx_refill_us + (int64_t)p->itvl_ms.load(std::memory_order_relaxed) * 1000;
+}
+
+// One credit per write without response; refilled each connection
+// interval. Never waits: the worker has other trackers to serve.
+static bool take_credit(ble_peer_t *p)
+{
+    if (p->tx_credits == 0) {
+        int64_t now = esp_timer_get_time();
+        if (now < refill_due(p)) {
+            return false;
+        }
+        p->tx_credits = TX_CREDITS;
+        p->tx_refill_us = now;
+    }
+    p->tx_credits--;
+    return true;
+}
+
+static tx_result_t write_no_rsp(ble_peer_t *p, const uint8_t *data, size_t len)
+{
+    if (!take_credit(p)) {
+        return TX_WAITING;
+    }
+    int rc = ble_gattc_write_no_rsp_flat(p->conn_handle, p->handles.rx_val, data, len);
+    if (rc == 0) {
+        tx_stats.packets++;
+        tx_stats.bytes += len;
+        return TX_SENT;
+    }
+    if (rc != BLE_HS_ENOMEM) {
+        ESP_LOGE(TAG, "[%s] Write failed: %d", p->name, rc);
+        ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_WRITE, rc);
+        return TX_FAILED;
+    }
+    tx_stats.stalls++;
+    p->tx_credits = 0;
+    p->tx_refill_us = esp_timer_get_time();
+    return TX_WAITING;
+}
+
+// Host task: the MAX answered a write request
+static int tx_on_ack(uint16_t conn_handle, const struct ble_gatt_error *error,
+                     struct ble_gatt_attr *attr, void *arg)
+{
+    ble_peer_t *p = peer_by_conn(conn_handle);
+    if (p != NULL) {
+        p->ack_status.store(error->status, std::memory_order_relaxed);
+        p->ack_done.store((uint32_t)(uintptr_t)arg, std::memory_order_release);
+        p->att_pending.store(false, std::memory_order_release);
+    }
+    tx_wake();
+    return 0;
+}
+
+// Issue the write request that ends an acked message; the worker moves
+// on and tx_check_ack() picks up the response
+static bool write_acked(ble_peer_t *p, const uint8_t *data, size_t len)
+{
+    uint32_t seq = ++tx_ack_seq;
+
+    if (data != p->tx_ack_buf) {
+        memcpy(p->tx_ack_buf, data, len);
+        p->tx_ack_len = (uint16_t)len;
+    }
+
+    p->att_pending.store(true, std::memory_order_relaxed);
+    int rc = ble_gattc_write_flat(p->conn_handle, p->handles.rx_val, data, len,
+                                  tx_on_ack, (void *)(uintptr_t)seq);
+    if (rc != 0) {
+        p->att_pending.store(false, std::memory_order_relaxed);
+        ESP_LOGE(TAG, "[%s] Write request failed: %d", p->name, rc);
+        ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_WRITE, rc);
+        return false;
+    }
+    tx_stats.packets++;
+    tx_stats.bytes += len;
+
+    p->tx_ack_seq = seq;
+    p->tx_ack_us = esp_timer_get_time();
+    p->tx_awaiting_ack = true;
+    return true;
+}
+
+static tx_result_t send_one(const tx_msg_t *msg)
+{
+    ble_peer_t *p = &peers[msg->peer];
+    uint32_t gen = msg->generation;
+
+    if (gen != p->tx_generation) {
+        p->frag_tx.next_seq = 0;
+        p->tx_credits = TX_CREDITS;
+        p->tx_generation = gen;
+    }
+    if (!tx_link_ready(p, gen)) {
+        return TX_FAILED;
+    }
+
+    size_t payload = p->mtu.load(std::memory_order_relaxed) - 3;
+
+    if (!ble_frag_needed(msg->len, payload)) {
+        if (msg->acked) {
+            return write_acked(p, msg->data, msg->len) ? TX_PARKED : TX_FAILED;
+        }
+        return write_no_rsp(p, msg->data, msg->len);
+    }
+
+    if (!p->frag.load(std::memory_order_relaxed)) {
+        ESP_LOGE(TAG, "[%s] Message of %u B exceeds MTU payload %u B and MAX cannot reassemble",
+                 p->name, (unsigned)msg->len, (unsigned)payload);
+        tx_stats.dropped_size++;
+        return TX_FAILED;
+    }
+
+    // Fragments stream without response; ATT keeps them in order, so a
+    // response to the last one covers the whole message. A fragment only
+    // counts as sent once written, so a wait for credits resumes with it.
+    while (true) {
+        ble_frag_tx_t frag = p->frag_tx;
+        size_t offset = p->tx_offset;
+        size_t n = ble_frag_tx_next(&frag, msg->data, msg->len, &offset, tx_frag_buf, payload);
+        if (n == 0) {
+            return TX_SENT;
+        }
+
+        tx_result_t res;
+        if (offset == msg->len && msg->acked) {
+            res = write_acked(p, tx_frag_buf, n) ? TX_PARKED : TX_FAILED;
+        } else {
+            res = write_no_rsp(p, tx_frag_buf, n);
+        }
+        if (res == TX_WAITING) {
+            return TX_WAITING;
+        }
+        if (res == TX_FAILED) {
+            ESP_LOGE(TAG, "[%s] Fragmented message abandoned (%u/%u B sent)",
+                     p->name, (unsigned)p->tx_offset, (unsigned)msg->len);
+            return TX_FAILED;
+        }
+        p->frag_tx = frag;
+        p->tx_offset = offset;
+        if (res == TX_PARKED) {
+            return TX_PARKED;
+        }
+    }
+}
+
+// The worker is done with the message at the head of p's queue
+static void tx_finish(ble_peer_t *p, bool sent, uint32_t size_drops)
+{
+    uint8_t idx = p->tx_fifo[p->tx_fifo_head];
+    const tx_msg_t *msg = &tx_pool[idx];
+
+    if (sent) {
+        tx_stats.sent++;
+    } else {
+        if (msg->acked) {
+            tx_stats.ack_failed++;
+        }
+        if (tx_stats.dropped_size == size_drops) {
+            tx_stats.dropped_link++;
+        }
+    }
+
+    p->tx_awaiting_ack = false;
+    p->tx_ack_attempts = 0;
+    p->tx_att_wait_us = 0;
+    p->tx_offset = 0;
+    p->tx_stall_us = 0;
+    p->tx_fifo_head = (uint8_t)((p->tx_fifo_head + 1) % TX_QUEUE_LEN);
+    p->tx_fifo_len--;
+    xQueueSend(tx_free_queue, &idx, 0);
+
+    if (++tx_stats.handled % TX_STATS_LOG_EVERY == 0) {
+        log_tx_stats();
+    }
+}
+
+// A parked message: done once answered, retried if rejected, dropped
+// when the response is overdue or the link goes
+static void tx_check_ack(ble_peer_t *p, int64_t now)
+{
+    const tx_msg_t *msg = &tx_pool[p->tx_fifo[p->tx_fifo_head]];
+    bool link = tx_link_ready(p, msg->generation);
+
+    if (p->ack_done.load(std::memory_order_acquire) != p->tx_ack_seq) {
+        if (link && now - p->tx_ack_us < (int64_t)TX_ACK_TIMEOUT_MS * 1000) {
+            return;
+        }
+        // The request is still outstanding (att_pending stays set);
+        // NimBLE ends the link if the MAX never answers
+        ESP_LOGW(TAG, "[%s] No write response from MAX", p->name);
+        if (link) {
+            ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_NO_RSP, BLE_HS_ETIMEOUT);
+        }
+        tx_finish(p, false, tx_stats.dropped_size);
+        return;
+    }
+
+    int status = p->ack_status.load(std::memory_order_relaxed);
+    if (status == 0) {
+        uint32_t us = (uint32_t)(now - p->tx_ack_us);
+        if (us > tx_stats.ack_max_us) tx_stats.ack_max_us = us;
+        tx_stats.acked++;
+        tx_finish(p, true, tx_stats.dropped_size);
+        return;
+    }
+
+    ESP_LOGW(TAG, "[%s] Write rejected by MAX: %d", p->name, status);
+    ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_REJECTED, status);
+    if (link && p->tx_ack_attempts < TX_ACK_RETRIES) {
+        p->tx_ack_attempts++;
+        tx_stats.ack_retries++;
+        if (write_acked(p, p->tx_ack_buf, p->tx_ack_len)) {
+            return;
+        }
+    }
+    tx_finish(p, false, tx_stats.dropped_size);
+}
+
+// Start the message at the head of p's queue unless it has to wait. ATT
+// allows one request at a time per connection, and one that went
+// unanswered is still outstanding, so an acked message waits for it to
+// be answered (or the link to drop), up to the ack timeout.
+static void tx_start(ble_peer_t *p, int64_t now)
+{
+    const tx_msg_t *msg = &tx_pool[p->tx_fifo[p->tx_fifo_head]];
+
+    if (msg->acked && p->att_pending.load(std::memory_order_acquire) &&
+        tx_link_ready(p, msg->generation)) {
+        if (p->tx_att_wait_us == 0) {
+            p->tx_att_wait_us = now;
+        }
+        if (now - p->tx_att_wait_us < (int64_t)TX_ACK_TIMEOUT_MS * 1000) {
+            return;
+        }
+        ESP_LOGW(TAG, "[%s] Earlier write request still unanswered", p->name);
+        tx_finish(p, false, tx_stats.dropped_size);
+        return;
+    }
+
+    if (p->tx_offset == 0 && p->tx_stall_us == 0) {
+        uint32_t queued_us = (uint32_t)(now - msg->queued_us);
+        if (queued_us > tx_stats.max_queued_us) tx_stats.max_queued_us = queued_us;
+    }
+
+    uint32_t size_drops = tx_stats.dropped_size;
+    size_t offset = p->tx_offset;
+    tx_result_t res = send_one(msg);
+
+    // Out of credits: give up only if nothing went out for TX_STALL_MS
+    if (res == TX_WAITING) {
+        if (p->tx_stall_us == 0 || p->tx_offset != offset) {
+            p->tx_stall_us = now;
+        } else if (now - p->tx_stall_us >= (int64_t)TX_STALL_MS * 1000) {
+            ESP_LOGW(TAG, "[%s] TX stalled: no controller buffers for %d ms",
+                     p->name, TX_STALL_MS);
+            tx_finish(p, false, size_drops);
+        }
+        return;
+    }
+    if (res != TX_PARKED) {
+        tx_finish(p, res == TX_SENT, size_drops);
+    }
+}
+
+// The earlier of a wake-up time and an ack timeout that started at since_us
+static int64_t earliest(int64_t wake_us, int64_t since_us)
 {
-    char search[64];
-    snprintf(search, sizeof(search), "\"%s\":\"", key);
+    int64_t due = since_us + (int64_t)TX_ACK_TIMEOUT_MS * 1000;
+    return due < wake_us ? due : wake_us;
+}
 
-    const char *start = strstr(json, search);
-    if (start == NULL)
-        return false;
+static void tx_worker_task(void *param)
+{
+    (void)param;
+    uint8_t idx;
+
+    while (1) {
+        // Sort new messages into their trackers' queues; the pool holds
+        // TX_QUEUE_LEN in all, so a queue never overflows
+        while (xQueueReceive(tx_work_queue, &idx, 0) == pdTRUE) {
+            ble_peer_t *p = &peers[tx_pool[idx].peer];
+            p->tx_fifo[(p->tx_fifo_head + p->tx_fifo_len) % TX_QUEUE_LEN] = idx;
+            p->tx_fifo_len++;
+        }
 
-    start += strlen(search);
-    const char *end = strchr(start, '"');
-    if (end == NULL)
-        return false;
+        // One message per tracker per pass, so none waits behind another
+        // tracker's backlog, write response or credits
+        bool busy = false;
+        int64_t wake_us = INT64_MAX;
+        for (int i = 0; i < BLE_MAX_PEERS; i++) {
+            ble_peer_t *p = &peers[i];
+            int64_t now = esp_timer_get_time();
+
+            if (p->tx_fifo_len == 0) {
+                continue;
+            }
+            uint8_t len = p->tx_fifo_len;
+            if (p->tx_awaiting_ack) {
+                tx_check_ack(p, now);
+            } else {
+                tx_start(p, now);
+            }
 
-    size_t len = end - start;
-    if (len >= out_len)
-        len = out_len - 1;
+            if (p->tx_awaiting_ack) {
+                wake_us = earliest(wake_us, p->tx_ack_us);
+            } else if (p->tx_fifo_len != len) {
+                busy = busy || p->tx_fifo_len > 0;
+            } else if (p->tx_att_wait_us != 0) {
+                wake_us = earliest(wake_us, p->tx_att_wait_us);
+            } else if (p->tx_stall_us != 0 && refill_due(p) < wake_us) {
+                wake_us = refill_due(p);
+            }
+        }
+        if (busy) {
+            continue;
+        }
 
-    strncpy(out, start, len);
-    out[len] = '\0';
-    return true;
+        // Responses, disconnects and new messages all notify
+        TickType_t ticks = portMAX_DELAY;
+        if (wake_us != INT64_MAX) {
+            int64_t left = wake_us - esp_timer_get_time();
+            ticks = left > 0 ? pdMS_TO_TICKS(left / 1000) + 1 : 0;
+        }
+        ulTaskNotifyTake(pdTRUE, ticks);
+    }
 }
 
-static bool json_get_int(const char *json, const char *key, int *out)
+static bool enqueue_tx(uint8_t peer, const uint8_t *data, size_t len, bool acked)
 {
-    char search[64];
-    snprintf(search, sizeof(search), "\"%s\":", key);
+    uint8_t idx;
 
-    const char *start = strstr(json, search);
-    if (start == NULL)
+    if (peer >= BLE_MAX_PEERS || !peers[peer].connected || peers[peer].handles.rx_val == 0 ||
+        data == NULL || tx_free_queue == NULL) {
+        ESP_LOGW(TAG, "BLE TX not ready");
         return false;
+    }
+    if (len == 0 || len > TX_MSG_MAX) {
+        ESP_LOGE(TAG, "Message of %u B not queued (limit %d B)", (unsigned)len, TX_MSG_MAX);
+        tx_dropped_size.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (xQueueReceive(tx_free_queue, &idx, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "TX queue full, message dropped");
+        tx_dropped_full.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
 
-    start += strlen(search);
-    *out = atoi(start);
+    tx_msg_t *msg = &tx_pool[idx];
+    memcpy(msg->data, data, len);
+    msg->len = (uint16_t)len;
+    msg->peer = peer;
+    msg->acked = acked;
+    msg->generation = peers[peer].generation.load(std::memory_order_relaxed);
+    msg->queued_us = esp_timer_get_time();
+    xQueueSend(tx_work_queue, &idx, 0);
+    tx_wake();
+
+    tx_queued.fetch_add(1, std::memory_order_relaxed);
+    uint32_t depth = TX_QUEUE_LEN - uxQueueMessagesWaiting(tx_free_queue);
+    uint32_t peak = tx_depth_max.load(std::memory_order_relaxed);
+    while (depth > peak &&
+           !tx_depth_max.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {
+    }
     return true;
 }
 
-static bool json_get_ulong(const char *json, const char *key, unsigned long *out)
+static bool tx_worker_init(void)
 {
-    char search[64];
-    snprintf(search, sizeof(search), "\"%s\":", key);
-
-    const char *start = strstr(json, search);
-    if (start == NULL)
+    tx_free_queue = xQueueCreateStatic(TX_QUEUE_LEN, sizeof(uint8_t),
+                                       tx_free_storage, &tx_free_queue_struct);
+    tx_work_queue = xQueueCreateStatic(TX_QUEUE_LEN, sizeof(uint8_t),
+                                       tx_work_storage, &tx_work_queue_struct);
+    if (tx_free_queue == NULL || tx_work_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create TX queues");
         return false;
+    }
 
-    start += strlen(search);
-    *out = strtoul(start, NULL, 10);
-    return true;
-}
+    for (uint8_t i = 0; i < TX_QUEUE_LEN; i++) {
+        xQueueSend(tx_free_queue, &i, 0);
+    }
 
-static void process_workout_event(const char *json_data, uint16_t len)
-{
-    if (strstr(json_data, "\"cmd\":\"hr_req\"")) {
-        ESP_LOGI(TAG, "HR request received from MAX - starting 5s capture");
-        hr_session_start(0);
-        return;
+    tx_task = xTaskCreateStatic(tx_worker_task, "ble_tx", TX_WORKER_STACK_WORDS,
+                                NULL, 5, tx_worker_stack, &tx_worker_tcb);
+    if (tx_task == NULL) {
+        ESP_LOGE(TAG, "Failed to start TX worker");
+        return false;
     }
+    return true;
+}
 
-    char event_type[16] = {0};
-    char mode[16] = {0};
-    char time_str[16] = {0};
-    int lap_num = 0;
-    int total_laps = 0;
-    unsigned long lap_ms = 0;
-    unsigned long split_ms = 0;
-    unsigned long total_ms = 0;
+static const ble_uuid16_t cccd_uuid = BLE_UUID16_INIT(0x2902);
 
-    ESP_LOGI(TAG, "Raw workout data (%d bytes): %s", len, json_data);
+static bool same_addr(const ble_addr_t *a, const ble_addr_t *b)
+{
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
 
-    // Forward raw JSON to MQTT
-    if (workout_callback) {
-        workout_callback(json_data, len);
+static bool addr_connected(const ble_addr_t *addr)
+{
+    for (int i = 0; i < BLE_MAX_PEERS; i++) {
+        if (peers[i].connected && same_addr(&peers[i].ota_addr, addr)) {
+            return true;
+        }
     }
+    return false;
+}
 
-    // Also publish to MQTT directly
-    mqtt_publish_workout_data(json_data);
-
-    if (!json_get_string(json_data, "event", event_type, sizeof(event_type))) {
-        ESP_LOGW(TAG, "Could not parse event type");
-        return;
+// Known trackers not connected right now, most recent first
+static int absent_known_peers(ble_addr_t *out)
+{
+    int n = 0;
+    for (int i = 0; i < known_count; i++) {
+        if (!addr_connected(&known_peers[i])) {
+            out[n++] = known_peers[i];
+        }
     }
+    return n;
+}
 
-    printf("\n========================================\n");
-
-    if (strcmp(event_type, "start") == 0) {
-        json_get_string(json_data, "mode", mode, sizeof(mode));
-        json_get_int(json_data, "laps", &total_laps);
+static void note_link_lost(const ble_addr_t *addr)
+{
+    int slot = 0;
+    for (int i = 0; i < BLE_MAX_PEERS; i++) {
+        if (link_lost[i].us == 0 || same_addr(&link_lost[i].addr, addr)) {
+            slot = i;
+            break;
+        }
+        if (link_lost[i].us < link_lost[slot].us) {
+            slot = i;
+        }
+    }
+    link_lost[slot].addr = *addr;
+    link_lost[slot].us = esp_timer_get_time();
+}
 
-        printf(">>> WORKOUT STARTED!\n");
-        printf("    Mode: %s (%d laps)\n", mode, total_laps);
-        
-        // Turn on green LED for active workout
-        green_led_on();
-        red_led_off();
+static void note_reconnect(const ble_peer_t *p)
+{
+    int i;
+    for (i = 0; i < BLE_MAX_PEERS; i++) {
+        if (link_lost[i].us != 0 && same_addr(&link_lost[i].addr, &p->ota_addr)) {
+            break;
+        }
+    }
+    if (i == BLE_MAX_PEERS) {
+        return;
     }
-    else if (strcmp(event_type, "lap") == 0) {
-        json_get_int(json_data, "lap", &lap_num);
-        json_get_ulong(json_data, "lap_ms", &lap_ms);
-        json_get_ulong(json_data, "split_ms", &split_ms);
 
-        format_time(lap_ms, time_str, sizeof(time_str));
-        printf(">>> LAP %d COMPLETE\n", lap_num);
-        printf("    Lap Time:   %s\n", time_str);
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - link_lost[i].us) / 1000);
+    link_lost[i].us = 0;
 
-        format_time(split_ms, time_str, sizeof(time_str));
-        printf("    Split Time: %s\n", time_str);
+    reconnect_stats[find_stage].count++;
+    reconnect_stats[find_stage].total_ms += ms;
+    if (ms > reconnect_stats[find_stage].max_ms) {
+        reconnect_stats[find_stage].max_ms = ms;
     }
-    else if (strcmp(event_type, "done") == 0) {
-        json_get_int(json_data, "laps", &total_laps);
-        json_get_ulong(json_data, "total_ms", &total_ms);
 
-        format_time(total_ms, time_str, sizeof(time_str));
-        printf(">>> WORKOUT COMPLETE!\n");
-        printf("    Total Laps: %d\n", total_laps);
-        printf("    Total Time: %s\n", time_str);
-        
-        // Turn on red LED when workout completes (idle)
-        red_led_on();
-        green_led_off();
+    ESP_LOGI(TAG, "[%s] Reconnected %lu ms after link loss (%s)",
+             p->name, (unsigned long)ms, find_stage_names[find_stage]);
+    for (i = 0; i < FIND_STAGES; i++) {
+        if (reconnect_stats[i].count) {
+            ESP_LOGI(TAG, "  %s: %lu reconnects, %lu ms avg, %lu ms max",
+                     find_stage_names[i], (unsigned long)reconnect_stats[i].count,
+                     (unsigned long)(reconnect_stats[i].total_ms / reconnect_stats[i].count),
+                     (unsigned long)reconnect_stats[i].max_ms);
+        }
     }
-    else if (strcmp(event_type, "stop") == 0) {
-        json_get_int(json_data, "laps", &lap_num);
-        json_get_ulong(json_data, "total_ms", &total_ms);
+}
 
-        format_time(total_ms, time_str, sizeof(time_str));
-        printf(">>> WORKOUT STOPPED\n");
-        printf("    Laps Completed: %d\n", lap_num);
-        printf("    Time: %s\n", time_str);
-        
-        // Turn on red LED when workout stops (idle)
-        red_led_on();
-        green_led_off();
+// Keep the addresses we reached trackers on for the next reconnect, most
+// recent first
+static void remember_peer(const ble_addr_t *addr)
+{
+    if (known_count > 0 && same_addr(&known_peers[0], addr)) {
+        return;
     }
-    else if (strcmp(event_type, "status") == 0) {
-        char state[16] = {0};
-        json_get_string(json_data, "state", state, sizeof(state));
-        json_get_int(json_data, "lap", &lap_num);
-        json_get_ulong(json_data, "elapsed_ms", &total_ms);
 
-        format_time(total_ms, time_str, sizeof(time_str));
-        printf(">>> STATUS UPDATE\n");
-        printf("    State: %s\n", state);
-        printf("    Current Lap: %d\n", lap_num);
-        printf("    Elapsed: %s\n", time_str);
+    int i;
+    for (i = 0; i < known_count - 1; i++) {
+        if (same_addr(&known_peers[i], addr)) {
+            break;
+        }
     }
-    else {
-        printf(">>> Unknown Event: %s\n", event_type);
+    if (i == known_count && known_count < BLE_MAX_PEERS) {
+        known_count++;
     }
-
-    printf("========================================\n\n");
+    memmove(&known_peers[1], &known_peers[0], sizeof(known_peers[0]) * i);
+    known_peers[0] = *addr;
+    ble_gatt_cache_store_peers(known_peers, known_count);
 }
 
-
-static const ble_uuid16_t cccd_uuid = BLE_UUID16_INIT(0x2902);
+static void note_first_notification(ble_peer_t *p)
+{
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - p->connect_us) / 1000);
+    int i = p->cache_hit ? 1 : 0;
+
+    p->first_notify_pending = false;
+    first_notify[i].count++;
+    first_notify[i].total_ms += ms;
+    if (ms < first_notify[i].min_ms) first_notify[i].min_ms = ms;
+    if (ms > first_notify[i].max_ms) first_notify[i].max_ms = ms;
+
+    ESP_LOGI(TAG, "[%s] First notification %lu ms after connect (%s)",
+             p->name, (unsigned long)ms, p->cache_hit ? "cached handles" : "discovery");
+    for (i = 0; i < 2; i++) {
+        if (first_notify[i].count) {
+            ESP_LOGI(TAG, "  %s: %lu connects, %lu ms avg, %lu-%lu ms",
+                     i ? "cached" : "discovery", (unsigned long)first_notify[i].count,
+                     (unsigned long)(first_notify[i].total_ms / first_notify[i].count),
+                     (unsigned long)first_notify[i].min_ms,
+                     (unsigned long)first_notify[i].max_ms);
+        }
+    }
+}
 
 static int ble_on_mtu_exchange(uint16_t conn_handle, const struct ble_gatt_error *error,
                                uint16_t mtu, void *arg)
 {
+    ble_peer_t *p = peer_by_conn(conn_handle);
+    if (p == NULL) {
+        return 0;
+    }
+
     if (error->status == 0) {
-        ESP_LOGI(TAG, "MTU exchange complete: MTU=%d", mtu);
-        mtu_exchanged = true;
+        ESP_LOGI(TAG, "[%s] MTU exchange complete: MTU=%d", p->name, mtu);
+        p->mtu_exchanged = true;
     } else {
-        ESP_LOGE(TAG, "MTU exchange failed: %d", error->status);
+        ESP_LOGE(TAG, "[%s] MTU exchange failed: %d", p->name, error->status);
+        ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_MTU, error->status);
     }
     return 0;
 }
 
-static void exchange_mtu(void)
+static void exchange_mtu(ble_peer_t *p)
 {
     ESP_LOGI(TAG, "Requesting MTU exchange (preferred: 256)...");
-    int rc = ble_gattc_exchange_mtu(conn_handle, ble_on_mtu_exchange, NULL);
+    int rc = ble_gattc_exchange_mtu(p->conn_handle, ble_on_mtu_exchange, NULL);
     if (rc != 0) {
         ESP_LOGE(TAG, "MTU exchange request failed: %d", rc);
+        ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_MTU, rc);
     }
 }
 
-static void request_conn_params_update(void)
+// Runs on the RX worker; the outcome arrives as a CONN_UPDATE event
+static void request_conn_profile(ble_peer_t *p, ble_conn_profile_t profile)
 {
+    const ble_conn_params_t *cp = ble_conn_policy_params(profile);
     struct ble_gap_upd_params params = {
-        .itvl_min = 12,
-        .itvl_max = 24,
-        .latency = 0,
-        .supervision_timeout = 400,
+        .itvl_min = cp->itvl_min,
+        .itvl_max = cp->itvl_max,
+        .latency = cp->latency,
+        .supervision_timeout = cp->timeout,
         .min_ce_len = 0,
         .max_ce_len = 0,
     };
 
-    ESP_LOGI(TAG, "Requesting connection parameter update...");
-    int rc = ble_gap_update_params(conn_handle, &params);
+    ESP_LOGI(TAG, "[%s] Requesting %s connection parameters (%u-%u ms, latency %u)...",
+             p->name, ble_conn_policy_name(profile), (unsigned)(cp->itvl_min * 5 / 4),
+             (unsigned)(cp->itvl_max * 5 / 4), (unsigned)cp->latency);
+    int rc = ble_gap_update_params(p->conn_handle, &params);
     if (rc != 0) {
-        ESP_LOGE(TAG, "Connection param update request failed: %d", rc);
+        ESP_LOGE(TAG, "[%s] Connection param update request failed: %d", p->name, rc);
+        ble_telemetry_gap_error(BLE_TLM_GAP_UPDATE, rc);
+        p->update_status.store(rc, std::memory_order_relaxed);
+        p->update_results.fetch_add(1, std::memory_order_release);
     }
 }
 
 static int ble_on_notify(uint16_t conn_handle, const struct ble_gatt_error *error,
                          struct ble_gatt_attr *attr, void *arg)
 {
+    ble_peer_t *p = peer_by_conn(conn_handle);
+    if (p == NULL) {
+        return 0;
+    }
+
     if (error->status == 0) {
         printf("\n========================================\n");
-        printf("   NOTIFICATIONS ENABLED!\n");
+        printf("   NOTIFICATIONS ENABLED (%s)!\n", p->name);
         printf("   Listening for workout data...\n");
         printf("========================================\n\n");
+
+        // Offer the binary codec and fragmentation; firmware that does
+        // not know "caps" ignores it and we stay on whole JSON messages
+        ble_client_send_message(peer_index(p),
+                                "{\"cmd\":\"caps\",\"codec\":\"" WORKOUT_CODEC_NAME "\",\"frag\":1}");
+
+        // Subscribed from the cache: check it now that events are flowing
+        if (p->validating && !p->service_discovered) {
+            discover_services(p);
+        }
     } else {
-        ESP_LOGE(TAG, "Failed to enable notifications: %d", error->status);
+        ESP_LOGE(TAG, "[%s] Failed to enable notifications: %d", p->name, error->status);
+        ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_SUBSCRIBE, error->status);
+
+        if (p->cache_hit && !p->service_discovered) {
+            ESP_LOGW(TAG, "[%s] Cached GATT handles rejected, rediscovering", p->name);
+            ble_gatt_cache_forget(&p->id_addr);
+            p->cache_hit = false;
+            p->validating = false;
+            discover_services(p);
+        }
     }
     return 0;
 }
 
-static void subscribe_to_notifications(void)
+static void subscribe_to_notifications(ble_peer_t *p)
 {
     uint8_t value[2] = {0x01, 0x00};
 
     uint16_t cccd;
-    if (tx_cccd_handle != 0) {
-        cccd = tx_cccd_handle;
+    if (p->handles.tx_cccd != 0) {
+        cccd = p->handles.tx_cccd;
         ESP_LOGI(TAG, "Using discovered CCCD handle: %d", cccd);
     } else {
-        cccd = tx_char_handle + 1;
+        cccd = p->handles.tx_val + 1;
         ESP_LOGW(TAG, "CCCD not discovered! Assuming handle: %d", cccd);
     }
 
-    ESP_LOGI(TAG, "=== SUBSCRIBING TO NOTIFICATIONS ===");
-    ESP_LOGI(TAG, "TX Char Value Handle: %d", tx_char_handle);
+    ESP_LOGI(TAG, "=== SUBSCRIBING TO NOTIFICATIONS (%s) ===", p->name);
+    ESP_LOGI(TAG, "TX Char Value Handle: %d", p->handles.tx_val);
     ESP_LOGI(TAG, "CCCD Handle: %d", cccd);
 
-    int rc = ble_gattc_write_flat(conn_handle, cccd, value, sizeof(value),
+    int rc = ble_gattc_write_flat(p->conn_handle, cccd, value, sizeof(value),
                                   ble_on_notify, NULL);
     if (rc != 0) {
         ESP_LOGE(TAG, "Failed to subscribe: %d", rc);
+        ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_SUBSCRIBE, rc);
 
-        if (tx_cccd_handle == 0) {
+        if (p->handles.tx_cccd == 0) {
             ESP_LOGI(TAG, "Trying alternative CCCD handle...");
-            cccd = tx_char_handle + 2;
-            rc = ble_gattc_write_flat(conn_handle, cccd, value, sizeof(value),
+            cccd = p->handles.tx_val + 2;
+            rc = ble_gattc_write_flat(p->conn_handle, cccd, value, sizeof(value),
                                       ble_on_notify, NULL);
             if (rc != 0) {
                 ESP_LOGE(TAG, "Alternative subscribe also failed: %d", rc);
@@ -311,11 +1569,56 @@ static void subscribe_to_notifications(void)
     }
 }
 
+// Apply what discovery found. Behind a cache hit, only act if the
+// cached handles turned out to be wrong. Handles are cached only when
+// discovery found everything, CCCD included.
+static void discovery_done(ble_peer_t *p, bool complete)
+{
+    p->service_discovered = true;
+
+    if (p->validating) {
+        p->validating = false;
+
+        if (memcmp(&p->handles, &p->disc, sizeof(p->disc)) == 0) {
+            ESP_LOGI(TAG, "[%s] Cached GATT handles confirmed", p->name);
+            return;
+        }
+        ESP_LOGW(TAG, "[%s] Cached GATT handles stale, resubscribing", p->name);
+        p->handles = p->disc;
+        if (complete) {
+            ble_gatt_cache_store(&p->id_addr, &p->disc);
+        } else {
+            ble_gatt_cache_forget(&p->id_addr);
+        }
+        subscribe_to_notifications(p);
+        return;
+    }
+
+    p->handles = p->disc;
+    if (complete) {
+        ble_gatt_cache_store(&p->id_addr, &p->disc);
+    }
+
+    printf("\n========================================\n");
+    printf("   CONNECTED TO MAX32655 TRACKER %s\n", p->name);
+    printf("   TX Handle: %d, CCCD: %d\n", p->handles.tx_val,
+           p->handles.tx_cccd ? p->handles.tx_cccd : (p->handles.tx_val + 1));
+    printf("   Enabling notifications...\n");
+    printf("========================================\n\n");
+
+    subscribe_to_notifications(p);
+}
+
 static int ble_on_desc_discovery(uint16_t conn_handle,
                                  const struct ble_gatt_error *error,
                                  uint16_t chr_val_handle,
                                  const struct ble_gatt_dsc *dsc, void *arg)
 {
+    ble_peer_t *p = peer_by_conn(conn_handle);
+    if (p == NULL) {
+        return 0;
+    }
+
     if (error->status == 0 && dsc != NULL) {
         char uuid_str[BLE_UUID_STR_LEN];
         ble_uuid_to_str(&dsc->uuid.u, uuid_str);
@@ -323,34 +1626,26 @@ static int ble_on_desc_discovery(uint16_t conn_handle,
         ESP_LOGI(TAG, "Descriptor found: handle=%d, uuid=%s", dsc->handle, uuid_str);
 
         if (ble_uuid_cmp(&dsc->uuid.u, &cccd_uuid.u) == 0) {
-            tx_cccd_handle = dsc->handle;
-            ESP_LOGI(TAG, ">>> Found CCCD at handle %d <<<", tx_cccd_handle);
+            p->disc.tx_cccd = dsc->handle;
+            ESP_LOGI(TAG, ">>> Found CCCD at handle %d <<<", p->disc.tx_cccd);
         }
     }
     else if (error->status == BLE_HS_EDONE) {
         ESP_LOGI(TAG, "Descriptor discovery complete");
-
-        printf("\n========================================\n");
-        printf("   CONNECTED TO MAX32655 TRACKER\n");
-        printf("   TX Handle: %d, CCCD: %d\n", tx_char_handle,
-               tx_cccd_handle ? tx_cccd_handle : (tx_char_handle + 1));
-        printf("   Enabling notifications...\n");
-        printf("========================================\n\n");
-
-        service_discovered = true;
-        subscribe_to_notifications();
+        discovery_done(p, true);
     }
     else {
         ESP_LOGE(TAG, "Descriptor discovery error: %d", error->status);
-        subscribe_to_notifications();
+        ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_DISCOVERY, error->status);
+        discovery_done(p, false);
     }
     return 0;
 }
 
-static void discover_descriptors(void)
+static void discover_descriptors(ble_peer_t *p)
 {
-    uint16_t start = tx_char_handle + 1;
-    uint16_t end = (rx_char_def_handle > 0) ? (rx_char_def_handle - 1) : service_end_handle;
+    uint16_t start = p->disc.tx_val + 1;
+    uint16_t end = (p->disc.rx_def > 0) ? (p->disc.rx_def - 1) : p->disc.svc_end;
 
     if (end < start) {
         end = start;
@@ -358,11 +1653,12 @@ static void discover_descriptors(void)
 
     ESP_LOGI(TAG, "Discovering descriptors (handles %d-%d)...", start, end);
 
-    int rc = ble_gattc_disc_all_dscs(conn_handle, start, end,
+    int rc = ble_gattc_disc_all_dscs(p->conn_handle, start, end,
                                      ble_on_desc_discovery, NULL);
     if (rc != 0) {
         ESP_LOGE(TAG, "Descriptor discovery failed: %d", rc);
-        subscribe_to_notifications();
+        ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_DISCOVERY, rc);
+        discovery_done(p, false);
     }
 }
 
@@ -370,6 +1666,11 @@ static int ble_on_char_discovery(uint16_t conn_handle,
                                  const struct ble_gatt_error *error,
                                  const struct ble_gatt_chr *chr, void *arg)
 {
+    ble_peer_t *p = peer_by_conn(conn_handle);
+    if (p == NULL) {
+        return 0;
+    }
+
     if (error->status == 0 && chr != NULL) {
         char uuid_str[BLE_UUID_STR_LEN];
         ble_uuid_to_str(&chr->uuid.u, uuid_str);
@@ -377,23 +1678,23 @@ static int ble_on_char_discovery(uint16_t conn_handle,
                  chr->def_handle, chr->val_handle, chr->properties, uuid_str);
 
         if (ble_uuid_cmp(&chr->uuid.u, &tx_char_uuid.u) == 0) {
-            tx_char_def_handle = chr->def_handle;
-            tx_char_handle = chr->val_handle;
+            p->disc.tx_def = chr->def_handle;
+            p->disc.tx_val = chr->val_handle;
             ESP_LOGI(TAG, ">>> TX characteristic found");
         }
         else if (ble_uuid_cmp(&chr->uuid.u, &rx_char_uuid.u) == 0) {
-            rx_char_def_handle = chr->def_handle;
-            rx_char_handle = chr->val_handle;
+            p->disc.rx_def = chr->def_handle;
+            p->disc.rx_val = chr->val_handle;
             ESP_LOGI(TAG, ">>> RX characteristic found");
         }
     }
     else if (error->status == BLE_HS_EDONE) {
         ESP_LOGI(TAG, "Characteristic discovery complete");
 
-        if (tx_char_handle != 0) {
-            discover_descriptors();
+        if (p->disc.tx_val != 0) {
+            discover_descriptors(p);
         } else {
-            ESP_LOGE(TAG, "TX characteristic not found!");
+            ESP_LOGE(TAG, "[%s] TX characteristic not found!", p->name);
         }
     }
     return 0;
@@ -403,73 +1704,224 @@ static int ble_on_service_discovery(uint16_t conn_handle,
                                     const struct ble_gatt_error *error,
                                     const struct ble_gatt_svc *service, void *arg)
 {
+    ble_peer_t *p = peer_by_conn(conn_handle);
+    if (p == NULL) {
+        return 0;
+    }
+
     if (error->status == 0 && service != NULL) {
-        service_start_handle = service->start_handle;
-        service_end_handle = service->end_handle;
+        p->disc.svc_start = service->start_handle;
+        p->disc.svc_end = service->end_handle;
 
-        ESP_LOGI(TAG, "Found service (handles %d-%d)", service_start_handle, service_end_handle);
+        ESP_LOGI(TAG, "Found service (handles %d-%d)", p->disc.svc_start, p->disc.svc_end);
 
         int rc = ble_gattc_disc_all_chrs(conn_handle,
-                                         service_start_handle,
-                                         service_end_handle,
+                                         p->disc.svc_start,
+                                         p->disc.svc_end,
                                          ble_on_char_discovery, NULL);
         if (rc != 0) {
             ESP_LOGE(TAG, "Char discovery failed: %d", rc);
+            ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_DISCOVERY, rc);
         }
     }
     else if (error->status == BLE_HS_EDONE) {
-        if (service_start_handle == 0) {
-            ESP_LOGE(TAG, "Service not found!");
+        if (p->disc.svc_start == 0) {
+            ESP_LOGE(TAG, "[%s] Service not found!", p->name);
+            if (p->validating) {
+                ble_gatt_cache_forget(&p->id_addr);
+                p->validating = false;
+            }
         }
     }
     return 0;
 }
 
-static void discover_services(void)
+static void discover_services(ble_peer_t *p)
 {
-    ESP_LOGI(TAG, "Discovering services...");
+    ESP_LOGI(TAG, "[%s] Discovering services...", p->name);
+    memset(&p->disc, 0, sizeof(p->disc));
 
-    int rc = ble_gattc_disc_svc_by_uuid(conn_handle, &service_uuid.u,
+    int rc = ble_gattc_disc_svc_by_uuid(p->conn_handle, &service_uuid.u,
                                         ble_on_service_discovery, NULL);
     if (rc != 0) {
         ESP_LOGE(TAG, "Service discovery failed: %d", rc);
+        ble_telemetry_att_error(peer_index(p), BLE_TLM_ATT_DISCOVERY, rc);
     }
 }
 
+// A free slot takes the new connection; returns NULL when all are in use
+static ble_peer_t *peer_connect(uint16_t conn_handle)
+{
+    ble_peer_t *p = NULL;
+    for (int i = 0; i < BLE_MAX_PEERS && p == NULL; i++) {
+        if (!peers[i].connected) {
+            p = &peers[i];
+        }
+    }
+    if (p == NULL) {
+        return NULL;
+    }
+
+    p->conn_handle = conn_handle;
+    p->connected = true;
+    p->mtu_exchanged = false;
+    p->service_discovered = false;
+    p->cache_hit = false;
+    p->validating = false;
+    memset(&p->handles, 0, sizeof(p->handles));
+    p->connect_us = esp_timer_get_time();
+    p->first_notify_pending = true;
+    p->binary.store(false, std::memory_order_relaxed);
+    p->frag.store(false, std::memory_order_relaxed);
+    p->mtu.store(BLE_ATT_MTU_DFLT, std::memory_order_relaxed);
+    p->att_pending.store(false, std::memory_order_relaxed);
+    p->generation.fetch_add(1, std::memory_order_relaxed);
+    return p;
+}
+
+static void peer_disconnect(ble_peer_t *p)
+{
+    p->connected = false;
+    p->conn_handle = BLE_HS_CONN_HANDLE_NONE;
+    p->service_discovered = false;
+    p->mtu_exchanged = false;
+    p->cache_hit = false;
+    p->validating = false;
+    p->first_notify_pending = false;
+    p->binary.store(false, std::memory_order_relaxed);
+    p->frag.store(false, std::memory_order_relaxed);
+    p->att_pending.store(false, std::memory_order_release);
+    memset(&p->handles, 0, sizeof(p->handles));
+    tx_wake();
+}
+
+static void on_connected(uint16_t conn_handle)
+{
+    ble_peer_t *p = peer_connect(conn_handle);
+    if (p == NULL) {
+        ESP_LOGW(TAG, "No free tracker slot, dropping connection %d", conn_handle);
+        ble_gap_terminate(conn_handle, BLE_ERR_REM_USER_CONN_TERM);
+        return;
+    }
+
+    struct ble_gap_conn_desc desc;
+    ble_gatt_handles_t cached;
+    if (ble_gap_conn_find(conn_handle, &desc) == 0) {
+        p->id_addr = desc.peer_id_addr;
+        p->ota_addr = desc.peer_ota_addr;
+        snprintf(p->name, sizeof(p->name), "%02x%02x%02x",
+                 desc.peer_ota_addr.val[2], desc.peer_ota_addr.val[1], desc.peer_ota_addr.val[0]);
+        p->cache_hit = ble_gatt_cache_load(&p->id_addr, &cached);
+        remember_peer(&desc.peer_ota_addr);
+        note_conn_itvl(p, desc.conn_itvl);
+    }
+
+    printf("\n========================================\n");
+    printf("   CONNECTED TO MAX32655 %s!\n", p->name);
+    printf("   Connection Handle: %d (%d/%d trackers)\n", conn_handle,
+           connected_count(), BLE_MAX_PEERS);
+    printf("========================================\n\n");
+
+    note_reconnect(p);
+    ble_telemetry_connected(peer_index(p), p->name, p->connect_us);
+
+    exchange_mtu(p);
+
+    if (p->cache_hit) {
+        // Subscribe at once; discovery re-checks the handles after
+        ESP_LOGI(TAG, "[%s] Using cached GATT handles (TX %d, CCCD %d, RX %d)",
+                 p->name, cached.tx_val, cached.tx_cccd, cached.rx_val);
+        p->handles = cached;
+        p->validating = true;
+        subscribe_to_notifications(p);
+    } else {
+        // Straight after the MTU request, as the cached path subscribes
+        discover_services(p);
+    }
+}
+
+// Move on from the stage that just ended. A direct connect walks through
+// every known tracker that is not connected before giving way to the scans.
+static void find_next(void)
+{
+    ble_addr_t absent[BLE_MAX_PEERS];
+
+    find_state = FIND_IDLE;
+    if (find_stage == FIND_DIRECT && ++direct_next < absent_known_peers(absent)) {
+        find_peer(FIND_DIRECT);
+        return;
+    }
+    direct_next = 0;
+    if (find_stage == FIND_NAME) {
+        ESP_LOGI(TAG, "No tracker found, looking again in %lu ms", (unsigned long)find_pause_ms);
+        ble_npl_callout_reset(&find_retry, ble_npl_time_ms_to_ticks32(find_pause_ms));
+        find_pause_ms = find_pause_ms * 2 > FIND_PAUSE_MAX_MS ? FIND_PAUSE_MAX_MS
+                                                             : find_pause_ms * 2;
+        return;
+    }
+    find_peer((find_stage_t)(find_stage + 1));
+}
+
+// Initiator scan for a connect: NimBLE's full duty default while nothing
+// is connected, the scans' low duty cycle once a tracker is
+static const struct ble_gap_conn_params *find_conn_params(void)
+{
+    static struct ble_gap_conn_params params;
+
+    if (connected_count() == 0) {
+        return NULL;
+    }
+    const ble_conn_params_t *cp = ble_conn_policy_params(BLE_CONN_NORMAL);
+    params.scan_itvl = 0x0100;
+    params.scan_window = 0x0010;
+    params.itvl_min = cp->itvl_min;
+    params.itvl_max = cp->itvl_max;
+    params.latency = cp->latency;
+    params.supervision_timeout = cp->timeout;
+    params.min_ce_len = 0;
+    params.max_ce_len = 0;
+    return &params;
+}
+
 static int ble_gap_event(struct ble_gap_event *event, void *arg)
 {
     switch (event->type) {
     case BLE_GAP_EVENT_DISC:
     {
-        struct ble_hs_adv_fields fields;
-        int rc = ble_hs_adv_parse_fields(&fields, event->disc.data,
-                                         event->disc.length_data);
-        if (rc != 0)
+        // The accept list already filtered by address; only the name
+        // scan has to look inside the advertisement
+        if (find_state != FIND_SCANNING || addr_connected(&event->disc.addr)) {
             return 0;
+        }
+        if (find_stage == FIND_NAME) {
+            struct ble_hs_adv_fields fields;
+            int rc = ble_hs_adv_parse_fields(&fields, event->disc.data,
+                                             event->disc.length_data);
+            if (rc != 0 || fields.name == NULL ||
+                fields.name_len != strlen(TARGET_DEVICE_NAME) ||
+                memcmp(fields.name, TARGET_DEVICE_NAME, fields.name_len) != 0)
+                return 0;
+        }
 
-        if (fields.name != NULL && fields.name_len > 0) {
-            if (fields.name_len == strlen(TARGET_DEVICE_NAME) &&
-                memcmp(fields.name, TARGET_DEVICE_NAME, fields.name_len) == 0) {
-                ESP_LOGI(TAG, "Found MAX32655! Connecting...");
-                ble_gap_disc_cancel();
-
-                rc = ble_gap_connect(BLE_OWN_ADDR_PUBLIC, &event->disc.addr,
-                                     30000, NULL, ble_gap_event, NULL);
-                if (rc != 0) {
-                    ESP_LOGE(TAG, "Connect failed: %d", rc);
-                    ble_app_scan();
-                }
-            }
+        ESP_LOGI(TAG, "Found MAX32655 (%s)! Connecting...", find_stage_names[find_stage]);
+        ble_gap_disc_cancel();
+
+        find_state = FIND_CONNECTING;
+        int rc = ble_gap_connect(BLE_OWN_ADDR_PUBLIC, &event->disc.addr,
+                                 30000, find_conn_params(), ble_gap_event, NULL);
+        if (rc != 0) {
+            ESP_LOGE(TAG, "Connect failed: %d", rc);
+            ble_telemetry_gap_error(BLE_TLM_GAP_FIND, rc);
+            find_next();
         }
         return 0;
     }
 
     case BLE_GAP_EVENT_DISC_COMPLETE:
     {
-        if (!connected) {
-            ESP_LOGI(TAG, "Scan complete, retrying...");
-            vTaskDelay(pdMS_TO_TICKS(2000));
-            ble_app_scan();
+        if (find_state == FIND_SCANNING) {
+            ESP_LOGI(TAG, "%s found nothing", find_stage_names[find_stage]);
+            find_next();
         }
         return 0;
     }
@@ -477,101 +1929,204 @@ static int ble_gap_event(struct ble_gap_event *event, void *arg)
     case BLE_GAP_EVENT_CONNECT:
     {
         if (event->connect.status == 0) {
-            conn_handle = event->connect.conn_handle;
-            connected = true;
-            mtu_exchanged = false;
-
-            printf("\n========================================\n");
-            printf("   CONNECTED TO MAX32655!\n");
-            printf("   Connection Handle: %d\n", conn_handle);
-            printf("========================================\n\n");
-
-            request_conn_params_update();
-            exchange_mtu();
-            vTaskDelay(pdMS_TO_TICKS(100));
-            discover_services();
+            on_connected(event->connect.conn_handle);
+
+            // Keep looking while there are slots left
+            find_pause_ms = FIND_PAUSE_MS;
+            find_state = FIND_IDLE;
+            direct_next = 0;
+            find_peer(FIND_DIRECT);
         } else {
-            ESP_LOGE(TAG, "Connection failed: %d", event->connect.status);
-            connected = false;
-            ble_app_scan();
+            ESP_LOGE(TAG, "Connection failed (%s): %d",
+                     find_stage_names[find_stage], event->connect.status);
+            ble_telemetry_gap_error(BLE_TLM_GAP_CONNECT, event->connect.status);
+            find_next();
         }
         return 0;
     }
 
     case BLE_GAP_EVENT_DISCONNECT:
     {
-        printf("\n!!! BLE DISCONNECTED (reason: %d) - Reconnecting...\n\n",
-               event->disconnect.reason);
-
-        hr_session_cancel();
-        connected = false;
-        service_discovered = false;
-        mtu_exchanged = false;
-        conn_handle = BLE_HS_CONN_HANDLE_NONE;
-        tx_char_handle = 0;
-        tx_char_def_handle = 0;
-        tx_cccd_handle = 0;
-        rx_char_handle = 0;
-        rx_char_def_handle = 0;
-        service_start_handle = 0;
-        service_end_handle = 0;
-
-        vTaskDelay(pdMS_TO_TICKS(500));
-        ble_app_scan();
+        ble_peer_t *p = peer_by_conn(event->disconnect.conn.conn_handle);
+        if (p == NULL) {
+            return 0;
+        }
+
+        printf("\n!!! BLE DISCONNECTED %s (reason: %d) - Reconnecting...\n\n",
+               p->name, event->disconnect.reason);
+
+        note_link_lost(&p->ota_addr);
+        ble_telemetry_disconnected(peer_index(p), event->disconnect.reason);
+        hr_session_cancel(peer_index(p));
+        peer_disconnect(p);
+
+        find_pause_ms = FIND_PAUSE_MS;
+        if (find_state == FIND_IDLE) {
+            ble_app_scan();
+        }
         return 0;
     }
 
     case BLE_GAP_EVENT_NOTIFY_RX:
     {
-        uint16_t attr_handle = event->notify_rx.attr_handle;
-        uint16_t len = OS_MBUF_PKTLEN(event->notify_rx.om);
-
-        ESP_LOGI(TAG, "Notification received: handle=%d, len=%d", attr_handle, len);
+        ble_peer_t *p = peer_by_conn(event->notify_rx.conn_handle);
+        if (p == NULL) {
+            return 0;
+        }
 
-        if (len > 0 && len < 512) {
-            char buffer[512];
-            int rc = os_mbuf_copydata(event->notify_rx.om, 0, len, buffer);
-            if (rc == 0) {
-                buffer[len] = '\0';
-                process_workout_event(buffer, len);
-            }
+        // Take the mbuf: NimBLE frees it after this callback unless om is
+        // cleared; the worker releases it once parsed
+        struct os_mbuf *om = event->notify_rx.om;
+        event->notify_rx.om = NULL;
+        enqueue_notification(p, event->notify_rx.attr_handle, om);
+        if (p->first_notify_pending) {
+            note_first_notification(p);
         }
         return 0;
     }
 
     case BLE_GAP_EVENT_MTU:
-        ESP_LOGI(TAG, "MTU updated: %d", event->mtu.value);
+    {
+        ble_peer_t *p = peer_by_conn(event->mtu.conn_handle);
+        if (p != NULL) {
+            ESP_LOGI(TAG, "[%s] MTU updated: %d", p->name, event->mtu.value);
+            p->mtu.store(event->mtu.value, std::memory_order_relaxed);
+        }
         return 0;
+    }
 
     case BLE_GAP_EVENT_CONN_UPDATE:
-        ESP_LOGI(TAG, "Connection params updated");
+    {
+        ble_peer_t *p = peer_by_conn(event->conn_update.conn_handle);
+        struct ble_gap_conn_desc desc;
+        if (p == NULL) {
+            return 0;
+        }
+        if (event->conn_update.status != 0) {
+            ESP_LOGW(TAG, "[%s] Connection param update failed: %d",
+                     p->name, event->conn_update.status);
+            ble_telemetry_gap_error(BLE_TLM_GAP_UPDATE, event->conn_update.status);
+        } else if (ble_gap_conn_find(event->conn_update.conn_handle, &desc) == 0) {
+            note_conn_itvl(p, desc.conn_itvl);
+            ESP_LOGI(TAG, "[%s] Connection params updated: interval %u.%02u ms, latency %u, "
+                          "timeout %u ms", p->name,
+                     (unsigned)(desc.conn_itvl * 125 / 100), (unsigned)(desc.conn_itvl * 125 % 100),
+                     (unsigned)desc.conn_latency, (unsigned)desc.supervision_timeout * 10);
+        }
+        p->update_status.store(event->conn_update.status, std::memory_order_relaxed);
+        p->update_results.fetch_add(1, std::memory_order_release);
         return 0;
+    }
 
     default:
         return 0;
     }
 }
 
-static void ble_app_scan(void)
+// Start one stage of finding trackers; stages past the last wrap round
+// to the first. Each ends in a CONNECT or DISC_COMPLETE event that moves
+// on to the next, with a pause only after the name scan. Stops once every
+// slot is in use; a disconnect starts it again. If not even the name scan
+// can start, the find_retry callout starts over after a backoff.
+static void find_peer(find_stage_t stage)
 {
+    ble_addr_t absent[BLE_MAX_PEERS];
+    int n_absent = absent_known_peers(absent);
+    int connected = connected_count();
+
+    find_state = FIND_IDLE;
+    if (connected == BLE_MAX_PEERS) {
+        ESP_LOGI(TAG, "All %d tracker slots in use", BLE_MAX_PEERS);
+        return;
+    }
+
+    if (stage >= FIND_STAGES) {
+        stage = FIND_DIRECT;
+    }
+    if (n_absent == 0) {
+        stage = FIND_NAME;
+    }
+    find_stage = stage;
+
     struct ble_gap_disc_params disc_params = {
         .itvl = 0x0050,
         .window = 0x0030,
-        .filter_policy = 0,
+        .filter_policy = BLE_HCI_SCAN_FILT_NO_WL,
         .limited = 0,
         .passive = 0,
         .filter_duplicates = 1,
     };
+    if (connected > 0) {
+        // 10 ms in 160 ms, leaving the radio to the links we have
+        disc_params.itvl = 0x0100;
+        disc_params.window = 0x0010;
+    }
+    int rc;
+
+    switch (stage) {
+    case FIND_DIRECT:
+        ESP_LOGI(TAG, "Connecting to known MAX32655 (%d of %d)...",
+                 direct_next % n_absent + 1, n_absent);
+        find_state = FIND_CONNECTING;
+        rc = ble_gap_connect(BLE_OWN_ADDR_PUBLIC, &absent[direct_next % n_absent],
+                             DIRECT_CONNECT_MS, find_conn_params(), ble_gap_event, NULL);
+        break;
+
+    case FIND_ACCEPT_LIST:
+        ESP_LOGI(TAG, "Scanning for %d known MAX32655...", n_absent);
+        find_state = FIND_SCANNING;
+        rc = ble_gap_wl_set(absent, (uint8_t)n_absent);
+        if (rc == 0) {
+            // Address match only, so no scan requests needed
+            disc_params.filter_policy = BLE_HCI_SCAN_FILT_USE_WL;
+            disc_params.passive = 1;
+            rc = ble_gap_disc(BLE_OWN_ADDR_PUBLIC, ACCEPT_SCAN_MS, &disc_params,
+                              ble_gap_event, NULL);
+        }
+        break;
 
-    ESP_LOGI(TAG, "Scanning for MAX32655...");
-
-    int rc = ble_gap_disc(BLE_OWN_ADDR_PUBLIC, 30000, &disc_params,
+    default:
+        ESP_LOGI(TAG, "Scanning for MAX32655 (%d/%d connected)...", connected, BLE_MAX_PEERS);
+        find_state = FIND_SCANNING;
+        rc = ble_gap_disc(BLE_OWN_ADDR_PUBLIC, NAME_SCAN_MS, &disc_params,
                           ble_gap_event, NULL);
+        break;
+    }
+
     if (rc != 0) {
-        ESP_LOGE(TAG, "Scan failed: %d", rc);
+        ESP_LOGE(TAG, "%s failed: %d", find_stage_names[stage], rc);
+        ble_telemetry_gap_error(BLE_TLM_GAP_FIND, rc);
+        find_state = FIND_IDLE;
+        if (stage != FIND_NAME) {
+            find_next();
+        } else {
+            // Every stage has had its turn; come back round later
+            ESP_LOGW(TAG, "Finding trackers again in %lu ms", (unsigned long)find_retry_ms);
+            ble_npl_callout_reset(&find_retry, ble_npl_time_ms_to_ticks32(find_retry_ms));
+            find_retry_ms = find_retry_ms * 2 > FIND_RETRY_MAX_MS ? FIND_RETRY_MAX_MS
+                                                                 : find_retry_ms * 2;
+        }
+    } else {
+        find_retry_ms = FIND_RETRY_MS;
+    }
+}
+
+// Host task, after a stage could not start or between cycles. A
+// disconnect may have started finding again in the meantime.
+static void find_retry_cb(struct ble_npl_event *ev)
+{
+    if (find_state == FIND_IDLE) {
+        ble_app_scan();
     }
 }
 
+static void ble_app_scan(void)
+{
+    ble_npl_callout_stop(&find_retry);
+    direct_next = 0;
+    find_peer(FIND_DIRECT);
+}
+
 static void ble_host_task(void *param)
 {
     ESP_LOGI(TAG, "BLE Host Task Started");
@@ -588,6 +2143,9 @@ static void ble_on_sync(void)
     }
 
     ble_svc_gap_device_name_set("ESP32-WorkoutRx");
+
+    known_count = ble_gatt_cache_load_peers(known_peers, BLE_MAX_PEERS);
+    ESP_LOGI(TAG, "%d known trackers, %d slots", known_count, BLE_MAX_PEERS);
     ble_app_scan();
 }
 
@@ -600,11 +2158,30 @@ void ble_client_init(void)
 {
     ESP_LOGI(TAG, "Initializing BLE client...");
 
+    for (int i = 0; i < BLE_MAX_PEERS; i++) {
+        peers[i].conn_handle = BLE_HS_CONN_HANDLE_NONE;
+        peers[i].mtu.store(BLE_ATT_MTU_DFLT, std::memory_order_relaxed);
+        peers[i].itvl_ms.store(30, std::memory_order_relaxed);
+        peers[i].tx_credits = TX_CREDITS;
+        snprintf(peers[i].name, sizeof(peers[i].name), "slot%d", i);
+    }
+
+    if (!rx_worker_init() || !tx_worker_init()) {
+        return;
+    }
+
     esp_err_t ret = nimble_port_init();
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "NimBLE init failed: %s", esp_err_to_name(ret));
         return;
     }
+    ble_npl_callout_init(&find_retry, nimble_port_get_dflt_eventq(), find_retry_cb, NULL);
+
+    uint32_t service_hash = BLE_GATT_CACHE_FNV_SEED;
+    service_hash = ble_gatt_cache_fnv1a(service_hash, service_uuid.value, sizeof(service_uuid.value));
+    service_hash = ble_gatt_cache_fnv1a(service_hash, tx_char_uuid.value, sizeof(tx_char_uuid.value));
+    service_hash = ble_gatt_cache_fnv1a(service_hash, rx_char_uuid.value, sizeof(rx_char_uuid.value));
+    ble_gatt_cache_init(service_hash);
 
     ble_hs_cfg.reset_cb = ble_on_reset;
     ble_hs_cfg.sync_cb = ble_on_sync;
@@ -615,12 +2192,27 @@ void ble_client_init(void)
     ble_svc_gap_init();
     nimble_port_freertos_init(ble_host_task);
 
-    ESP_LOGI(TAG, "BLE client initialized");
+    ESP_LOGI(TAG, "BLE client initialized (%d tracker slots)", BLE_MAX_PEERS);
 }
 
 bool ble_client_is_connected(void)
 {
-    return connected;
+    return connected_count() > 0;
+}
+
+int ble_client_connected_count(void)
+{
+    return connected_count();
+}
+
+bool ble_client_peer_connected(uint8_t peer)
+{
+    return peer < BLE_MAX_PEERS && peers[peer].connected;
+}
+
+const char *ble_client_peer_name(uint8_t peer)
+{
+    return peer < BLE_MAX_PEERS ? peers[peer].name : "?";
 }
 
 void ble_client_set_workout_callback(ble_workout_callback_t callback)
@@ -628,21 +2220,48 @@ void ble_client_set_workout_callback(ble_workout_callback_t callback)
     workout_callback = callback;
 }
 
-bool ble_client_send_message(const char *msg)
+bool ble_client_peer_binary(uint8_t peer)
 {
-    if (!connected || rx_char_handle == 0 || msg == NULL) {
-        ESP_LOGW(TAG, "BLE TX not ready");
-        return false;
+    return peer < BLE_MAX_PEERS && peers[peer].binary.load(std::memory_order_relaxed);
+}
+
+size_t ble_client_peer_max_message(uint8_t peer)
+{
+    if (!ble_client_peer_connected(peer)) {
+        return 0;
+    }
+    if (peers[peer].frag.load(std::memory_order_relaxed)) {
+        return TX_MSG_MAX;
     }
+    return peers[peer].mtu.load(std::memory_order_relaxed) - 3;
+}
 
-    int rc = ble_gattc_write_flat(conn_handle, rx_char_handle,
-                                  msg, strlen(msg),
-                                  NULL, NULL);
-    if (rc != 0) {
-        ESP_LOGE(TAG, "Write failed: %d", rc);
+void ble_client_get_tx_stats(ble_tx_stats_t *out)
+{
+    *out = tx_stats;
+    out->queued = tx_queued.load(std::memory_order_relaxed);
+    out->dropped_full = tx_dropped_full.load(std::memory_order_relaxed);
+    out->dropped_size += tx_dropped_size.load(std::memory_order_relaxed);
+    out->depth_max = tx_depth_max.load(std::memory_order_relaxed);
+    out->depth = tx_free_queue ? TX_QUEUE_LEN - uxQueueMessagesWaiting(tx_free_queue) : 0;
+}
+
+bool ble_client_send_data(uint8_t peer, const uint8_t *data, size_t len)
+{
+    return enqueue_tx(peer, data, len, false);
+}
+
+bool ble_client_send_acked(uint8_t peer, const uint8_t *data, size_t len)
+{
+    return enqueue_tx(peer, data, len, true);
+}
+
+bool ble_client_send_message(uint8_t peer, const char *msg)
+{
+    if (msg == NULL || !enqueue_tx(peer, (const uint8_t *)msg, strlen(msg), false)) {
         return false;
     }
 
-    ESP_LOGI(TAG, "TX → MAX: %s", msg);
+    ESP_LOGI(TAG, "TX → %s: %s", ble_client_peer_name(peer), msg);
     return true;
 }
@@ -3,26 +3,76 @@
 #define BLE_CLIENT_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// Callback type for workout data
-typedef void (*ble_workout_callback_t)(const char* json_data, uint16_t len);
+// Trackers served at once; each gets a slot, and the slot index is the
+// peer argument below
+#define BLE_MAX_PEERS 4
+
+// Callback type for workout data; json_data is len bytes and is not
+// NUL-terminated (it points into the received notification)
+typedef void (*ble_workout_callback_t)(uint8_t peer, const char* json_data, uint16_t len);
 
 // Initialize NimBLE BLE client
 void ble_client_init(void);
 
-// Check if connected to MAX32655
+// Check if connected to at least one MAX32655
 bool ble_client_is_connected(void);
 
+int ble_client_connected_count(void);
+bool ble_client_peer_connected(uint8_t peer);
+
+// Last three address bytes in hex, also the tracker's MQTT topic; the
+// slot name until it first connects
+const char *ble_client_peer_name(uint8_t peer);
+
 // Set callback for workout data (optional, MQTT publish is automatic)
 void ble_client_set_workout_callback(ble_workout_callback_t callback);
 
-// Send JSON message to MAX (writes RX characteristic), returns true on success
-bool ble_client_send_message(const char *msg);
+// Outbound queue counters, all trackers together, see ble_client_get_tx_stats()
+typedef struct {
+    uint32_t queued;        // Messages accepted by a send call
+    uint32_t handled;       // Messages the TX worker has finished with
+    uint32_t sent;          // Written in full (and answered, if acked)
+    uint32_t packets;       // ATT writes, fragments included
+    uint32_t bytes;         // ATT payload bytes written
+    uint32_t dropped_full;  // Queue full
+    uint32_t dropped_size;  // Too long to queue or to send unfragmented
+    uint32_t dropped_link;  // Disconnect, write error, stall or no response
+    uint32_t stalls;        // Waits for controller buffers
+    uint32_t acked;
+    uint32_t ack_failed;
+    uint32_t ack_retries;
+    uint32_t ack_max_us;    // Longest write request to response
+    uint32_t depth;         // Messages queued or being sent now
+    uint32_t depth_max;
+    uint32_t max_queued_us; // Longest wait before the worker took one
+} ble_tx_stats_t;
+
+// Queue a JSON message for the MAX (written to the RX characteristic).
+// Returns true once queued; writes happen in order on the TX worker.
+bool ble_client_send_message(uint8_t peer, const char *msg);
+
+// Queue raw bytes for the MAX, e.g. a binary workout_codec frame
+bool ble_client_send_data(uint8_t peer, const uint8_t *data, size_t len);
+
+// As ble_client_send_data, but the last packet is a write request and
+// the MAX's response is waited for (and the write retried if rejected)
+bool ble_client_send_acked(uint8_t peer, const uint8_t *data, size_t len);
+
+void ble_client_get_tx_stats(ble_tx_stats_t *out);
+
+// True once the MAX has accepted binary framing for this connection
+bool ble_client_peer_binary(uint8_t peer);
+
+// Longest message the MAX can take: one ATT payload at the current MTU,
+// or the TX limit once it reassembles fragments; 0 when not connected
+size_t ble_client_peer_max_message(uint8_t peer);
 
 #ifdef __cplusplus
 }
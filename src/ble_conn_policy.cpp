@@ -0,0 +1,151 @@
+#include "ble_conn_policy.h"
+
+#include <string.h>
+
+#define RATE_WINDOW_MS     4000
+#define RATE_BUSY_PER_S    1        // NORMAL at or above this without a workout
+#define RATE_BURST_PER_S   5        // ACTIVE at or above this regardless
+#define DWELL_MS           10000    // Between rate driven requests
+#define PENDING_MS         10000    // Give up waiting for an update result
+#define REJECT_HOLDOFF_MS  60000
+
+static const ble_conn_params_t profiles[BLE_CONN_PROFILES] = {
+    { 80, 120, 4, 600 },    // IDLE: 100-150 ms, 6 s supervision
+    { 12, 24, 0, 400 },     // NORMAL: 15-30 ms, 4 s
+    { 6, 12, 0, 400 },      // ACTIVE: 7.5-15 ms, 4 s
+};
+
+static const char *const profile_names[BLE_CONN_PROFILES] = {
+    "idle", "normal", "active"
+};
+
+const ble_conn_params_t *ble_conn_policy_params(ble_conn_profile_t profile)
+{
+    return &profiles[profile];
+}
+
+const char *ble_conn_policy_name(ble_conn_profile_t profile)
+{
+    return profile < BLE_CONN_PROFILES ? profile_names[profile] : "?";
+}
+
+void ble_conn_policy_reset(ble_conn_policy_t *p, uint32_t now_ms)
+{
+    p->pending = false;
+    p->urgent = false;
+    p->have_requested = false;
+    p->requested = BLE_CONN_NORMAL;
+    p->current = BLE_CONN_NORMAL;
+    memset(p->rejected, 0, sizeof(p->rejected));
+    p->window_start_ms = now_ms;
+    p->window_count = 0;
+    p->rate_per_s = RATE_BUSY_PER_S;    // NORMAL until the first window is in
+}
+
+void ble_conn_policy_workout(ble_conn_policy_t *p, bool active)
+{
+    if (p->workout == active) {
+        return;
+    }
+    p->workout = active;
+
+    // The end of a workout is the end of its traffic; do not wait a
+    // window to see the rate fall
+    if (!active) {
+        p->window_count = 0;
+        p->rate_per_s = 0;
+    }
+
+    // Workout changes skip the dwell
+    p->urgent = true;
+}
+
+static void roll_window(ble_conn_policy_t *p, uint32_t now_ms)
+{
+    uint32_t elapsed = now_ms - p->window_start_ms;
+    if (elapsed >= RATE_WINDOW_MS) {
+        p->rate_per_s = (uint32_t)((uint64_t)p->window_count * 1000 / elapsed);
+        p->window_count = 0;
+        p->window_start_ms = now_ms;
+    }
+}
+
+void ble_conn_policy_notify(ble_conn_policy_t *p, int64_t now_us)
+{
+    roll_window(p, (uint32_t)(now_us / 1000));
+    p->window_count++;
+}
+
+static ble_conn_profile_t desired(const ble_conn_policy_t *p, uint32_t now_ms)
+{
+    ble_conn_profile_t want;
+
+    if (p->workout || p->rate_per_s >= RATE_BURST_PER_S) {
+        want = BLE_CONN_ACTIVE;
+    } else if (p->rate_per_s >= RATE_BUSY_PER_S) {
+        want = BLE_CONN_NORMAL;
+    } else {
+        want = BLE_CONN_IDLE;
+    }
+
+    // Fall back to NORMAL while the MAX is refusing what we would like
+    if (p->rejected[want] && now_ms - p->rejected_ms[want] < REJECT_HOLDOFF_MS) {
+        want = BLE_CONN_NORMAL;
+    }
+    return want;
+}
+
+bool ble_conn_policy_poll(ble_conn_policy_t *p, uint32_t now_ms, ble_conn_profile_t *out)
+{
+    roll_window(p, now_ms);
+
+    if (p->pending) {
+        if (now_ms - p->requested_ms < PENDING_MS) {
+            return false;
+        }
+        p->pending = false;
+        p->requested = p->current;
+    }
+
+    ble_conn_profile_t want = desired(p, now_ms);
+    if (p->have_requested) {
+        if (want == p->requested) {
+            p->urgent = false;
+            return false;
+        }
+        if (!p->urgent && now_ms - p->requested_ms < DWELL_MS) {
+            return false;
+        }
+    }
+
+    *out = want;
+    return true;
+}
+
+void ble_conn_policy_requested(ble_conn_policy_t *p, ble_conn_profile_t profile, uint32_t now_ms)
+{
+    p->pending = true;
+    p->urgent = false;
+    p->have_requested = true;
+    p->requested = profile;
+    p->requested_ms = now_ms;
+    p->requests[profile]++;
+}
+
+void ble_conn_policy_result(ble_conn_policy_t *p, bool accepted, uint32_t now_ms)
+{
+    if (!p->pending) {
+        return;
+    }
+    p->pending = false;
+
+    if (accepted) {
+        p->current = p->requested;
+        p->rejected[p->requested] = false;
+    } else {
+        p->rejected[p->requested] = true;
+        p->rejected_ms[p->requested] = now_ms;
+        p->rejects[p->requested]++;
+        p->requested = p->current;
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef BLE_CONN_POLICY_H
+#define BLE_CONN_POLICY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Connection parameters chosen from what the link is doing.
+ *
+ *   ACTIVE  7.5-15 ms, no latency       workout running, or a burst of traffic
+ *   NORMAL  15-30 ms, no latency        connected, traffic but no workout
+ *   IDLE    100-150 ms, latency 4       no workout and quiet for a while
+ *
+ * A workout start or end moves straight to its profile. Rate driven
+ * moves wait out a dwell time since the last request, and a profile the
+ * MAX rejected is not asked for again for a while. The policy only
+ * decides; the caller issues the update and reports how it went.
+ * Notification inter-arrival times per profile are kept by ble_telemetry.
+ */
+
+typedef enum {
+    BLE_CONN_IDLE = 0,
+    BLE_CONN_NORMAL,
+    BLE_CONN_ACTIVE,
+    BLE_CONN_PROFILES
+} ble_conn_profile_t;
+
+typedef struct {
+    uint16_t itvl_min;      /* Units of 1.25 ms */
+    uint16_t itvl_max;
+    uint16_t latency;       /* Connection events the MAX may skip */
+    uint16_t timeout;       /* Units of 10 ms */
+} ble_conn_params_t;
+
+typedef struct {
+    bool workout;
+    bool pending;               /* Update requested, no result yet */
+    bool urgent;                /* Workout changed: skip the dwell */
+    bool have_requested;
+    ble_conn_profile_t requested;
+    ble_conn_profile_t current; /* Last one the MAX accepted */
+    uint32_t requested_ms;
+    uint32_t rejected_ms[BLE_CONN_PROFILES];
+    bool rejected[BLE_CONN_PROFILES];
+
+    /* Notification rate over the current window */
+    uint32_t window_start_ms;
+    uint32_t window_count;
+    uint32_t rate_per_s;        /* From the last full window */
+
+    uint32_t requests[BLE_CONN_PROFILES];
+    uint32_t rejects[BLE_CONN_PROFILES];
+} ble_conn_policy_t;
+
+const ble_conn_params_t *ble_conn_policy_params(ble_conn_profile_t profile);
+const char *ble_conn_policy_name(ble_conn_profile_t profile);
+
+/* Start over for a new connection; the workout state is kept */
+void ble_conn_policy_reset(ble_conn_policy_t *p, uint32_t now_ms);
+
+void ble_conn_policy_workout(ble_conn_policy_t *p, bool active);
+
+/* A notification arrived at now_us (esp_timer time) */
+void ble_conn_policy_notify(ble_conn_policy_t *p, int64_t now_us);
+
+/*
+ * Returns true with *out set when a different profile should be asked
+ * for now; follow with ble_conn_policy_requested() once it is.
+ */
+bool ble_conn_policy_poll(ble_conn_policy_t *p, uint32_t now_ms, ble_conn_profile_t *out);
+
+void ble_conn_policy_requested(ble_conn_policy_t *p, ble_conn_profile_t profile, uint32_t now_ms);
+
+/* Outcome of the last request, from the connection update event */
+void ble_conn_policy_result(ble_conn_policy_t *p, bool accepted, uint32_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLE_CONN_POLICY_H */
@@ -0,0 +1,140 @@
+#include "ble_frag.h"
+
+#include <string.h>
+
+void ble_frag_rx_init(ble_frag_rx_t *rx, uint8_t *buf, size_t cap)
+{
+    memset(rx, 0, sizeof(*rx));
+    rx->buf = buf;
+    rx->cap = cap;
+}
+
+void ble_frag_rx_reset(ble_frag_rx_t *rx)
+{
+    rx->len = 0;
+    rx->total = 0;
+    rx->synced = false;
+    rx->active = false;
+}
+
+bool ble_frag_is_fragment(const uint8_t *data, size_t len)
+{
+    return len >= BLE_FRAG_HDR_LEN && data[0] == BLE_FRAG_MAGIC;
+}
+
+static void abandon(ble_frag_rx_t *rx)
+{
+    if (rx->active) {
+        rx->aborted++;
+    }
+    rx->active = false;
+    rx->len = 0;
+}
+
+bool ble_frag_rx_push(ble_frag_rx_t *rx, const uint8_t *data, size_t len,
+                      const uint8_t **msg, size_t *msg_len)
+{
+    if (!ble_frag_is_fragment(data, len)) {
+        rx->malformed++;
+        return false;
+    }
+
+    uint8_t flags = data[1];
+    uint8_t seq = data[2];
+    const uint8_t *body = data + BLE_FRAG_HDR_LEN;
+    size_t body_len = len - BLE_FRAG_HDR_LEN;
+
+    rx->fragments++;
+
+    // A gap loses the tail of whatever was in progress
+    if (rx->synced && seq != rx->next_seq) {
+        rx->missing += (uint8_t)(seq - rx->next_seq);
+        abandon(rx);
+    }
+    rx->next_seq = (uint8_t)(seq + 1);
+    rx->synced = true;
+
+    if (flags & BLE_FRAG_FIRST) {
+        abandon(rx);
+        if (body_len < 2) {
+            rx->malformed++;
+            return false;
+        }
+        rx->total = (size_t)body[0] | ((size_t)body[1] << 8);
+        body += 2;
+        body_len -= 2;
+        if (rx->total > rx->cap) {
+            rx->oversize++;
+            return false;
+        }
+        rx->active = true;
+    } else if (!rx->active) {
+        // Middle of a message we did not see start, or chose to drop
+        return false;
+    }
+
+    if (rx->len + body_len > rx->total) {
+        rx->malformed++;
+        abandon(rx);
+        return false;
+    }
+    memcpy(rx->buf + rx->len, body, body_len);
+    rx->len += body_len;
+
+    if (!(flags & BLE_FRAG_LAST)) {
+        return false;
+    }
+
+    bool complete = rx->len == rx->total;
+    if (!complete) {
+        rx->malformed++;
+    } else {
+        rx->messages++;
+        *msg = rx->buf;
+        *msg_len = rx->len;
+    }
+    rx->active = false;
+    rx->len = 0;
+    return complete;
+}
+
+bool ble_frag_needed(size_t len, size_t payload)
+{
+    return len > payload;
+}
+
+size_t ble_frag_tx_next(ble_frag_tx_t *tx, const uint8_t *msg, size_t len, size_t *offset,
+                        uint8_t *out, size_t payload)
+{
+    size_t pos = *offset;
+
+    if (pos >= len || payload <= BLE_FRAG_FIRST_LEN || len > UINT16_MAX) {
+        return 0;
+    }
+
+    uint8_t flags = pos == 0 ? BLE_FRAG_FIRST : 0;
+    size_t hdr = pos == 0 ? BLE_FRAG_FIRST_LEN : BLE_FRAG_HDR_LEN;
+    size_t n = len - pos;
+    if (n > payload - hdr) {
+        n = payload - hdr;
+    }
+    if (pos + n == len) {
+        flags |= BLE_FRAG_LAST;
+    }
+
+    out[0] = BLE_FRAG_MAGIC;
+    out[1] = flags;
+    out[2] = tx->next_seq++;
+    if (pos == 0) {
+        out[3] = (uint8_t)(len & 0xFF);
+        out[4] = (uint8_t)(len >> 8);
+    }
+    memcpy(out + hdr, msg + pos, n);
+
+    *offset = pos + n;
+    tx->fragments++;
+    if (flags & BLE_FRAG_LAST) {
+        tx->messages++;
+    }
+    return hdr + n;
+}
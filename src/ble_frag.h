@@ -0,0 +1,90 @@
+#ifndef BLE_FRAG_H
+#define BLE_FRAG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fragmentation and reassembly for messages larger than one ATT payload.
+ *
+ * A message that fits in MTU - 3 bytes goes out as-is, exactly as before.
+ * A longer one is cut into fragments, each starting with
+ *
+ *   u8 magic, u8 flags, u8 seq               (+ u16 total on the first)
+ *
+ * flags carries FIRST and LAST; seq counts every fragment sent in that
+ * direction and wraps at 256, so a lost notification shows up as a gap.
+ * The magic is neither '{', JSON whitespace nor the workout_codec magic,
+ * so a receiver tells whole messages and fragments apart by the first
+ * byte. A gap or a FIRST arriving mid-message abandons the message being
+ * built; the reassembler picks up again at the next FIRST.
+ *
+ * Messages are limited by the receiver's buffer and the u16 length.
+ */
+
+#define BLE_FRAG_MAGIC       0xF5
+#define BLE_FRAG_FIRST       0x01
+#define BLE_FRAG_LAST        0x02
+#define BLE_FRAG_HDR_LEN     3
+#define BLE_FRAG_FIRST_LEN   (BLE_FRAG_HDR_LEN + 2)
+#define BLE_FRAG_MIN_PAYLOAD 20     /* Default 23 byte MTU */
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;             /* Bytes of the current message so far */
+    size_t total;           /* Its announced length */
+    uint8_t next_seq;
+    bool synced;            /* next_seq is known */
+    bool active;            /* Inside a message */
+
+    uint32_t fragments;
+    uint32_t messages;      /* Reassembled and delivered */
+    uint32_t missing;       /* Fragments lost, from sequence gaps */
+    uint32_t aborted;       /* Messages abandoned part way */
+    uint32_t oversize;      /* Messages longer than buf */
+    uint32_t malformed;
+} ble_frag_rx_t;
+
+typedef struct {
+    uint8_t next_seq;
+    uint32_t fragments;
+    uint32_t messages;
+} ble_frag_tx_t;
+
+void ble_frag_rx_init(ble_frag_rx_t *rx, uint8_t *buf, size_t cap);
+
+/* Forget any partial message and the sequence, e.g. on a new connection */
+void ble_frag_rx_reset(ble_frag_rx_t *rx);
+
+/* True if data starts like a fragment */
+bool ble_frag_is_fragment(const uint8_t *data, size_t len);
+
+/*
+ * Feed one fragment. When it completes a message, returns true with msg
+ * and msg_len set to it inside rx->buf, valid until the next push.
+ */
+bool ble_frag_rx_push(ble_frag_rx_t *rx, const uint8_t *data, size_t len,
+                      const uint8_t **msg, size_t *msg_len);
+
+/* Whether a len byte message needs fragmenting at this ATT payload size */
+bool ble_frag_needed(size_t len, size_t payload);
+
+/*
+ * Write the fragment of msg starting at *offset into out (payload bytes
+ * at most) and advance *offset. Returns its length, 0 once the whole
+ * message has been emitted. Start with *offset = 0.
+ */
+size_t ble_frag_tx_next(ble_frag_tx_t *tx, const uint8_t *msg, size_t len, size_t *offset,
+                        uint8_t *out, size_t payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLE_FRAG_H */
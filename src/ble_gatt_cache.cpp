@@ -0,0 +1,161 @@
+#include "ble_gatt_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "nvs.h"
+
+static const char *TAG = "GATT_CACHE";
+
+#define NVS_NAMESPACE "ble_gatt"
+#define ENTRY_VERSION 1
+#define PEERS_KEY     "peers"
+#define LAST_PEER_KEY "last_peer"   // Single address, before "peers"
+
+typedef struct {
+    uint8_t version;
+    uint8_t addr_type;
+    uint8_t addr[6];
+    uint32_t service_hash;
+    ble_gatt_handles_t handles;
+} cache_entry_t;
+
+static uint32_t service_hash;
+
+uint32_t ble_gatt_cache_fnv1a(uint32_t hash, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void ble_gatt_cache_init(uint32_t hash)
+{
+    service_hash = hash;
+}
+
+// NVS keys are at most 15 characters: "h" and 8 hex digits
+static void make_key(const ble_addr_t *peer, char *key, size_t key_len)
+{
+    uint32_t h = ble_gatt_cache_fnv1a(BLE_GATT_CACHE_FNV_SEED, &peer->type, 1);
+    h = ble_gatt_cache_fnv1a(h, peer->val, sizeof(peer->val));
+    h = ble_gatt_cache_fnv1a(h, &service_hash, sizeof(service_hash));
+    snprintf(key, key_len, "h%08lx", (unsigned long)h);
+}
+
+bool ble_gatt_cache_load(const ble_addr_t *peer, ble_gatt_handles_t *out)
+{
+    nvs_handle_t nvs;
+    cache_entry_t entry;
+    size_t len = sizeof(entry);
+    char key[16];
+
+    make_key(peer, key, sizeof(key));
+
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return false;
+    }
+    esp_err_t err = nvs_get_blob(nvs, key, &entry, &len);
+    nvs_close(nvs);
+
+    if (err != ESP_OK || len != sizeof(entry) || entry.version != ENTRY_VERSION ||
+        entry.addr_type != peer->type || memcmp(entry.addr, peer->val, sizeof(entry.addr)) != 0 ||
+        entry.service_hash != service_hash) {
+        return false;
+    }
+
+    *out = entry.handles;
+    return true;
+}
+
+bool ble_gatt_cache_store(const ble_addr_t *peer, const ble_gatt_handles_t *handles)
+{
+    nvs_handle_t nvs;
+    cache_entry_t entry;
+    char key[16];
+
+    memset(&entry, 0, sizeof(entry));
+    entry.version = ENTRY_VERSION;
+    entry.addr_type = peer->type;
+    memcpy(entry.addr, peer->val, sizeof(entry.addr));
+    entry.service_hash = service_hash;
+    entry.handles = *handles;
+
+    make_key(peer, key, sizeof(key));
+
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, key, &entry, sizeof(entry));
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to store handles: %s", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+void ble_gatt_cache_forget(const ble_addr_t *peer)
+{
+    nvs_handle_t nvs;
+    char key[16];
+
+    make_key(peer, key, sizeof(key));
+
+    if (nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        if (nvs_erase_key(nvs, key) == ESP_OK) {
+            nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+}
+
+int ble_gatt_cache_load_peers(ble_addr_t *peers, int max)
+{
+    nvs_handle_t nvs;
+    size_t len = sizeof(*peers) * max;
+
+    if (max <= 0 || nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return 0;
+    }
+    esp_err_t err = nvs_get_blob(nvs, PEERS_KEY, peers, &len);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        len = sizeof(*peers);
+        err = nvs_get_blob(nvs, LAST_PEER_KEY, peers, &len);
+    }
+    nvs_close(nvs);
+
+    // A longer list than fits reads as ESP_ERR_NVS_INVALID_LENGTH: start over
+    if (err != ESP_OK || len % sizeof(*peers) != 0) {
+        return 0;
+    }
+    return (int)(len / sizeof(*peers));
+}
+
+bool ble_gatt_cache_store_peers(const ble_addr_t *peers, int count)
+{
+    nvs_handle_t nvs;
+
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, PEERS_KEY, peers, sizeof(*peers) * count);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to store known peers: %s", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
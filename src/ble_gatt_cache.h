@@ -0,0 +1,56 @@
+#ifndef BLE_GATT_CACHE_H
+#define BLE_GATT_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "host/ble_hs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Discovered GATT handles kept in NVS across reboots and reconnects.
+ *
+ * Entries are keyed by a 32-bit FNV-1a hash of the peer address and a
+ * service hash (the UUIDs we look for), so a peer that changes address
+ * or a firmware with different UUIDs simply misses. Each entry repeats
+ * the address and service hash, so a key collision also reads as a miss.
+ *
+ * The addresses of the peers we connected to are kept alongside, most
+ * recent first, so a reconnect can go straight to them.
+ */
+
+#define BLE_GATT_CACHE_FNV_SEED 2166136261u
+
+typedef struct {
+    uint16_t svc_start;
+    uint16_t svc_end;
+    uint16_t tx_def;
+    uint16_t tx_val;
+    uint16_t tx_cccd;       /* 0 if the descriptor was not found */
+    uint16_t rx_def;
+    uint16_t rx_val;
+} ble_gatt_handles_t;
+
+/* Running FNV-1a; start from BLE_GATT_CACHE_FNV_SEED */
+uint32_t ble_gatt_cache_fnv1a(uint32_t hash, const void *data, size_t len);
+
+/* Set the service hash entries are stored and checked against */
+void ble_gatt_cache_init(uint32_t service_hash);
+
+bool ble_gatt_cache_load(const ble_addr_t *peer, ble_gatt_handles_t *out);
+bool ble_gatt_cache_store(const ble_addr_t *peer, const ble_gatt_handles_t *handles);
+void ble_gatt_cache_forget(const ble_addr_t *peer);
+
+/* Known peer addresses into peers (max entries); returns how many */
+int ble_gatt_cache_load_peers(ble_addr_t *peers, int max);
+bool ble_gatt_cache_store_peers(const ble_addr_t *peers, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLE_GATT_CACHE_H */
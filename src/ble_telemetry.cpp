@@ -0,0 +1,305 @@
+#include "ble_telemetry.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+
+#include "host/ble_hs.h"
+
+const uint32_t ble_tlm_gap_edges_us[BLE_TLM_BUCKETS - 1] = {
+    5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000, 5000000
+};
+const uint32_t ble_tlm_proc_edges_us[BLE_TLM_BUCKETS - 1] = {
+    20, 50, 100, 200, 500, 1000, 2000, 5000, 10000
+};
+
+static const char *const att_op_names[BLE_TLM_ATT_OPS] = {
+    "disc", "sub", "mtu", "write", "rej", "no_rsp"
+};
+
+static const char *const gap_op_names[BLE_TLM_GAP_OPS] = {
+    "conn", "find", "upd", "rssi"
+};
+
+// HCI disconnect reasons worth telling apart; anything else is "other"
+static const struct {
+    uint8_t hci;
+    const char *name;
+} reasons[] = {
+    { 0x08, "timeout" },    // Supervision timeout: the link went quiet
+    { 0x13, "remote" },     // The MAX ended it
+    { 0x16, "local" },      // We ended it
+    { 0x22, "ll_rsp" },     // LL response timeout
+    { 0x3d, "mic" },        // MIC failure
+    { 0x3e, "no_estab" },   // Failed to establish
+};
+#define REASONS (sizeof(reasons) / sizeof(reasons[0]))
+
+// Current link of one slot; reset when the slot connects
+typedef struct {
+    bool connected;
+    char name[8];
+    int64_t connect_us;
+    uint32_t links;             // Connections in this slot since boot
+    int8_t rssi_last;
+    int8_t rssi_min;
+    int8_t rssi_max;
+    int32_t rssi_sum;
+    uint32_t rssi_count;
+    int64_t last_rx_us;
+    uint32_t notifications;
+    ble_tlm_hist_t gaps[BLE_CONN_PROFILES];
+    ble_tlm_hist_t proc;        // RX worker time
+    uint32_t att_errors;
+} tlm_peer_t;
+
+typedef struct {
+    tlm_peer_t peers[BLE_MAX_PEERS];
+    ble_tlm_hist_t callback;    // GAP callback time
+    uint32_t att_errors[BLE_TLM_ATT_OPS];
+    uint32_t gap_errors[BLE_TLM_GAP_OPS];
+    int att_last_status;
+    int gap_last_status;
+    uint32_t disconnects[REASONS + 1];
+} tlm_state_t;
+
+static tlm_state_t tlm;
+static portMUX_TYPE tlm_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Taken by the snapshot so formatting runs outside the lock
+static tlm_state_t snap;
+
+void ble_tlm_hist_add(ble_tlm_hist_t *h, const uint32_t *edges, uint32_t v)
+{
+    int i = 0;
+    while (i < BLE_TLM_BUCKETS - 1 && v >= edges[i]) {
+        i++;
+    }
+    h->count[i]++;
+    h->total++;
+}
+
+uint32_t ble_tlm_hist_percentile(const ble_tlm_hist_t *h, const uint32_t *edges, uint32_t pct)
+{
+    uint64_t target = ((uint64_t)h->total * pct + 99) / 100;
+    uint64_t seen = 0;
+
+    for (int i = 0; i < BLE_TLM_BUCKETS; i++) {
+        seen += h->count[i];
+        if (seen >= target && seen > 0) {
+            return i < BLE_TLM_BUCKETS - 1 ? edges[i] : UINT32_MAX;
+        }
+    }
+    return 0;
+}
+
+void ble_telemetry_connected(uint8_t peer, const char *name, int64_t now_us)
+{
+    if (peer >= BLE_MAX_PEERS) {
+        return;
+    }
+
+    portENTER_CRITICAL(&tlm_lock);
+    tlm_peer_t *p = &tlm.peers[peer];
+    uint32_t links = p->links;
+    memset(p, 0, sizeof(*p));
+    snprintf(p->name, sizeof(p->name), "%s", name);
+    p->connect_us = now_us;
+    p->links = links + 1;
+    p->rssi_min = INT8_MAX;
+    p->rssi_max = INT8_MIN;
+    p->connected = true;
+    portEXIT_CRITICAL(&tlm_lock);
+}
+
+void ble_telemetry_disconnected(uint8_t peer, int reason)
+{
+    size_t i = REASONS;
+
+    if (reason >= BLE_HS_ERR_HCI_BASE && reason < BLE_HS_ERR_HCI_BASE + 0x100) {
+        for (i = 0; i < REASONS; i++) {
+            if (reasons[i].hci == reason - BLE_HS_ERR_HCI_BASE) {
+                break;
+            }
+        }
+    }
+
+    portENTER_CRITICAL(&tlm_lock);
+    tlm.disconnects[i]++;
+    if (peer < BLE_MAX_PEERS) {
+        tlm.peers[peer].connected = false;
+    }
+    portEXIT_CRITICAL(&tlm_lock);
+}
+
+void ble_telemetry_rssi(uint8_t peer, int8_t rssi)
+{
+    if (peer >= BLE_MAX_PEERS) {
+        return;
+    }
+
+    portENTER_CRITICAL(&tlm_lock);
+    tlm_peer_t *p = &tlm.peers[peer];
+    p->rssi_last = rssi;
+    if (rssi < p->rssi_min) p->rssi_min = rssi;
+    if (rssi > p->rssi_max) p->rssi_max = rssi;
+    p->rssi_sum += rssi;
+    p->rssi_count++;
+    portEXIT_CRITICAL(&tlm_lock);
+}
+
+void ble_telemetry_callback(uint32_t us)
+{
+    portENTER_CRITICAL(&tlm_lock);
+    ble_tlm_hist_add(&tlm.callback, ble_tlm_proc_edges_us, us);
+    portEXIT_CRITICAL(&tlm_lock);
+}
+
+void ble_telemetry_notify(uint8_t peer, ble_conn_profile_t profile, int64_t rx_us,
+                          uint32_t proc_us)
+{
+    if (peer >= BLE_MAX_PEERS || profile >= BLE_CONN_PROFILES) {
+        return;
+    }
+
+    portENTER_CRITICAL(&tlm_lock);
+    tlm_peer_t *p = &tlm.peers[peer];
+    if (p->last_rx_us != 0 && rx_us > p->last_rx_us) {
+        int64_t gap = rx_us - p->last_rx_us;
+        ble_tlm_hist_add(&p->gaps[profile], ble_tlm_gap_edges_us,
+                         gap > UINT32_MAX ? UINT32_MAX : (uint32_t)gap);
+    }
+    p->last_rx_us = rx_us;
+    p->notifications++;
+    ble_tlm_hist_add(&p->proc, ble_tlm_proc_edges_us, proc_us);
+    portEXIT_CRITICAL(&tlm_lock);
+}
+
+bool ble_telemetry_gaps(uint8_t peer, ble_conn_profile_t profile, ble_tlm_hist_t *out)
+{
+    if (peer >= BLE_MAX_PEERS || profile >= BLE_CONN_PROFILES) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&tlm_lock);
+    *out = tlm.peers[peer].gaps[profile];
+    portEXIT_CRITICAL(&tlm_lock);
+    return true;
+}
+
+void ble_telemetry_att_error(uint8_t peer, ble_tlm_att_op_t op, int status)
+{
+    if (op >= BLE_TLM_ATT_OPS) {
+        return;
+    }
+
+    portENTER_CRITICAL(&tlm_lock);
+    tlm.att_errors[op]++;
+    tlm.att_last_status = status;
+    if (peer < BLE_MAX_PEERS) {
+        tlm.peers[peer].att_errors++;
+    }
+    portEXIT_CRITICAL(&tlm_lock);
+}
+
+void ble_telemetry_gap_error(ble_tlm_gap_op_t op, int status)
+{
+    if (op >= BLE_TLM_GAP_OPS) {
+        return;
+    }
+
+    portENTER_CRITICAL(&tlm_lock);
+    tlm.gap_errors[op]++;
+    tlm.gap_last_status = status;
+    portEXIT_CRITICAL(&tlm_lock);
+}
+
+// Appends to buf at *n; false once it no longer fits
+static bool put(char *buf, size_t len, size_t *n, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static bool put(char *buf, size_t len, size_t *n, const char *fmt, ...)
+{
+    if (*n >= len) {
+        return false;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int w = vsnprintf(buf + *n, len - *n, fmt, ap);
+    va_end(ap);
+    if (w < 0 || (size_t)w >= len - *n) {
+        *n = len;
+        return false;
+    }
+    *n += (size_t)w;
+    return true;
+}
+
+static void put_counts(char *buf, size_t len, size_t *n, const char *key, const uint32_t *count)
+{
+    put(buf, len, n, "\"%s\":[", key);
+    for (int i = 0; i < BLE_TLM_BUCKETS; i++) {
+        put(buf, len, n, "%s%lu", i ? "," : "", (unsigned long)count[i]);
+    }
+    put(buf, len, n, "]");
+}
+
+// {"t":s,"cb":[..],"att":{..,"last":n},"gap":{..,"last":n},"dis":{..},
+//  "trk":[{"id":..,"up":s,"links":n,"rssi":[last,min,max,mean],"n":n,
+//          "gaps":[..],"proc":[..],"att":n},...]}
+// A tracker's gaps are summed over the connection profiles.
+size_t ble_telemetry_json(int64_t now_us, char *buf, size_t len)
+{
+    size_t n = 0;
+
+    portENTER_CRITICAL(&tlm_lock);
+    snap = tlm;
+    portEXIT_CRITICAL(&tlm_lock);
+
+    put(buf, len, &n, "{\"t\":%lu,", (unsigned long)(now_us / 1000000));
+    put_counts(buf, len, &n, "cb", snap.callback.count);
+
+    put(buf, len, &n, ",\"att\":{");
+    for (int i = 0; i < BLE_TLM_ATT_OPS; i++) {
+        put(buf, len, &n, "\"%s\":%lu,", att_op_names[i], (unsigned long)snap.att_errors[i]);
+    }
+    put(buf, len, &n, "\"last\":%d},\"gap\":{", snap.att_last_status);
+    for (int i = 0; i < BLE_TLM_GAP_OPS; i++) {
+        put(buf, len, &n, "\"%s\":%lu,", gap_op_names[i], (unsigned long)snap.gap_errors[i]);
+    }
+    put(buf, len, &n, "\"last\":%d},\"dis\":{", snap.gap_last_status);
+    for (size_t i = 0; i < REASONS; i++) {
+        put(buf, len, &n, "\"%s\":%lu,", reasons[i].name, (unsigned long)snap.disconnects[i]);
+    }
+    put(buf, len, &n, "\"other\":%lu},\"trk\":[", (unsigned long)snap.disconnects[REASONS]);
+
+    bool first = true;
+    for (int i = 0; i < BLE_MAX_PEERS; i++) {
+        const tlm_peer_t *p = &snap.peers[i];
+        if (!p->connected) {
+            continue;
+        }
+
+        uint32_t gaps[BLE_TLM_BUCKETS] = { 0 };
+        for (int prof = 0; prof < BLE_CONN_PROFILES; prof++) {
+            for (int b = 0; b < BLE_TLM_BUCKETS; b++) {
+                gaps[b] += p->gaps[prof].count[b];
+            }
+        }
+
+        int mean = p->rssi_count ? (int)(p->rssi_sum / (int32_t)p->rssi_count) : 0;
+        put(buf, len, &n, "%s{\"id\":\"%s\",\"up\":%lu,\"links\":%lu,\"rssi\":[%d,%d,%d,%d],"
+                          "\"n\":%lu,",
+            first ? "" : ",", p->name, (unsigned long)((now_us - p->connect_us) / 1000000),
+            (unsigned long)p->links, p->rssi_last, p->rssi_count ? p->rssi_min : 0,
+            p->rssi_count ? p->rssi_max : 0, mean, (unsigned long)p->notifications);
+        put_counts(buf, len, &n, "gaps", gaps);
+        put(buf, len, &n, ",");
+        put_counts(buf, len, &n, "proc", p->proc.count);
+        put(buf, len, &n, ",\"att\":%lu}", (unsigned long)p->att_errors);
+        first = false;
+    }
+
+    return put(buf, len, &n, "]}") ? n : 0;
+}
@@ -0,0 +1,102 @@
+#ifndef BLE_TELEMETRY_H
+#define BLE_TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "ble_client.h"
+#include "ble_conn_policy.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Link telemetry for chasing dropouts: per tracker, the RSSI sampled
+ * over the connection, notification inter-arrival times per connection
+ * profile, processing time histograms and ATT error counts; for the
+ * gateway, the GAP callback time, ATT and GAP errors by operation and
+ * disconnects by reason.
+ *
+ * Everything counts up from boot, except a tracker's link section, which
+ * starts over when its slot connects. Histograms are fixed buckets so a
+ * snapshot is the same size however long the link has run; consumers
+ * diff successive snapshots for rates.
+ *
+ * The caller samples RSSI and publishes; this module only counts and
+ * formats. Any task may call in: all state is behind one spinlock, and
+ * a snapshot is copied out under it before formatting.
+ */
+
+#define BLE_TLM_BUCKETS 10
+
+typedef struct {
+    uint32_t count[BLE_TLM_BUCKETS];
+    uint32_t total;
+} ble_tlm_hist_t;
+
+/*
+ * Bucket upper edges, BLE_TLM_BUCKETS - 1 of them in ascending order;
+ * the last bucket takes everything above
+ */
+extern const uint32_t ble_tlm_gap_edges_us[];   /* 5 ms ... 5 s */
+extern const uint32_t ble_tlm_proc_edges_us[];  /* 20 us ... 10 ms */
+
+void ble_tlm_hist_add(ble_tlm_hist_t *h, const uint32_t *edges, uint32_t v);
+
+/*
+ * Smallest bucket edge at or above the given percentile (0-100):
+ * UINT32_MAX if that is the last bucket, 0 if the histogram is empty
+ */
+uint32_t ble_tlm_hist_percentile(const ble_tlm_hist_t *h, const uint32_t *edges, uint32_t pct);
+
+typedef enum {
+    BLE_TLM_ATT_DISCOVERY = 0,
+    BLE_TLM_ATT_SUBSCRIBE,
+    BLE_TLM_ATT_MTU,
+    BLE_TLM_ATT_WRITE,      /* Write not issued */
+    BLE_TLM_ATT_REJECTED,   /* Error response to a write request */
+    BLE_TLM_ATT_NO_RSP,     /* Write request never answered */
+    BLE_TLM_ATT_OPS
+} ble_tlm_att_op_t;
+
+typedef enum {
+    BLE_TLM_GAP_CONNECT = 0,    /* Connection attempt failed */
+    BLE_TLM_GAP_FIND,           /* Scan or connect could not start */
+    BLE_TLM_GAP_UPDATE,         /* Parameter update failed or rejected */
+    BLE_TLM_GAP_RSSI,
+    BLE_TLM_GAP_OPS
+} ble_tlm_gap_op_t;
+
+/* A tracker connected in slot peer, or dropped with a NimBLE reason */
+void ble_telemetry_connected(uint8_t peer, const char *name, int64_t now_us);
+void ble_telemetry_disconnected(uint8_t peer, int reason);
+
+void ble_telemetry_rssi(uint8_t peer, int8_t rssi);
+
+/* Time spent in the GAP callback for one notification (host task) */
+void ble_telemetry_callback(uint32_t us);
+
+/* A notification received at rx_us under the given profile took proc_us */
+void ble_telemetry_notify(uint8_t peer, ble_conn_profile_t profile, int64_t rx_us,
+                          uint32_t proc_us);
+
+/* Inter-arrival histogram of a tracker's current link under one profile */
+bool ble_telemetry_gaps(uint8_t peer, ble_conn_profile_t profile, ble_tlm_hist_t *out);
+
+/* peer is BLE_MAX_PEERS when the error has no tracker yet */
+void ble_telemetry_att_error(uint8_t peer, ble_tlm_att_op_t op, int status);
+void ble_telemetry_gap_error(ble_tlm_gap_op_t op, int status);
+
+/*
+ * Compact JSON snapshot into buf, connected trackers only; returns its
+ * length, or 0 if it does not fit
+ */
+size_t ble_telemetry_json(int64_t now_us, char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLE_TELEMETRY_H */
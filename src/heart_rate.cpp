@@ -1,140 +1,362 @@
 #include "heart_rate.h"
-#include "driver/adc.h"
-#include "esp_adc_cal.h"
+#include "hr_sampler.h"
+#include "hr_pipeline.h"
+#include "hr_wave_codec.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_attr.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include <atomic>
 #include <stdio.h>
+#include <string.h>
 
 static const char *TAG = "HEART_RATE";
 
-#define HEART_RATE_PIN ADC1_CHANNEL_0  // GPIO36
+#define HEART_RATE_CHANNEL ADC_CHANNEL_0  // GPIO36
 #define DEFAULT_VREF    1100
-#define NO_OF_SAMPLES   64
-#define THRESHOLD       1500  // Threshold for beat detection (between 142mV and 3129mV)
-#define MIN_INTERVAL_MS 300   // Minimum 300ms between beats (200 BPM max)
-#define MAX_INTERVAL_MS 2000  // Maximum 2000ms between beats (30 BPM min)
-#define REQUIRED_BEATS  3     // Need 3 beats for stable reading
-
-static esp_adc_cal_characteristics_t *adc_chars;
-static int current_bpm = 0;
-static bool sensor_valid = false;
-static uint32_t last_beat_time = 0;
-static bool last_state = false;
+
+// DMA conversion rate: lowest whole multiple of the output rate the
+// continuous driver accepts. Decimation averages the excess conversions,
+// replacing the old 64x multisample loop.
+#define ADC_RAW_RATE_HZ \
+    (((SOC_ADC_SAMPLE_FREQ_THRES_LOW + HR_SAMPLE_RATE_HZ - 1) / HR_SAMPLE_RATE_HZ) * HR_SAMPLE_RATE_HZ)
+
+// One DMA frame per ~50 ms at the raw rate; the pool holds four frames
+#define ADC_FRAME_SAMPLES 1024
+#define ADC_FRAME_BYTES   (ADC_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+#define ADC_POOL_BYTES    (ADC_FRAME_BYTES * 4)
+
+static adc_continuous_handle_t adc_handle = NULL;
+static adc_cali_handle_t adc_cali = NULL;
+static uint16_t adc_frame[ADC_FRAME_BYTES / sizeof(uint16_t)];
+
+static std::atomic<bool> sensor_valid(false);
+static std::atomic<uint32_t> samples_seen(0);  // Index of the latest sample + 1
 static TaskHandle_t heart_rate_task_handle = NULL;
-static volatile bool beat_detected = false;
-
-// Beat detection variables
-static uint32_t beat_times[10] = {0};
-static int beat_index = 0;
-static int beat_count = 0;
-
-// Signal smoothing
-static uint32_t smoothed_voltage = 0;
-
-static uint32_t read_adc_voltage(void) {
-    uint32_t adc_reading = 0;
-    
-    // Multisampling
-    for (int i = 0; i < NO_OF_SAMPLES; i++) {
-        adc_reading += adc1_get_raw(HEART_RATE_PIN);
-    }
-    adc_reading /= NO_OF_SAMPLES;
-    
-    // Convert to voltage in mV
-    uint32_t voltage = esp_adc_cal_raw_to_voltage(adc_reading, adc_chars);
-    
-    // Smooth the signal - exponential moving average
-    if (smoothed_voltage == 0) {
-        smoothed_voltage = voltage;
+
+// HRV and quality snapshots, shared with reader tasks under hr_lock
+static portMUX_TYPE hr_lock = portMUX_INITIALIZER_UNLOCKED;
+static hr_hrv_metrics_t hrv_snapshot;
+static hr_quality_window_t quality_snapshot;
+static uint32_t last_voltage = 0;
+
+// Waveform streaming: enable and sink are set from other tasks, the frame
+// itself is only touched by the heart-rate task
+static std::atomic<bool> wave_enabled(false);
+static std::atomic<heart_rate_wave_sink_t> wave_sink(nullptr);
+static uint8_t wave_buf[HR_WAVE_FRAME_BYTES(HR_WAVE_FRAME_SAMPLES)];
+static hr_wave_encoder_t wave_enc;
+static bool wave_active = false;
+static uint32_t wave_seq = 0;
+static heart_rate_wave_stats_t wave_stats;
+
+static uint32_t raw_to_voltage(uint16_t raw)
+{
+    int mv = 0;
+    if (adc_cali == NULL || adc_cali_raw_to_voltage(adc_cali, raw, &mv) != ESP_OK) {
+        // Uncalibrated fallback: 12-bit full scale ~3.3 V at 12 dB
+        mv = (raw * 3300) >> 12;
+    }
+    return (uint32_t)mv;
+}
+
+// Runs in ISR context once per completed DMA frame
+static bool IRAM_ATTR on_adc_frame(adc_continuous_handle_t handle,
+                                   const adc_continuous_evt_data_t *edata,
+                                   void *user_data)
+{
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(heart_rate_task_handle, &woken);
+    return woken == pdTRUE;
+}
+
+// Drain every complete DMA frame into the sampler
+static void drain_adc_frames(void)
+{
+    uint32_t len = 0;
+
+    while (adc_continuous_read(adc_handle, (uint8_t *)adc_frame, sizeof(adc_frame),
+                               &len, 0) == ESP_OK) {
+        // Unpack conversion results in place (same 16-bit layout)
+        size_t n = 0;
+        for (uint32_t i = 0; i < len / SOC_ADC_DIGI_RESULT_BYTES; i++) {
+            adc_digi_output_data_t *p = (adc_digi_output_data_t *)&adc_frame[i];
+            if (p->type1.channel == HEART_RATE_CHANNEL) {
+                adc_frame[n++] = p->type1.data;
+            }
+        }
+        hr_sampler_push_raw(adc_frame, n);
+    }
+}
+
+static void flush_wave(void)
+{
+    size_t len = hr_wave_finish(&wave_enc);
+    heart_rate_wave_sink_t sink = wave_sink.load(std::memory_order_acquire);
+
+    if (sink != nullptr && sink(wave_buf, len)) {
+        wave_stats.frames++;
+        wave_stats.bytes += len;
     } else {
-        smoothed_voltage = (smoothed_voltage * 7 + voltage * 3) / 10;
+        wave_stats.dropped++;
     }
-    
-    return smoothed_voltage;
+    wave_stats.samples += wave_enc.count;
+    wave_active = false;
 }
 
-// Heart rate monitoring task
+static void stream_sample(uint32_t voltage, uint32_t index)
+{
+    if (!wave_enabled.load(std::memory_order_relaxed)) {
+        // Send what we have so the tail of the capture is not lost
+        if (wave_active) {
+            flush_wave();
+        }
+        return;
+    }
+
+    if (!wave_active) {
+        hr_wave_begin(&wave_enc, wave_buf, sizeof(wave_buf), wave_seq++,
+                      hr_pipeline_index_to_us(index, 0), HR_SAMPLE_RATE_HZ);
+        wave_active = true;
+    }
+
+    hr_wave_add(&wave_enc, (int16_t)voltage);
+    if (wave_enc.count == HR_WAVE_FRAME_SAMPLES) {
+        flush_wave();
+    }
+}
+
+static void process_sample(uint32_t voltage, uint32_t index)
+{
+    hr_beat_event_t beat;
+    hr_hrv_metrics_t metrics;
+    hr_quality_window_t quality;
+
+    last_voltage = voltage;
+    samples_seen.store(index + 1, std::memory_order_relaxed);
+    stream_sample(voltage, index);
+
+    // Filter, detect and publish; the snapshots only change on these flags
+    uint32_t flags = hr_pipeline_push(index, (int32_t)voltage, &beat);
+    if (flags == 0) {
+        return;
+    }
+
+    if (flags & HR_PIPE_QUALITY) {
+        // Sensor is valid only while the signal looks like a pulse
+        hr_pipeline_get_quality(&quality);
+        sensor_valid.store(quality.score >= HR_QUALITY_MIN, std::memory_order_relaxed);
+
+        portENTER_CRITICAL(&hr_lock);
+        quality_snapshot = quality;
+        portEXIT_CRITICAL(&hr_lock);
+    }
+
+    if (flags & (HR_PIPE_BEAT | HR_PIPE_RESET)) {
+        hr_pipeline_get_hrv(&metrics);
+        portENTER_CRITICAL(&hr_lock);
+        hrv_snapshot = metrics;
+        portEXIT_CRITICAL(&hr_lock);
+    }
+}
+
+// Heart rate monitoring task: sleeps until the DMA engine has a frame ready,
+// then runs detection over every complete block at the fixed sample rate
 static void heart_rate_task(void *pvParameters) {
+    hr_block_t block;
+
+    adc_continuous_start(adc_handle);
+
     while (1) {
-        uint32_t voltage = read_adc_voltage();
-        uint32_t current_time = xTaskGetTickCount() * portTICK_PERIOD_MS;
-        
-        // Simple threshold detection
-        bool current_state = (voltage > THRESHOLD);
-        
-        // Detect rising edge (beat)
-        if (current_state && !last_state) {
-            uint32_t interval = current_time - last_beat_time;
-            
-            // Validate interval to filter noise
-            if (last_beat_time > 0 && interval >= MIN_INTERVAL_MS && interval <= MAX_INTERVAL_MS) {
-                beat_times[beat_index] = interval;
-                beat_index = (beat_index + 1) % 10;
-                if (beat_count < 10) beat_count++;
-                
-                // Only update BPM if we have enough beats
-                if (beat_count >= REQUIRED_BEATS) {
-                    // Calculate average BPM from recent beats
-                    uint32_t avg_interval = 0;
-                    for (int i = 0; i < beat_count; i++) {
-                        avg_interval += beat_times[i];
-                    }
-                    avg_interval /= beat_count;
-                    current_bpm = 60000 / avg_interval;
-                    beat_detected = true;
-                }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(200));
+        drain_adc_frames();
+
+        while (hr_sampler_pop_block(&block)) {
+            for (uint32_t i = 0; i < HR_SAMPLER_BLOCK_SAMPLES; i++) {
+                process_sample(raw_to_voltage(block.samples[i]), block.first_index + i);
             }
-            
-            last_beat_time = current_time;
         }
-        
-        last_state = current_state;
-        
-        // Reset BPM if no beat detected for too long
-        if (current_time - last_beat_time > 5000) {
-            current_bpm = 0;
-            beat_count = 0;
-            smoothed_voltage = 0;
-        }
-        
-        vTaskDelay(pdMS_TO_TICKS(50));  // Check every 50ms
     }
 }
 
-void heart_rate_init(void) {
-    // Configure ADC
-    adc1_config_width(ADC_WIDTH_BIT_12);
-    adc1_config_channel_atten(HEART_RATE_PIN, ADC_ATTEN_DB_12);
-    
+static bool adc_dma_init(void)
+{
+    adc_continuous_handle_cfg_t handle_cfg = {};
+    handle_cfg.max_store_buf_size = ADC_POOL_BYTES;
+    handle_cfg.conv_frame_size = ADC_FRAME_BYTES;
+
+    esp_err_t err = adc_continuous_new_handle(&handle_cfg, &adc_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ADC continuous handle failed: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_12;
+    pattern.channel = HEART_RATE_CHANNEL;
+    pattern.unit = ADC_UNIT_1;
+    pattern.bit_width = ADC_BITWIDTH_12;
+
+    adc_continuous_config_t dig_cfg = {};
+    dig_cfg.pattern_num = 1;
+    dig_cfg.adc_pattern = &pattern;
+    dig_cfg.sample_freq_hz = ADC_RAW_RATE_HZ;
+    dig_cfg.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    dig_cfg.format = ADC_DIGI_OUTPUT_FORMAT_TYPE1;
+
+    err = adc_continuous_config(adc_handle, &dig_cfg);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ADC continuous config failed: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    adc_continuous_evt_cbs_t cbs = {};
+    cbs.on_conv_done = on_adc_frame;
+    adc_continuous_register_event_callbacks(adc_handle, &cbs, NULL);
+
     // Characterize ADC
-    adc_chars = (esp_adc_cal_characteristics_t *)calloc(1, sizeof(esp_adc_cal_characteristics_t));
-    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_12, ADC_WIDTH_BIT_12, DEFAULT_VREF, adc_chars);
-    
-    // Create heart rate monitoring task
+    adc_cali_line_fitting_config_t cali_cfg = {};
+    cali_cfg.unit_id = ADC_UNIT_1;
+    cali_cfg.atten = ADC_ATTEN_DB_12;
+    cali_cfg.bitwidth = ADC_BITWIDTH_12;
+    cali_cfg.default_vref = DEFAULT_VREF;
+    if (adc_cali_create_scheme_line_fitting(&cali_cfg, &adc_cali) != ESP_OK) {
+        ESP_LOGW(TAG, "ADC calibration unavailable, using nominal scale");
+        adc_cali = NULL;
+    }
+
+    return true;
+}
+
+void heart_rate_init(void) {
+    uint32_t decim = hr_sampler_init(ADC_RAW_RATE_HZ, HR_SAMPLE_RATE_HZ);
+    hr_pipeline_init();
+
+    if (!adc_dma_init()) {
+        return;
+    }
+
+    // Create heart rate monitoring task (starts the DMA engine itself so the
+    // frame callback always has a task to notify)
     xTaskCreate(heart_rate_task, "heart_rate_task", 4096, NULL, 5, &heart_rate_task_handle);
-    
-    sensor_valid = true;
+
+    ESP_LOGI(TAG, "ADC DMA sampling at %d Hz (decimation %lu from %d Hz)",
+             HR_SAMPLE_RATE_HZ, (unsigned long)decim, ADC_RAW_RATE_HZ);
 }
 
 int heart_rate_get_bpm(void) {
-    return current_bpm;
+    return hr_pipeline_bpm();
 }
 
 bool heart_rate_is_valid(void) {
-    return sensor_valid && (current_bpm > 0);
+    return sensor_valid.load(std::memory_order_relaxed) &&
+           (hr_pipeline_bpm() > 0);
+}
+
+void heart_rate_subscribe(heart_rate_sub_t *sub)
+{
+    hr_beat_channel_subscribe(sub);
+}
+
+void heart_rate_subscribe_history(heart_rate_sub_t *sub)
+{
+    hr_beat_channel_subscribe_history(sub);
 }
 
-bool heart_rate_update(float *bpm_out) {
-    if (bpm_out) {
-        *bpm_out = (float)current_bpm;
+uint64_t heart_rate_now_us(void)
+{
+    uint32_t n = samples_seen.load(std::memory_order_relaxed);
+    return n ? hr_pipeline_index_to_us(n - 1, 0) : 0;
+}
+
+bool heart_rate_next_beat(heart_rate_sub_t *sub, heart_rate_beat_t *out)
+{
+    return hr_beat_channel_read(sub, out);
+}
+
+bool heart_rate_notify_on_beat(heart_rate_notify_t fn, void *ctx)
+{
+    return hr_beat_channel_add_notify(fn, ctx);
+}
+
+size_t heart_rate_read_rr(uint32_t *cursor, heart_rate_rr_t *out, size_t max)
+{
+    // RR stream is a view on the beat channel with a caller-held cursor.
+    // Artifact beats are left out, as they are from BPM and HRV.
+    hr_beat_sub_t sub = { *cursor, 0 };
+    hr_beat_event_t ev;
+    size_t n = 0;
+
+    while (n < max && hr_beat_channel_read(&sub, &ev)) {
+        if (ev.quality < HEART_RATE_QUALITY_MIN) {
+            continue;
+        }
+        out[n].timestamp_us = ev.timestamp_us;
+        out[n].rr_us = ev.rr_us;
+        n++;
+    }
+
+    *cursor = sub.cursor;
+    return n;
+}
+
+bool heart_rate_get_hrv(heart_rate_hrv_t *out)
+{
+    hr_hrv_metrics_t metrics;
+
+    portENTER_CRITICAL(&hr_lock);
+    metrics = hrv_snapshot;
+    portEXIT_CRITICAL(&hr_lock);
+
+    out->mean_bpm = metrics.mean_bpm;
+    out->rmssd_ms = metrics.rmssd_ms;
+    out->sdnn_ms = metrics.sdnn_ms;
+    out->pnn50 = metrics.pnn50;
+    out->beats = metrics.count;
+    return metrics.count >= 2;
+}
+
+int heart_rate_get_quality(heart_rate_quality_t *out)
+{
+    hr_quality_window_t quality;
+
+    portENTER_CRITICAL(&hr_lock);
+    quality = quality_snapshot;
+    portEXIT_CRITICAL(&hr_lock);
+
+    if (out) {
+        *out = quality;
     }
+    return quality.score;
+}
 
-    bool event = beat_detected;
-    beat_detected = false;
-    return event;
+void heart_rate_stream_set_sink(heart_rate_wave_sink_t sink)
+{
+    wave_sink.store(sink, std::memory_order_release);
+}
+
+void heart_rate_stream_enable(bool enable)
+{
+    if (wave_enabled.exchange(enable) != enable) {
+        ESP_LOGI(TAG, "Waveform streaming %s", enable ? "on" : "off");
+    }
+}
+
+bool heart_rate_stream_enabled(void)
+{
+    return wave_enabled.load(std::memory_order_relaxed);
+}
+
+void heart_rate_stream_get_stats(heart_rate_wave_stats_t *out)
+{
+    if (out) {
+        *out = wave_stats;
+    }
 }
 
 uint32_t heart_rate_read_voltage_debug(void) {
-    return read_adc_voltage();
+    return last_voltage;
 }
@@ -3,25 +3,98 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+#include "hr_beat_channel.h"
+#include "hr_quality.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// One validated beat-to-beat interval
+typedef struct {
+    uint64_t timestamp_us;  // Beat time, us since sampling started
+    uint32_t rr_us;         // Interval ending at this beat
+} heart_rate_rr_t;
+
+// Rolling HRV over the most recent beats
+typedef struct {
+    uint16_t mean_bpm;      // Mean BPM over the window
+    uint16_t rmssd_ms;
+    uint16_t sdnn_ms;
+    uint8_t pnn50;          // Percent of successive differences > 50 ms
+    uint16_t beats;         // RR intervals in the window
+} heart_rate_hrv_t;
+
+// Signal quality over the last window; beats and windows scoring below
+// HEART_RATE_QUALITY_MIN are motion/contact artifacts
+typedef hr_quality_window_t heart_rate_quality_t;
+#define HEART_RATE_QUALITY_MIN HR_QUALITY_MIN
+
 // Initialize heart rate sensor on GPIO36
 void heart_rate_init(void);
 
 // Get current heart rate (BPM)
 int heart_rate_get_bpm(void);
 
-// Check if heart rate is valid
+// Check if heart rate is valid (locked and signal quality acceptable)
 bool heart_rate_is_valid(void);
 
-// Called from main loop to get latest BPM and beat event
-// Returns true if a new beat was detected since last call
-bool heart_rate_update(float *bpm_out);
+// Latest signal quality window, returns its score (0-100)
+int heart_rate_get_quality(heart_rate_quality_t *out);
+
+// Beat events: each subscriber has its own cursor and sees every beat.
+// Artifact beats are delivered too, with quality < HEART_RATE_QUALITY_MIN.
+typedef hr_beat_event_t heart_rate_beat_t;
+typedef hr_beat_sub_t heart_rate_sub_t;
+
+// Start receiving beats published from now on
+void heart_rate_subscribe(heart_rate_sub_t *sub);
+
+// Start at the oldest beat still held (up to HR_BEAT_CHANNEL_LEN back), to
+// answer questions about the recent past without waiting for new beats
+void heart_rate_subscribe_history(heart_rate_sub_t *sub);
+
+// Time of the latest processed sample on the beat timestamp clock (us),
+// 0 before the first sample
+uint64_t heart_rate_now_us(void);
+
+// Next beat for this subscriber, false if none pending
+bool heart_rate_next_beat(heart_rate_sub_t *sub, heart_rate_beat_t *out);
+
+// Call fn(ctx) from the heart-rate task after every published beat, e.g.
+// to give a task notification to a consumer blocked on new beats
+typedef hr_beat_notify_t heart_rate_notify_t;
+bool heart_rate_notify_on_beat(heart_rate_notify_t fn, void *ctx);
+
+// Read RR intervals published after *cursor (start from 0) into out.
+// Advances the cursor and returns the number copied. Intervals that were
+// overwritten before being read are skipped, and so are artifact beats
+// (quality < HEART_RATE_QUALITY_MIN).
+size_t heart_rate_read_rr(uint32_t *cursor, heart_rate_rr_t *out, size_t max);
+
+// Snapshot of the rolling HRV metrics, false until two intervals are seen
+bool heart_rate_get_hrv(heart_rate_hrv_t *out);
+
+// Raw waveform streaming: calibrated samples (before filtering) are packed
+// into delta-encoded frames of HR_WAVE_FRAME_SAMPLES (see hr_wave_codec.h)
+// and handed to the sink from the heart-rate task. The sink must not block.
+typedef bool (*heart_rate_wave_sink_t)(const uint8_t *frame, size_t len);
+
+typedef struct {
+    uint32_t frames;        // Frames handed to the sink
+    uint32_t dropped;       // Frames the sink refused
+    uint32_t bytes;         // Encoded bytes handed over
+    uint32_t samples;       // Samples streamed
+} heart_rate_wave_stats_t;
+
+void heart_rate_stream_set_sink(heart_rate_wave_sink_t sink);
+void heart_rate_stream_enable(bool enable);
+bool heart_rate_stream_enabled(void);
+void heart_rate_stream_get_stats(heart_rate_wave_stats_t *out);
 
-// Debug function to read raw voltage
+// Debug function: latest calibrated sample in mV (before filtering)
 uint32_t heart_rate_read_voltage_debug(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,152 @@
+#include "hr_beat_channel.h"
+
+#include <atomic>
+
+#define CHANNEL_MASK (HR_BEAT_CHANNEL_LEN - 1)
+#define EVENT_WORDS  4
+
+static_assert((HR_BEAT_CHANNEL_LEN & CHANNEL_MASK) == 0,
+              "HR_BEAT_CHANNEL_LEN must be a power of two");
+
+// Events are stored as atomic words so torn reads are detectable rather
+// than undefined; seq is 2n+1 while event n is written, 2n+2 once complete
+typedef struct {
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> word[EVENT_WORDS];
+} channel_slot_t;
+
+static channel_slot_t ring[HR_BEAT_CHANNEL_LEN];
+static std::atomic<uint32_t> head(0);
+
+// Hooks are appended only; a slot is filled before the count covers it
+typedef struct {
+    hr_beat_notify_t fn;
+    void *ctx;
+} notify_hook_t;
+
+static notify_hook_t hooks[HR_BEAT_CHANNEL_HOOKS];
+static std::atomic<uint32_t> hook_count(0);
+static std::atomic<uint32_t> hook_claimed(0);
+
+static void pack(const hr_beat_event_t *ev, uint32_t w[EVENT_WORDS])
+{
+    w[0] = (uint32_t)ev->timestamp_us;
+    w[1] = (uint32_t)(ev->timestamp_us >> 32);
+    w[2] = ev->rr_us;
+    w[3] = (uint32_t)ev->bpm | ((uint32_t)ev->quality << 16);
+}
+
+static void unpack(const uint32_t w[EVENT_WORDS], hr_beat_event_t *ev)
+{
+    ev->timestamp_us = (uint64_t)w[0] | ((uint64_t)w[1] << 32);
+    ev->rr_us = w[2];
+    ev->bpm = (uint16_t)(w[3] & 0xFFFF);
+    ev->quality = (uint8_t)(w[3] >> 16);
+}
+
+void hr_beat_channel_publish(const hr_beat_event_t *ev)
+{
+    uint32_t n = head.load(std::memory_order_relaxed);
+    channel_slot_t *slot = &ring[n & CHANNEL_MASK];
+    uint32_t w[EVENT_WORDS];
+
+    pack(ev, w);
+
+    slot->seq.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int i = 0; i < EVENT_WORDS; i++) {
+        slot->word[i].store(w[i], std::memory_order_relaxed);
+    }
+    slot->seq.store(2 * n + 2, std::memory_order_release);
+
+    head.store(n + 1, std::memory_order_release);
+
+    uint32_t nhooks = hook_count.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < nhooks; i++) {
+        hooks[i].fn(hooks[i].ctx);
+    }
+}
+
+bool hr_beat_channel_add_notify(hr_beat_notify_t fn, void *ctx)
+{
+    uint32_t i = hook_claimed.fetch_add(1, std::memory_order_relaxed);
+    if (i >= HR_BEAT_CHANNEL_HOOKS) {
+        return false;
+    }
+
+    hooks[i].fn = fn;
+    hooks[i].ctx = ctx;
+
+    // Publish in claim order so the producer never sees a half-set hook
+    uint32_t expected = i;
+    while (!hook_count.compare_exchange_weak(expected, i + 1, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+        expected = i;
+    }
+    return true;
+}
+
+void hr_beat_channel_reset(void)
+{
+    for (int i = 0; i < HR_BEAT_CHANNEL_LEN; i++) {
+        ring[i].seq.store(0, std::memory_order_relaxed);
+    }
+    head.store(0, std::memory_order_release);
+}
+
+uint32_t hr_beat_channel_head(void)
+{
+    return head.load(std::memory_order_acquire);
+}
+
+void hr_beat_channel_subscribe(hr_beat_sub_t *sub)
+{
+    sub->cursor = head.load(std::memory_order_acquire);
+    sub->dropped = 0;
+}
+
+void hr_beat_channel_subscribe_history(hr_beat_sub_t *sub)
+{
+    uint32_t h = head.load(std::memory_order_acquire);
+    sub->cursor = h > HR_BEAT_CHANNEL_LEN ? h - HR_BEAT_CHANNEL_LEN : 0;
+    sub->dropped = 0;
+}
+
+bool hr_beat_channel_read(hr_beat_sub_t *sub, hr_beat_event_t *out)
+{
+    while (1) {
+        uint32_t h = head.load(std::memory_order_acquire);
+        uint32_t c = sub->cursor;
+
+        if (c == h) {
+            return false;
+        }
+
+        // Lapped by the producer: skip to the oldest event still held
+        if (h - c > HR_BEAT_CHANNEL_LEN) {
+            sub->dropped += h - HR_BEAT_CHANNEL_LEN - c;
+            c = h - HR_BEAT_CHANNEL_LEN;
+            sub->cursor = c;
+        }
+
+        channel_slot_t *slot = &ring[c & CHANNEL_MASK];
+        uint32_t s1 = slot->seq.load(std::memory_order_acquire);
+        uint32_t w[EVENT_WORDS];
+        for (int i = 0; i < EVENT_WORDS; i++) {
+            w[i] = slot->word[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t s2 = slot->seq.load(std::memory_order_relaxed);
+
+        if (s1 != 2 * c + 2 || s2 != s1) {
+            // Overwritten while we looked - count it and move on
+            sub->dropped++;
+            sub->cursor = c + 1;
+            continue;
+        }
+
+        unpack(w, out);
+        sub->cursor = c + 1;
+        return true;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef HR_BEAT_CHANNEL_H
+#define HR_BEAT_CHANNEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Lock-free single-producer / multi-consumer beat event channel.
+ *
+ * The heart-rate task publishes one event per validated beat into a ring.
+ * Every subscriber owns a read cursor, so consumers never steal events
+ * from each other and can poll as slowly as they like: a consumer that
+ * falls more than HR_BEAT_CHANNEL_LEN events behind loses the oldest
+ * ones, and the loss is counted in its subscription.
+ *
+ * Slots are guarded by per-slot sequence numbers (seqlock); readers never
+ * block the producer.
+ *
+ * The ring doubles as the recent beat history: a subscription can start
+ * at the oldest event still held instead of at the next one.
+ *
+ * Consumers that want to sleep between beats register a notify hook; the
+ * producer calls every hook after each publish, from its own context.
+ */
+
+#define HR_BEAT_CHANNEL_LEN 256  /* Power of two; > 1 min of beats at 240 BPM */
+#define HR_BEAT_CHANNEL_HOOKS 4  /* Notify hooks that can be registered */
+
+typedef struct {
+    uint64_t timestamp_us;  /* Beat time, us since sampling started */
+    uint32_t rr_us;         /* Interval ending at this beat */
+    uint16_t bpm;           /* Averaged BPM, 0 until enough beats */
+    uint8_t quality;        /* 0-100 */
+} hr_beat_event_t;
+
+typedef struct {
+    uint32_t cursor;        /* Sequence number of the next event to read */
+    uint32_t dropped;       /* Events overwritten before they were read */
+} hr_beat_sub_t;
+
+/* Called after each publish; must be short and must not block */
+typedef void (*hr_beat_notify_t)(void *ctx);
+
+/* Producer side (one task only) */
+void hr_beat_channel_publish(const hr_beat_event_t *ev);
+
+/* Forget every event (host replay between traces); the producer must be
+ * idle and existing subscriptions are invalid afterwards */
+void hr_beat_channel_reset(void);
+
+/* Number of events published so far */
+uint32_t hr_beat_channel_head(void);
+
+/* Start a subscription at the next event to be published */
+void hr_beat_channel_subscribe(hr_beat_sub_t *sub);
+
+/* Start a subscription at the oldest event still held in the ring; the
+ * cursor is 0 if nothing has been overwritten since boot */
+void hr_beat_channel_subscribe_history(hr_beat_sub_t *sub);
+
+/* Read the next event for this subscriber, false if none pending */
+bool hr_beat_channel_read(hr_beat_sub_t *sub, hr_beat_event_t *out);
+
+/* Register a wakeup hook, false if all HR_BEAT_CHANNEL_HOOKS are taken */
+bool hr_beat_channel_add_notify(hr_beat_notify_t fn, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HR_BEAT_CHANNEL_H */
@@ -0,0 +1,254 @@
+#include "hr_detector.h"
+
+#include <string.h>
+
+#define DERIV_CLAMP 2047  // Keeps window sums inside 32 bits at 1 kHz
+#define HIST_MASK   (HR_DET_HIST_LEN - 1)
+
+static_assert((HR_DET_HIST_LEN & HIST_MASK) == 0, "HR_DET_HIST_LEN must be a power of two");
+static_assert(HR_DET_HIST_LEN >= 3 * HR_DET_WINDOW_MAX, "HR_DET_HIST_LEN too short for the window");
+
+// level += (val - level) / 2^shift
+static uint32_t track_level(uint32_t level, uint32_t val, int shift)
+{
+    return (uint32_t)((int32_t)level + (((int32_t)val - (int32_t)level) >> shift));
+}
+
+static void update_threshold(hr_detector_t *det)
+{
+    if (det->spki > det->npki) {
+        det->thr1 = det->npki + ((det->spki - det->npki) >> 2);
+    } else {
+        det->thr1 = det->npki;
+    }
+}
+
+// Walk back from the peak to the sample below half its height and
+// interpolate the crossing linearly. Runs once per candidate peak, while
+// the rising edge is still in the history ring.
+static void find_fiducial(const hr_detector_t *det, uint32_t peak_idx, uint32_t peak_val,
+                          uint32_t *fid, uint16_t *frac)
+{
+    uint32_t level = peak_val >> 1;
+    uint32_t age = det->index - 1 - peak_idx;
+    uint32_t k = peak_idx;
+
+    *fid = peak_idx;
+    *frac = 0;
+
+    while (age + 1 < HR_DET_HIST_LEN && k > 0) {
+        uint32_t lo = det->hist[(k - 1) & HIST_MASK];
+        if (lo < level) {
+            uint32_t hi = det->hist[k & HIST_MASK];  // >= level, so hi > lo
+            uint64_t q = ((uint64_t)(level - lo) << 16) / (hi - lo);
+            *fid = k - 1;
+            *frac = (uint16_t)(q > 0xFFFF ? 0xFFFF : q);
+            return;
+        }
+        k--;
+        age++;
+    }
+
+    // Edge older than the history: fall back to the oldest sample held
+    *fid = k;
+}
+
+static void start_learning(hr_detector_t *det, uint32_t now)
+{
+    det->learning = true;
+    det->learn_start = now;
+    det->learn_max = 0;
+    det->learn_sum = 0;
+    det->have_beat = false;
+    det->rr_sum = 0;
+    det->rr_count = 0;
+    det->rr_pos = 0;
+    det->sb_limit = 0;
+    det->rr_refractory = det->refractory;
+    det->rr_dicrotic = det->dicrotic;
+    det->sb_val = 0;
+    memset(det->rr_buf, 0, sizeof(det->rr_buf));
+}
+
+static void accept_beat(hr_detector_t *det, uint32_t idx, uint32_t val,
+                        uint32_t fid, uint16_t fid_frac, bool searchback, hr_beat_t *beat)
+{
+    uint32_t rr = 0;
+
+    if (det->have_beat) {
+        rr = idx - det->last_beat;
+        det->rr_sum += rr - det->rr_buf[det->rr_pos];
+        det->rr_buf[det->rr_pos] = rr;
+        det->rr_pos = (det->rr_pos + 1) % HR_DET_RR_AVG;
+        if (det->rr_count < HR_DET_RR_AVG) {
+            det->rr_count++;
+        }
+        // Once per beat, so the divide stays off the per-sample path
+        uint32_t rr_avg = det->rr_sum / det->rr_count;
+        det->sb_limit = (rr_avg * 166) / 100;
+        det->rr_refractory = (rr_avg * HR_DET_REFRACTORY_RR_PCT) / 100;
+        if (det->rr_refractory < det->refractory) {
+            det->rr_refractory = det->refractory;
+        }
+        det->rr_dicrotic = (rr_avg * HR_DET_DICROTIC_RR_PCT) / 100;
+        if (det->rr_dicrotic > det->dicrotic) {
+            det->rr_dicrotic = det->dicrotic;
+        }
+    }
+
+    det->have_beat = true;
+    det->last_beat = idx;
+    det->last_amp = val;
+    det->sb_val = 0;
+
+    if (beat) {
+        beat->index = idx;
+        beat->rr_samples = rr;
+        beat->fiducial = fid;
+        beat->fiducial_frac = fid_frac;
+        beat->amplitude = val;
+        beat->searchback = searchback;
+    }
+}
+
+static bool classify_peak(hr_detector_t *det, uint32_t val, uint32_t idx, hr_beat_t *beat)
+{
+    // Inside the refractory period: ripple or the dicrotic wave of the
+    // same pulse, discard
+    if (det->have_beat && idx - det->last_beat < det->rr_refractory) {
+        return false;
+    }
+
+    // Small and close behind the beat: its dicrotic wave, discard
+    if (det->have_beat && idx - det->last_beat < det->rr_dicrotic &&
+        val < (det->last_amp >> 3) * 3) {
+        return false;
+    }
+
+    uint32_t fid;
+    uint16_t fid_frac;
+    find_fiducial(det, idx, val, &fid, &fid_frac);
+
+    if (val > det->thr1) {
+        det->spki = track_level(det->spki, val, 3);
+        update_threshold(det);
+        accept_beat(det, idx, val, fid, fid_frac, false, beat);
+        return true;
+    }
+
+    det->npki = track_level(det->npki, val, 3);
+    update_threshold(det);
+
+    // Remember the best candidate above the secondary threshold
+    if (val > (det->thr1 >> 1) && val > det->sb_val) {
+        det->sb_val = val;
+        det->sb_idx = idx;
+        det->sb_fid = fid;
+        det->sb_fid_frac = fid_frac;
+    }
+    return false;
+}
+
+void hr_detector_init(hr_detector_t *det, uint32_t sample_rate_hz)
+{
+    memset(det, 0, sizeof(*det));
+
+    if (sample_rate_hz > HR_DET_MAX_RATE_HZ) {
+        sample_rate_hz = HR_DET_MAX_RATE_HZ;
+    }
+
+    det->window = (HR_DET_WINDOW_MS * sample_rate_hz) / 1000;
+    if (det->window == 0) {
+        det->window = 1;
+    }
+    det->refractory = (HR_DET_REFRACTORY_MS * sample_rate_hz) / 1000;
+    det->dicrotic = (HR_DET_DICROTIC_MS * sample_rate_hz) / 1000;
+    det->learn_len = (HR_DET_LEARN_MS * sample_rate_hz) / 1000;
+    det->relearn_len = (HR_DET_RELEARN_MS * sample_rate_hz) / 1000;
+
+    start_learning(det, 0);
+}
+
+bool hr_detector_push(hr_detector_t *det, int32_t sample, hr_beat_t *beat)
+{
+    uint32_t n = det->index++;
+
+    // 5-point derivative, upstrokes only, squared
+    int32_t d = 2 * sample + det->x[0] - det->x[2] - 2 * det->x[3];
+    det->x[3] = det->x[2];
+    det->x[2] = det->x[1];
+    det->x[1] = det->x[0];
+    det->x[0] = sample;
+
+    if (n < 4 || d < 0) {
+        d = 0;
+    } else if (d > DERIV_CLAMP) {
+        d = DERIV_CLAMP;
+    }
+    uint32_t sq = (uint32_t)(d * d);
+
+    // Moving-window integration
+    det->win_sum += sq - det->win_buf[det->win_pos];
+    det->win_buf[det->win_pos] = sq;
+    if (++det->win_pos == det->window) {
+        det->win_pos = 0;
+    }
+    uint32_t y = det->win_sum;
+    det->hist[n & HIST_MASK] = y;
+
+    if (det->learning) {
+        if (y > det->learn_max) {
+            det->learn_max = y;
+        }
+        det->learn_sum += y;
+
+        if (n - det->learn_start + 1 >= det->learn_len) {
+            det->spki = det->learn_max >> 1;
+            det->npki = (uint32_t)(det->learn_sum / det->learn_len) >> 1;
+            update_threshold(det);
+            det->learning = false;
+            det->last_beat = n;
+            det->peak_val = y;
+            det->rising = false;
+        }
+        return false;
+    }
+
+    bool found = false;
+
+    // One peak per hump: declared once the integrator falls to half its
+    // max, or has not exceeded it for a full window (merged humps at
+    // high rates never fall that far)
+    if (y > det->peak_val) {
+        det->peak_val = y;
+        det->peak_idx = n;
+        det->rising = true;
+    } else if (det->rising &&
+               (y <= (det->peak_val >> 1) || n - det->peak_idx >= det->window)) {
+        found = classify_peak(det, det->peak_val, det->peak_idx, beat);
+        det->rising = false;
+        det->peak_val = y;
+    } else if (!det->rising) {
+        det->peak_val = y;
+    }
+
+    if (found) {
+        return true;
+    }
+
+    // Search-back for a beat missed by the primary threshold
+    if (det->have_beat && det->sb_val && det->sb_limit &&
+        n - det->last_beat > det->sb_limit) {
+        det->spki = track_level(det->spki, det->sb_val, 2);
+        update_threshold(det);
+        accept_beat(det, det->sb_idx, det->sb_val, det->sb_fid, det->sb_fid_frac, true, beat);
+        return true;
+    }
+
+    // Signal lost (finger moved, gain change) - relearn thresholds
+    if (n - det->last_beat > det->relearn_len) {
+        start_learning(det, n);
+    }
+
+    return false;
+}
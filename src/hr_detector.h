@@ -0,0 +1,126 @@
+#ifndef HR_DETECTOR_H
+#define HR_DETECTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Streaming adaptive-threshold beat detector (Pan-Tompkins style).
+ *
+ * Per sample: 5-point derivative -> half-wave squaring (upstrokes only)
+ * -> moving-window integration. Peaks of the integrated signal are
+ * classified against a threshold that tracks running signal (SPKI) and
+ * noise (NPKI) peak levels. A refractory period rejects double counts and
+ * a search-back recovers a missed beat from the best sub-threshold peak
+ * once 166% of the average RR has elapsed. The refractory period grows
+ * with the average RR, and a small peak soon after a beat is taken as its
+ * dicrotic wave (the T-wave test of Pan-Tompkins), so a slow pulse is not
+ * counted twice even before its average RR has settled.
+ *
+ * Integer arithmetic only; constant time and memory per sample.
+ */
+
+/* Integration window length (ms) and the largest supported sample rate */
+#define HR_DET_WINDOW_MS     150
+#define HR_DET_MAX_RATE_HZ  1000
+#define HR_DET_WINDOW_MAX   ((HR_DET_WINDOW_MS * HR_DET_MAX_RATE_HZ) / 1000)
+
+/* Refractory period after an accepted beat: at least HR_DET_REFRACTORY_MS
+ * (caps detection at 300 BPM), and at least HR_DET_REFRACTORY_RR_PCT
+ * percent of the average RR once there is one */
+#define HR_DET_REFRACTORY_MS     200
+#define HR_DET_REFRACTORY_RR_PCT  40
+
+/* Peaks under 3/8 of a beat's height are its dicrotic wave up to
+ * HR_DET_DICROTIC_MS after it, and no later than HR_DET_DICROTIC_RR_PCT
+ * percent of the average RR (fast pulses have no room for one) */
+#define HR_DET_DICROTIC_MS       500
+#define HR_DET_DICROTIC_RR_PCT    55
+
+/* Initial learning period and silence after which thresholds are relearned */
+#define HR_DET_LEARN_MS     2000
+#define HR_DET_RELEARN_MS   3000
+
+/* RR intervals averaged for the search-back limit */
+#define HR_DET_RR_AVG       8
+
+/* Integrator history kept for fiducial interpolation (power of two, must
+ * span the rise of one hump plus the window it takes to declare the peak) */
+#define HR_DET_HIST_LEN     512
+
+typedef struct {
+    uint32_t index;         /* Sample index of the beat (integrator peak) */
+    uint32_t rr_samples;    /* Samples since the previous beat, 0 if first */
+    uint32_t fiducial;      /* Last sample below the 50% rising-edge level */
+    uint16_t fiducial_frac; /* Crossing point past `fiducial`, Q16 samples */
+    uint32_t amplitude;     /* Integrator peak height */
+    bool searchback;        /* Recovered by search-back */
+} hr_beat_t;
+
+typedef struct {
+    /* Configuration derived from the sample rate */
+    uint32_t window;
+    uint32_t refractory;
+    uint32_t dicrotic;
+    uint32_t learn_len;
+    uint32_t relearn_len;
+
+    /* Filter state */
+    int32_t x[4];                         /* Derivative history */
+    uint32_t win_buf[HR_DET_WINDOW_MAX];  /* Squared slope ring */
+    uint32_t win_pos;
+    uint32_t win_sum;
+    uint32_t index;                       /* Samples processed */
+    uint32_t hist[HR_DET_HIST_LEN];       /* Integrator output ring */
+
+    /* Peak tracking on the integrated signal */
+    uint32_t peak_val;
+    uint32_t peak_idx;
+    bool rising;
+
+    /* Adaptive levels */
+    uint32_t spki;
+    uint32_t npki;
+    uint32_t thr1;
+    bool learning;
+    uint32_t learn_start;
+    uint32_t learn_max;
+    uint64_t learn_sum;
+
+    /* Beat history */
+    bool have_beat;
+    uint32_t last_beat;
+    uint32_t last_amp;                    /* Integrator peak of the last beat */
+    uint32_t rr_buf[HR_DET_RR_AVG];
+    uint32_t rr_sum;
+    uint32_t rr_count;
+    uint32_t rr_pos;
+    uint32_t sb_limit;                    /* 166% of the average RR */
+    uint32_t rr_refractory;               /* Refractory after the last beat */
+    uint32_t rr_dicrotic;                 /* Dicrotic window after it */
+
+    /* Best sub-threshold peak since the last beat (search-back) */
+    uint32_t sb_val;
+    uint32_t sb_idx;
+    uint32_t sb_fid;
+    uint16_t sb_fid_frac;
+} hr_detector_t;
+
+void hr_detector_init(hr_detector_t *det, uint32_t sample_rate_hz);
+
+/* Feed one sample. Returns true and fills *beat when a beat is accepted.
+ * Beats are reported with a delay of roughly one integration window.
+ * beat->fiducial + fiducial_frac is the interpolated point where the
+ * integrated upstroke crosses half its peak; it does not move with pulse
+ * amplitude, so intervals between fiducials are the precise RR. */
+bool hr_detector_push(hr_detector_t *det, int32_t sample, hr_beat_t *beat);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HR_DETECTOR_H */
@@ -0,0 +1,205 @@
+#ifndef HR_FILTER_H
+#define HR_FILTER_H
+
+/*
+ * Compile-time specialised fixed-point IIR filter bank (C++ only).
+ *
+ * Biquad coefficients are designed with constexpr math (RBJ cookbook) and
+ * quantised to Q-format as template constants, so the per-sample kernel
+ * is five 32x32->64 multiply-accumulates and a shift: no divisions, no
+ * floats. Sections run in Direct Form I with second-order error feedback
+ * (noise shaped by (1 - z^-1)^2), which keeps the near-unity poles of a
+ * low-cutoff high-pass quiet in fixed point.
+ */
+
+#include <stdint.h>
+#include <type_traits>
+
+// PPG band: high-pass removes baseline wander, low-pass removes noise
+#ifndef HR_FILTER_HP_MHZ
+#define HR_FILTER_HP_MHZ     500    // 0.5 Hz
+#endif
+#ifndef HR_FILTER_LP_MHZ
+#define HR_FILTER_LP_MHZ    5000    // 5 Hz (300 BPM fundamental)
+#endif
+
+// Mains notch frequency, 0 disables the section
+#ifndef HR_FILTER_NOTCH_HZ
+#define HR_FILTER_NOTCH_HZ    50
+#endif
+
+namespace hr_filter {
+
+struct Coeffs {
+    double b0, b1, b2, a1, a2;  // Normalised so a0 == 1
+};
+
+// constexpr trig (std:: versions are not constexpr)
+
+constexpr double kPi = 3.14159265358979323846;
+
+constexpr double cx_sin(double x)
+{
+    while (x > kPi) x -= 2.0 * kPi;
+    while (x < -kPi) x += 2.0 * kPi;
+
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 12; n++) {
+        term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cx_cos(double x)
+{
+    return cx_sin(x + kPi / 2.0);
+}
+
+// RBJ audio-EQ-cookbook designs
+
+enum class Kind { HighPass, LowPass, Notch };
+
+constexpr Coeffs design(Kind kind, double fs, double f0, double q)
+{
+    const double w0 = 2.0 * kPi * f0 / fs;
+    const double cw = cx_cos(w0);
+    const double alpha = cx_sin(w0) / (2.0 * q);
+    const double a0 = 1.0 + alpha;
+
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    switch (kind) {
+    case Kind::HighPass:
+        b0 = (1.0 + cw) / 2.0;
+        b1 = -(1.0 + cw);
+        b2 = b0;
+        break;
+    case Kind::LowPass:
+        b0 = (1.0 - cw) / 2.0;
+        b1 = 1.0 - cw;
+        b2 = b0;
+        break;
+    case Kind::Notch:
+        b0 = 1.0;
+        b1 = -2.0 * cw;
+        b2 = 1.0;
+        break;
+    }
+
+    return Coeffs{ b0 / a0, b1 / a0, b2 / a0, (-2.0 * cw) / a0, (1.0 - alpha) / a0 };
+}
+
+constexpr int32_t to_q(double v, int frac)
+{
+    return (int32_t)(v * (double)(1LL << frac) + (v >= 0.0 ? 0.5 : -0.5));
+}
+
+// Design descriptors: frequencies in mHz, Q in thousandths
+
+template <uint32_t Fs, uint32_t F0_mHz, uint32_t Q_milli = 707>
+struct HighPass {
+    static constexpr Coeffs value = design(Kind::HighPass, Fs, F0_mHz / 1000.0, Q_milli / 1000.0);
+};
+
+template <uint32_t Fs, uint32_t F0_mHz, uint32_t Q_milli = 707>
+struct LowPass {
+    static constexpr Coeffs value = design(Kind::LowPass, Fs, F0_mHz / 1000.0, Q_milli / 1000.0);
+};
+
+template <uint32_t Fs, uint32_t F0_mHz, uint32_t Q_milli = 5000>
+struct Notch {
+    static constexpr Coeffs value = design(Kind::Notch, Fs, F0_mHz / 1000.0, Q_milli / 1000.0);
+};
+
+// One second-order section
+
+template <typename Design, int Frac = 28>
+class Biquad {
+    static constexpr Coeffs c = Design::value;
+
+    static_assert(Frac > 8 && Frac <= 29, "Q-format out of range");
+    static_assert(c.a2 < 1.0 && c.a2 > -1.0 && (c.a1 < 1.0 + c.a2) && (-c.a1 < 1.0 + c.a2),
+                  "Biquad design is unstable");
+    static_assert(c.b1 > -4.0 && c.b1 < 4.0 && c.a1 > -4.0 && c.a1 < 4.0,
+                  "Coefficients do not fit the Q-format");
+
+    static constexpr int32_t b0 = to_q(c.b0, Frac);
+    static constexpr int32_t b1 = to_q(c.b1, Frac);
+    static constexpr int32_t b2 = to_q(c.b2, Frac);
+    static constexpr int32_t a1 = to_q(c.a1, Frac);
+    static constexpr int32_t a2 = to_q(c.a2, Frac);
+
+    // Steady-state gain for a constant input, used to prime the state
+    static constexpr int32_t dc_q16 = to_q((c.b0 + c.b1 + c.b2) / (1.0 + c.a1 + c.a2), 16);
+
+    int32_t x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+    int64_t e1 = 0, e2 = 0;  // Quantisation residues of the last two outputs
+
+public:
+    int32_t step(int32_t x)
+    {
+        int64_t acc = (int64_t)b0 * x + (int64_t)b1 * x1 + (int64_t)b2 * x2
+                    - (int64_t)a1 * y1 - (int64_t)a2 * y2 + 2 * e1 - e2;
+        int32_t y = (int32_t)(acc >> Frac);
+        e2 = e1;
+        e1 = acc - ((int64_t)y << Frac);
+
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        return y;
+    }
+
+    // Prime the section as if x had been applied forever; returns the
+    // settled output so a cascade can prime the next stage
+    int32_t reset(int32_t x)
+    {
+        int32_t y = (int32_t)(((int64_t)x * dc_q16) >> 16);
+        x1 = x2 = x;
+        y1 = y2 = y;
+        e1 = e2 = 0;
+        return y;
+    }
+};
+
+// Chain of sections, evaluated in order
+
+template <typename... Stages>
+class Cascade;
+
+template <>
+class Cascade<> {
+public:
+    int32_t step(int32_t x) { return x; }
+    int32_t reset(int32_t x) { return x; }
+};
+
+template <typename First, typename... Rest>
+class Cascade<First, Rest...> {
+    First head;
+    Cascade<Rest...> tail;
+
+public:
+    int32_t step(int32_t x) { return tail.step(head.step(x)); }
+    int32_t reset(int32_t x) { return tail.reset(head.reset(x)); }
+};
+
+// Pulse-sensor conditioning at sample rate Fs: band-pass plus optional notch
+
+template <uint32_t Fs>
+using PpgBandPass = Cascade<Biquad<HighPass<Fs, HR_FILTER_HP_MHZ>>,
+                            Biquad<LowPass<Fs, HR_FILTER_LP_MHZ>>>;
+
+template <uint32_t Fs>
+using PpgFilter = typename std::conditional<
+    (HR_FILTER_NOTCH_HZ != 0),
+    Cascade<Biquad<HighPass<Fs, HR_FILTER_HP_MHZ>>,
+            Biquad<LowPass<Fs, HR_FILTER_LP_MHZ>>,
+            Biquad<Notch<Fs, HR_FILTER_NOTCH_HZ * 1000>>>,
+    PpgBandPass<Fs>>::type;
+
+}  // namespace hr_filter
+
+#endif /* HR_FILTER_H */
@@ -0,0 +1,75 @@
+#include "hr_hrv.h"
+#include "hr_math.h"
+
+#include <string.h>
+
+static uint32_t diff_sq(uint16_t a, uint16_t b)
+{
+    int32_t d = (int32_t)a - (int32_t)b;
+    return (uint32_t)(d * d);
+}
+
+void hr_hrv_reset(hr_hrv_t *hrv)
+{
+    memset(hrv, 0, sizeof(*hrv));
+}
+
+void hr_hrv_add(hr_hrv_t *hrv, uint16_t rr_ms)
+{
+    if (hrv->count == HR_HRV_WINDOW) {
+        // Evict the oldest interval and the pair it starts
+        uint16_t oldest = hrv->rr[hrv->pos];
+        uint16_t next = hrv->rr[(hrv->pos + 1) % HR_HRV_WINDOW];
+        uint32_t d2 = diff_sq(next, oldest);
+
+        hrv->sum -= oldest;
+        hrv->sum_sq -= (uint64_t)oldest * oldest;
+        hrv->diff_sq -= d2;
+        if (d2 > 50 * 50) {
+            hrv->nn50--;
+        }
+        hrv->count--;
+    }
+
+    if (hrv->count > 0) {
+        uint16_t newest = hrv->rr[(hrv->pos + HR_HRV_WINDOW - 1) % HR_HRV_WINDOW];
+        uint32_t d2 = diff_sq(rr_ms, newest);
+
+        hrv->diff_sq += d2;
+        if (d2 > 50 * 50) {
+            hrv->nn50++;
+        }
+    }
+
+    hrv->rr[hrv->pos] = rr_ms;
+    hrv->pos = (hrv->pos + 1) % HR_HRV_WINDOW;
+    hrv->sum += rr_ms;
+    hrv->sum_sq += (uint64_t)rr_ms * rr_ms;
+    hrv->count++;
+}
+
+void hr_hrv_get(const hr_hrv_t *hrv, hr_hrv_metrics_t *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    uint32_t n = hrv->count;
+    out->count = (uint16_t)n;
+    if (n == 0) {
+        return;
+    }
+
+    uint32_t mean = (hrv->sum + n / 2) / n;
+    out->mean_rr_ms = (uint16_t)mean;
+    out->mean_bpm = mean ? (uint16_t)((60000 + mean / 2) / mean) : 0;
+
+    if (n < 2) {
+        return;
+    }
+
+    // Sample variance: (sum_sq - sum^2 / n) / (n - 1)
+    uint64_t sq_mean = ((uint64_t)hrv->sum * hrv->sum) / n;
+    uint64_t var = hrv->sum_sq > sq_mean ? (hrv->sum_sq - sq_mean) / (n - 1) : 0;
+    out->sdnn_ms = (uint16_t)hr_isqrt64(var);
+    out->rmssd_ms = (uint16_t)hr_isqrt64(hrv->diff_sq / (n - 1));
+    out->pnn50 = (uint8_t)((hrv->nn50 * 100 + (n - 1) / 2) / (n - 1));
+}
@@ -0,0 +1,47 @@
+#ifndef HR_HRV_H
+#define HR_HRV_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Rolling HRV statistics over the last HR_HRV_WINDOW RR intervals.
+ *
+ * Sums of RR, RR^2, squared successive differences and the NN50 count
+ * are maintained incrementally, so adding a beat is O(1) regardless of
+ * the window length. Square roots are only taken when metrics are read.
+ */
+
+#define HR_HRV_WINDOW  64   /* RR intervals (~1 min at rest) */
+
+typedef struct {
+    uint16_t rr[HR_HRV_WINDOW];
+    uint32_t pos;           /* Next slot to write (oldest when full) */
+    uint32_t count;
+    uint32_t sum;           /* Sum of RR */
+    uint64_t sum_sq;        /* Sum of RR^2 */
+    uint64_t diff_sq;       /* Sum of squared successive differences */
+    uint32_t nn50;          /* Successive differences > 50 ms */
+} hr_hrv_t;
+
+typedef struct {
+    uint16_t count;         /* RR intervals in the window */
+    uint16_t mean_rr_ms;
+    uint16_t mean_bpm;
+    uint16_t rmssd_ms;
+    uint16_t sdnn_ms;
+    uint8_t pnn50;          /* Percent */
+} hr_hrv_metrics_t;
+
+void hr_hrv_reset(hr_hrv_t *hrv);
+void hr_hrv_add(hr_hrv_t *hrv, uint16_t rr_ms);
+void hr_hrv_get(const hr_hrv_t *hrv, hr_hrv_metrics_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HR_HRV_H */
@@ -0,0 +1,29 @@
+#ifndef HR_MATH_H
+#define HR_MATH_H
+
+#include <stdint.h>
+
+/* Integer helpers shared by the HRV and signal-quality code */
+
+/* Floor of the square root, bit by bit; no FPU or libm needed */
+static inline uint32_t hr_isqrt64(uint64_t v)
+{
+    uint64_t res = 0;
+    uint64_t bit = 1ull << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)res;
+}
+
+#endif /* HR_MATH_H */
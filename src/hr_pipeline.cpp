@@ -0,0 +1,200 @@
+#include "hr_pipeline.h"
+#include "hr_detector.h"
+#include "hr_filter.h"
+#include "hr_quality.h"
+
+#include <atomic>
+#include <string.h>
+
+// Sample period, fixed by the compile-time rate (no runtime divide)
+#define US_PER_SAMPLE (1000000 / HR_SAMPLE_RATE_HZ)
+
+static_assert(1000000 % HR_SAMPLE_RATE_HZ == 0, "HR_SAMPLE_RATE_HZ must divide 1 MHz");
+
+// Signal conditioning: band-pass (+ mains notch) specialised for the rate
+static hr_filter::PpgFilter<HR_SAMPLE_RATE_HZ> ppg_filter;
+static bool filter_primed = false;
+
+// The detector and quality count samples from their start; index_base is
+// the stream index they started at, next_index the one expected next
+static uint32_t index_base = 0;
+static uint32_t next_index = 0;
+
+// Beat detection variables
+static hr_detector_t detector;
+static uint32_t beat_times[HR_BPM_AVG_BEATS];  // RR intervals (us)
+static uint32_t beat_sum = 0;
+static int beat_index = 0;
+static int beat_count = 0;
+static uint64_t last_beat_time = 0;             // Fiducial of the last detection (us)
+static std::atomic<int> current_bpm(0);
+
+static hr_hrv_t hrv;
+static hr_quality_t quality;
+static std::atomic<int> current_quality(0);
+static hr_pipeline_stats_t stats;
+
+static void reset_beats(void)
+{
+    current_bpm.store(0, std::memory_order_relaxed);
+    beat_count = 0;
+    beat_index = 0;
+    beat_sum = 0;
+    memset(beat_times, 0, sizeof(beat_times));
+
+    // Successive differences across a gap are meaningless - restart HRV
+    hr_hrv_reset(&hrv);
+}
+
+static bool handle_beat(const hr_beat_t *det, hr_beat_event_t *beat)
+{
+    // RR between interpolated fiducials rather than whole-sample peaks
+    uint64_t beat_time = hr_pipeline_index_to_us(index_base + det->fiducial, det->fiducial_frac);
+    uint32_t interval = (uint32_t)(beat_time - last_beat_time);
+    bool valid = det->rr_samples > 0 &&
+                 interval >= HR_MIN_INTERVAL_US && interval <= HR_MAX_INTERVAL_US;
+
+    // Score every detection so the template and window see all of them
+    uint8_t beat_quality = hr_quality_beat(&quality, det->fiducial);
+    if (det->searchback) {
+        beat_quality -= beat_quality / 4;  // Recovered beats are less certain
+    }
+
+    stats.detections++;
+    if (det->searchback) {
+        stats.searchbacks++;
+    }
+    last_beat_time = beat_time;
+
+    if (!valid) {
+        if (det->rr_samples > 0) {
+            stats.rejected++;
+        }
+        return false;
+    }
+
+    memset(beat, 0, sizeof(*beat));
+    beat->timestamp_us = beat_time;
+    beat->rr_us = interval;
+    beat->quality = beat_quality;
+
+    // Artifact: publish flagged by its quality, keep it out of BPM and HRV
+    if (beat_quality < HR_QUALITY_MIN) {
+        stats.suppressed++;
+        beat->bpm = (uint16_t)current_bpm.load(std::memory_order_relaxed);
+        hr_beat_channel_publish(beat);
+        return true;
+    }
+
+    // Running sum over the last HR_BPM_AVG_BEATS intervals
+    beat_sum += interval - beat_times[beat_index];
+    beat_times[beat_index] = interval;
+    beat_index = (beat_index + 1) % HR_BPM_AVG_BEATS;
+    if (beat_count < HR_BPM_AVG_BEATS) beat_count++;
+
+    // Only update BPM if we have enough beats
+    if (beat_count >= HR_REQUIRED_BEATS) {
+        uint64_t bpm = (60000000ull * beat_count + beat_sum / 2) / beat_sum;
+        current_bpm.store((int)bpm, std::memory_order_relaxed);
+    }
+
+    hr_hrv_add(&hrv, (uint16_t)((interval + 500) / 1000));
+
+    beat->bpm = (uint16_t)current_bpm.load(std::memory_order_relaxed);
+    hr_beat_channel_publish(beat);
+    return true;
+}
+
+void hr_pipeline_init(void)
+{
+    filter_primed = false;
+    last_beat_time = 0;
+    memset(&stats, 0, sizeof(stats));
+    hr_detector_init(&detector, HR_SAMPLE_RATE_HZ);
+    hr_quality_init(&quality, HR_SAMPLE_RATE_HZ);
+    current_quality.store(0, std::memory_order_relaxed);
+    reset_beats();
+}
+
+uint32_t hr_pipeline_push(uint32_t index, int32_t mv, hr_beat_event_t *beat)
+{
+    uint32_t result = 0;
+    stats.samples++;
+
+    // Samples missing: the filter and detector history no longer fit the
+    // stream, so start them over at this index, and any lock with them
+    if (filter_primed && index != next_index) {
+        stats.gaps++;
+        filter_primed = false;
+        hr_detector_init(&detector, HR_SAMPLE_RATE_HZ);
+        hr_quality_init(&quality, HR_SAMPLE_RATE_HZ);
+        last_beat_time = 0;
+        if (beat_count > 0) {
+            reset_beats();
+            result |= HR_PIPE_RESET;
+        }
+    }
+    next_index = index + 1;
+
+    // Prime on the first sample so the high-pass does not ring from 0 mV
+    if (!filter_primed) {
+        ppg_filter.reset(mv);
+        filter_primed = true;
+        index_base = index;
+    }
+    int32_t filtered = ppg_filter.step(mv);
+
+    if (hr_quality_push(&quality, mv, filtered)) {
+        hr_quality_window_t win;
+        hr_quality_get(&quality, &win);
+        current_quality.store(win.score, std::memory_order_relaxed);
+        result |= HR_PIPE_QUALITY;
+    }
+
+    // Adaptive-threshold detection (reports beats ~one window late)
+    hr_beat_t det;
+    if (hr_detector_push(&detector, filtered, &det) && handle_beat(&det, beat)) {
+        result |= HR_PIPE_BEAT;
+    }
+
+    // Reset BPM if no beat detected for too long
+    uint64_t now = hr_pipeline_index_to_us(index, 0);
+    if (beat_count > 0 && now > last_beat_time + HR_SIGNAL_LOST_US) {
+        reset_beats();
+        result |= HR_PIPE_RESET;
+    }
+
+    return result;
+}
+
+int hr_pipeline_bpm(void)
+{
+    return current_bpm.load(std::memory_order_relaxed);
+}
+
+uint64_t hr_pipeline_index_to_us(uint32_t index, uint16_t frac_q16)
+{
+    return (uint64_t)index * US_PER_SAMPLE + (((uint32_t)frac_q16 * US_PER_SAMPLE) >> 16);
+}
+
+int hr_pipeline_quality(void)
+{
+    return current_quality.load(std::memory_order_relaxed);
+}
+
+bool hr_pipeline_get_quality(hr_quality_window_t *out)
+{
+    return hr_quality_get(&quality, out);
+}
+
+void hr_pipeline_get_hrv(hr_hrv_metrics_t *out)
+{
+    hr_hrv_get(&hrv, out);
+}
+
+void hr_pipeline_get_stats(hr_pipeline_stats_t *out)
+{
+    if (out) {
+        *out = stats;
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef HR_PIPELINE_H
+#define HR_PIPELINE_H
+
+#include <stdint.h>
+
+#include "hr_beat_channel.h"
+#include "hr_hrv.h"
+#include "hr_quality.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Heart-rate signal pipeline, per decimated sample:
+ *   band-pass filter -> adaptive beat detector -> RR validation
+ *   -> signal quality -> rolling BPM + HRV -> beat channel.
+ *
+ * Beats scoring below HR_QUALITY_MIN are still published (with their
+ * quality) but never enter the BPM average or HRV.
+ *
+ * Hardware-free so the same code runs on target (fed by the ADC DMA
+ * sampler in heart_rate.cpp) and on the host (fed by tools/hr_replay).
+ * Single instance, driven from one task.
+ *
+ * Time is the sample index of the continuous stream, so beat times and
+ * RR intervals are exact to the interpolated crossing (microseconds)
+ * regardless of when the task gets scheduled. A jump in the index (blocks
+ * the sampler dropped on overrun) restarts the filter, detector and
+ * quality scoring from the new index, as after init.
+ */
+
+/* Decimated sample rate the filters and detector are specialised for */
+#ifndef HR_SAMPLE_RATE_HZ
+#define HR_SAMPLE_RATE_HZ 500
+#endif
+
+#define HR_MIN_INTERVAL_US  300000   /* 200 BPM max */
+#define HR_MAX_INTERVAL_US 2000000   /* 30 BPM min */
+#define HR_REQUIRED_BEATS     3   /* Beats needed before BPM is reported */
+#define HR_BPM_AVG_BEATS     10   /* Intervals averaged for reported BPM */
+#define HR_SIGNAL_LOST_US 5000000  /* No beat for this long resets BPM/HRV */
+
+/* Result flags from hr_pipeline_push() */
+#define HR_PIPE_BEAT   0x01  /* Validated beat published, *beat filled */
+#define HR_PIPE_RESET  0x02  /* Signal lost, BPM and HRV were reset */
+#define HR_PIPE_QUALITY 0x04 /* Quality window closed */
+
+typedef struct {
+    uint32_t samples;
+    uint32_t detections;    /* Beats reported by the detector */
+    uint32_t rejected;      /* Detections whose RR failed validation */
+    uint32_t searchbacks;   /* Detections recovered by search-back */
+    uint32_t suppressed;    /* Beats flagged as artifacts */
+    uint32_t gaps;          /* Jumps in the sample index */
+} hr_pipeline_stats_t;
+
+void hr_pipeline_init(void);
+
+/* Process one calibrated sample (mV) taken at sample index `index`;
+ * HR_PIPE_RESET is also returned when a gap in the index drops the lock */
+uint32_t hr_pipeline_push(uint32_t index, int32_t mv, hr_beat_event_t *beat);
+
+/* Current averaged BPM, 0 when not locked. Safe from any task. */
+int hr_pipeline_bpm(void);
+
+/* Score of the last quality window (0-100). Safe from any task. */
+int hr_pipeline_quality(void);
+
+/* Detail of the last quality window (pipeline task only) */
+bool hr_pipeline_get_quality(hr_quality_window_t *out);
+
+/* Convert a sample index plus Q16 fraction to microseconds */
+uint64_t hr_pipeline_index_to_us(uint32_t index, uint16_t frac_q16);
+
+/* Rolling HRV metrics (pipeline task only) */
+void hr_pipeline_get_hrv(hr_hrv_metrics_t *out);
+
+void hr_pipeline_get_stats(hr_pipeline_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HR_PIPELINE_H */
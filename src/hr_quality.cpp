@@ -0,0 +1,214 @@
+#include "hr_quality.h"
+#include "hr_math.h"
+
+#include <string.h>
+
+#define HIST_MASK (HR_Q_HIST_LEN - 1)
+
+static_assert((HR_Q_HIST_LEN & HIST_MASK) == 0, "HR_Q_HIST_LEN must be a power of two");
+static_assert(HR_Q_HIST_LEN >= 2 * HR_Q_TEMPLATE_MAX, "HR_Q_HIST_LEN too short for the segment");
+
+// Correlation below this counts as a template miss (percent)
+#define MATCH_CORR_PCT 80
+
+// Amplitude further than this from the reference is an outlier (percent)
+#define MATCH_AMP_DEV_PCT 50
+
+static uint8_t clamp_pct(int32_t v)
+{
+    return (uint8_t)(v < 0 ? 0 : (v > 100 ? 100 : v));
+}
+
+static void start_window(hr_quality_t *q)
+{
+    q->win_count = 0;
+    q->win_clipped = 0;
+    q->win_min = INT32_MAX;
+    q->win_max = INT32_MIN;
+    q->win_beats = 0;
+    q->win_corr_sum = 0;
+    q->win_amp_dev_sum = 0;
+}
+
+static void close_window(hr_quality_t *q)
+{
+    hr_quality_window_t *w = &q->last;
+
+    w->clipped_pct = (uint8_t)((100 * q->win_clipped) / q->win_count);
+    w->flatline = q->win_max - q->win_min < HR_Q_FLAT_MV;
+    w->beats = (uint16_t)q->win_beats;
+
+    // A slow heart can leave one window empty; two in a row is no pulse
+    if (q->win_beats) {
+        w->correlation = (uint8_t)(q->win_corr_sum / q->win_beats);
+        w->amp_dev_pct = clamp_pct((int32_t)(q->win_amp_dev_sum / q->win_beats));
+        q->idle_windows = 0;
+    } else if (++q->idle_windows > 1) {
+        w->correlation = 0;
+        w->amp_dev_pct = 0;
+    }
+
+    // Correlation 0.5 -> 0, 1.0 -> 100; clipping and amplitude spread
+    // subtract from there
+    int32_t score = 2 * ((int32_t)w->correlation - 50);
+    score -= 4 * w->clipped_pct;
+    score -= w->amp_dev_pct / 2;
+    w->score = w->flatline ? 0 : clamp_pct(score);
+
+    q->have_window = true;
+}
+
+void hr_quality_init(hr_quality_t *q, uint32_t sample_rate_hz)
+{
+    memset(q, 0, sizeof(*q));
+
+    if (sample_rate_hz > HR_Q_MAX_RATE_HZ) {
+        sample_rate_hz = HR_Q_MAX_RATE_HZ;
+    }
+
+    q->window_len = (HR_QUALITY_WINDOW_MS * sample_rate_hz) / 1000;
+    q->pre = (HR_Q_PRE_MS * sample_rate_hz) / 1000;
+    q->seg_len = ((HR_Q_PRE_MS + HR_Q_POST_MS) * sample_rate_hz) / 1000;
+    if (q->window_len == 0) q->window_len = 1;
+    if (q->seg_len < 2) q->seg_len = 2;
+
+    start_window(q);
+}
+
+bool hr_quality_push(hr_quality_t *q, int32_t raw_mv, int32_t filtered)
+{
+    q->hist[q->index & HIST_MASK] = filtered;
+    q->index++;
+
+    if (raw_mv <= HR_Q_CLIP_LOW_MV || raw_mv >= HR_Q_CLIP_HIGH_MV) {
+        q->win_clipped++;
+    }
+    if (filtered < q->win_min) q->win_min = filtered;
+    if (filtered > q->win_max) q->win_max = filtered;
+
+    if (++q->win_count < q->window_len) {
+        return false;
+    }
+
+    close_window(q);
+    start_window(q);
+    return true;
+}
+
+// Pearson correlation of the segment with the template (percent, >= 0).
+// Also updates the template and the amplitude history, and reports how
+// far this beat's amplitude is from the recent mean (percent).
+static uint8_t match_template(hr_quality_t *q, uint32_t start, uint32_t *amp_dev)
+{
+    const uint32_t n = q->seg_len;
+    int64_t sx = 0, sxx = 0, st = 0, stt = 0, stx = 0;
+    int32_t lo = INT32_MAX, hi = INT32_MIN;
+
+    for (uint32_t i = 0; i < n; i++) {
+        int32_t x = q->hist[(start + i) & HIST_MASK];
+        sx += x;
+        if (x < lo) lo = x;
+        if (x > hi) hi = x;
+    }
+    int32_t mean = (int32_t)(sx / (int64_t)n);
+
+    // Beat amplitude (peak-to-trough) against the recent consistent beats
+    uint32_t amp = (uint32_t)(hi - lo);
+    uint32_t ref = q->amp_count ? q->amp_sum / q->amp_count : amp;
+    uint32_t diff = amp > ref ? amp - ref : ref - amp;
+    *amp_dev = ref ? (100 * diff) / ref : 0;
+
+    // Outliers stay out of the reference so one burst does not skew the
+    // beats after it; a run of them means the gain really changed
+    if (*amp_dev < MATCH_AMP_DEV_PCT || ++q->amp_outliers >= HR_Q_RESEED_BEATS) {
+        if (q->amp_outliers >= HR_Q_RESEED_BEATS) {
+            q->amp_count = 0;
+            q->amp_sum = 0;
+            memset(q->amp, 0, sizeof(q->amp));
+        }
+        q->amp_sum += amp - q->amp[q->amp_pos];
+        q->amp[q->amp_pos] = amp;
+        q->amp_pos = (q->amp_pos + 1) % HR_Q_AMP_BEATS;
+        if (q->amp_count < HR_Q_AMP_BEATS) q->amp_count++;
+        q->amp_outliers = 0;
+    }
+
+    if (!q->have_tmpl) {
+        for (uint32_t i = 0; i < n; i++) {
+            q->tmpl[i] = (q->hist[(start + i) & HIST_MASK] - mean) * 16;
+        }
+        q->have_tmpl = true;
+        return 100;
+    }
+
+    sx = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        int64_t x = q->hist[(start + i) & HIST_MASK] - mean;
+        int64_t t = q->tmpl[i];
+        sx += x;
+        sxx += x * x;
+        st += t;
+        stt += t * t;
+        stx += t * x;
+    }
+
+    int64_t vx = sxx - (sx * sx) / (int64_t)n;
+    int64_t vt = stt - (st * st) / (int64_t)n;
+    int64_t cov = stx - (st * sx) / (int64_t)n;
+    uint64_t den = (uint64_t)hr_isqrt64(vx > 0 ? (uint64_t)vx : 0) *
+                   hr_isqrt64(vt > 0 ? (uint64_t)vt : 0);
+    uint8_t corr = den ? clamp_pct((int32_t)((100 * cov) / (int64_t)den)) : 0;
+
+    if (corr >= MATCH_CORR_PCT && *amp_dev < MATCH_AMP_DEV_PCT) {
+        // Track slow morphology changes from good beats only
+        for (uint32_t i = 0; i < n; i++) {
+            int32_t x = (q->hist[(start + i) & HIST_MASK] - mean) * 16;
+            q->tmpl[i] += (x - q->tmpl[i]) >> 3;
+        }
+        q->misses = 0;
+    } else if (++q->misses >= HR_Q_RESEED_BEATS) {
+        // Shape changed for good (finger moved): adopt the new beat
+        for (uint32_t i = 0; i < n; i++) {
+            q->tmpl[i] = (q->hist[(start + i) & HIST_MASK] - mean) * 16;
+        }
+        q->misses = 0;
+    }
+
+    return corr;
+}
+
+uint8_t hr_quality_beat(hr_quality_t *q, uint32_t fiducial)
+{
+    uint32_t start = fiducial - q->pre;
+    uint32_t end = start + q->seg_len;
+    uint32_t amp_dev = 0;
+    uint8_t corr;
+
+    // Segment must be complete and still held in the history
+    if (fiducial < q->pre || end > q->index || q->index - start > HR_Q_HIST_LEN) {
+        corr = q->last_corr;
+    } else {
+        corr = match_template(q, start, &amp_dev);
+        q->last_corr = corr;
+    }
+
+    q->win_beats++;
+    q->win_corr_sum += corr;
+    q->win_amp_dev_sum += amp_dev;
+
+    // Same terms as the window score, for this beat alone
+    int32_t score = 2 * ((int32_t)corr - 50);
+    score -= (int32_t)(amp_dev / 2);
+    if (q->win_count) {
+        score -= (int32_t)((400 * q->win_clipped) / q->win_count);
+    }
+    return clamp_pct(score);
+}
+
+bool hr_quality_get(const hr_quality_t *q, hr_quality_window_t *out)
+{
+    if (out) {
+        *out = q->last;
+    }
+    return q->have_window;
+}
@@ -0,0 +1,118 @@
+#ifndef HR_QUALITY_H
+#define HR_QUALITY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Streaming signal quality index for the pulse waveform.
+ *
+ * Every sample updates cheap per-window accumulators: rail clipping on
+ * the calibrated input and peak-to-peak of the filtered signal
+ * (flatline). Every beat cuts a short segment around its fiducial out
+ * of a history ring and correlates it with a running beat template,
+ * and compares its amplitude with the recent consistent beats. At the
+ * end of each window the terms are combined into a 0-100 score.
+ *
+ * Motion artifacts show up as poor template correlation and erratic
+ * amplitude, a lost finger as flatline, a saturated front end as
+ * clipping. Integer arithmetic only.
+ */
+
+#define HR_QUALITY_WINDOW_MS   2000
+#ifndef HR_QUALITY_MIN
+#define HR_QUALITY_MIN           50   /* Scores below this are artifacts */
+#endif
+
+/* Input limits (mV) treated as clipped at the ADC rails */
+#define HR_Q_CLIP_LOW_MV         10
+#define HR_Q_CLIP_HIGH_MV      3100
+
+/* Filtered peak-to-peak below this over a window counts as no pulse */
+#define HR_Q_FLAT_MV              8
+
+/* Beat segment around the fiducial used for template matching */
+#define HR_Q_PRE_MS             100
+#define HR_Q_POST_MS            100
+#define HR_Q_MAX_RATE_HZ       1000
+#define HR_Q_TEMPLATE_MAX   (((HR_Q_PRE_MS + HR_Q_POST_MS) * HR_Q_MAX_RATE_HZ) / 1000)
+
+/* Filtered-signal history (power of two), covers a beat's report delay */
+#define HR_Q_HIST_LEN           512
+
+/* Beat amplitudes in the amplitude reference */
+#define HR_Q_AMP_BEATS            8
+
+/* Consecutive mismatching beats before the template or amplitude
+ * reference is reseeded */
+#define HR_Q_RESEED_BEATS         8
+
+typedef struct {
+    uint8_t score;          /* 0-100 overall */
+    uint8_t clipped_pct;    /* Samples at the rails */
+    uint8_t correlation;    /* Mean beat/template agreement, 0-100 */
+    uint8_t amp_dev_pct;    /* Mean beat amplitude deviation from the reference */
+    bool flatline;          /* No pulsatile component */
+    uint16_t beats;         /* Beats scored in the window */
+} hr_quality_window_t;
+
+typedef struct {
+    /* Configuration derived from the sample rate */
+    uint32_t window_len;
+    uint32_t pre;
+    uint32_t seg_len;
+
+    /* Filtered signal history */
+    int32_t hist[HR_Q_HIST_LEN];
+    uint32_t index;
+
+    /* Current window */
+    uint32_t win_count;
+    uint32_t win_clipped;
+    int32_t win_min;
+    int32_t win_max;
+    uint32_t win_beats;
+    uint32_t win_corr_sum;
+    uint32_t win_amp_dev_sum;
+    uint32_t idle_windows;  /* Consecutive windows without a beat */
+
+    /* Beat template, mean removed, Q4 */
+    int32_t tmpl[HR_Q_TEMPLATE_MAX];
+    bool have_tmpl;
+    uint32_t misses;
+    uint8_t last_corr;
+
+    /* Amplitudes of recent consistent beats */
+    uint32_t amp[HR_Q_AMP_BEATS];
+    uint32_t amp_pos;
+    uint32_t amp_count;
+    uint32_t amp_sum;
+    uint32_t amp_outliers;
+
+    hr_quality_window_t last;   /* Most recent closed window */
+    bool have_window;
+} hr_quality_t;
+
+void hr_quality_init(hr_quality_t *q, uint32_t sample_rate_hz);
+
+/* Feed one sample: calibrated input and the filtered signal. Returns true
+ * when a window closed and hr_quality_get() has a new result. */
+bool hr_quality_push(hr_quality_t *q, int32_t raw_mv, int32_t filtered);
+
+/* Score a detected beat by its fiducial sample index (same count as the
+ * samples pushed): template correlation, amplitude against the recent
+ * mean and clipping so far in the window. Returns 0-100. */
+uint8_t hr_quality_beat(hr_quality_t *q, uint32_t fiducial);
+
+/* Result of the last closed window, false before the first one */
+bool hr_quality_get(const hr_quality_t *q, hr_quality_window_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HR_QUALITY_H */
@@ -0,0 +1,132 @@
+#include "hr_sampler.h"
+
+#include <atomic>
+#include <string.h>
+
+#define RING_MASK (HR_SAMPLER_RING_BLOCKS - 1)
+
+static_assert((HR_SAMPLER_RING_BLOCKS & RING_MASK) == 0,
+              "HR_SAMPLER_RING_BLOCKS must be a power of two");
+
+// Decimator state (producer only)
+static uint32_t decimation = 1;
+static uint32_t recip_q16 = 1u << 16;   // 1/decimation in Q16
+static uint32_t ms_per_sample_q16 = 0;  // 1000/out_rate in Q16
+static uint32_t out_rate_hz = 0;
+static uint32_t acc_sum = 0;
+static uint32_t acc_count = 0;
+static uint32_t next_index = 0;
+
+// Block being filled, published into the ring when complete
+static hr_block_t staging;
+static uint32_t staging_fill = 0;
+static uint32_t next_seq = 0;
+
+// SPSC ring: producer owns head, consumer owns tail
+static hr_block_t ring[HR_SAMPLER_RING_BLOCKS];
+static std::atomic<uint32_t> ring_head(0);
+static std::atomic<uint32_t> ring_tail(0);
+
+static hr_sampler_stats_t stats;
+
+uint32_t hr_sampler_init(uint32_t raw_rate_hz, uint32_t rate_hz)
+{
+    if (rate_hz == 0) {
+        rate_hz = 1;
+    }
+
+    decimation = raw_rate_hz / rate_hz;
+    if (decimation == 0) {
+        decimation = 1;
+    }
+    recip_q16 = ((1u << 16) + decimation / 2) / decimation;
+    ms_per_sample_q16 = (uint32_t)((1000ull << 16) / rate_hz);
+    out_rate_hz = rate_hz;
+
+    acc_sum = 0;
+    acc_count = 0;
+    next_index = 0;
+    staging_fill = 0;
+    next_seq = 0;
+    ring_head.store(0, std::memory_order_relaxed);
+    ring_tail.store(0, std::memory_order_relaxed);
+    memset(&stats, 0, sizeof(stats));
+
+    return decimation;
+}
+
+uint32_t hr_sampler_rate_hz(void)
+{
+    return out_rate_hz;
+}
+
+static void publish_staging(void)
+{
+    staging.seq = next_seq++;
+    stats.blocks++;
+
+    uint32_t head = ring_head.load(std::memory_order_relaxed);
+    uint32_t tail = ring_tail.load(std::memory_order_acquire);
+
+    if (head - tail >= HR_SAMPLER_RING_BLOCKS) {
+        // Consumer fell behind - drop the newest block, keep timing intact
+        stats.overruns++;
+        return;
+    }
+
+    ring[head & RING_MASK] = staging;
+    ring_head.store(head + 1, std::memory_order_release);
+}
+
+void hr_sampler_push_raw(const uint16_t *raw, size_t count)
+{
+    stats.raw_samples += count;
+
+    for (size_t i = 0; i < count; i++) {
+        acc_sum += raw[i];
+        if (++acc_count < decimation) {
+            continue;
+        }
+
+        uint16_t sample = (uint16_t)((acc_sum * recip_q16 + (1u << 15)) >> 16);
+        acc_sum = 0;
+        acc_count = 0;
+
+        if (staging_fill == 0) {
+            staging.first_index = next_index;
+        }
+        staging.samples[staging_fill++] = sample;
+        next_index++;
+
+        if (staging_fill == HR_SAMPLER_BLOCK_SAMPLES) {
+            publish_staging();
+            staging_fill = 0;
+        }
+    }
+}
+
+bool hr_sampler_pop_block(hr_block_t *out)
+{
+    uint32_t tail = ring_tail.load(std::memory_order_relaxed);
+    uint32_t head = ring_head.load(std::memory_order_acquire);
+
+    if (tail == head) {
+        return false;
+    }
+
+    *out = ring[tail & RING_MASK];
+    ring_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+uint32_t hr_sampler_index_to_ms(uint32_t index)
+{
+    return (uint32_t)(((uint64_t)index * ms_per_sample_q16) >> 16);
+}
+
+void hr_sampler_get_stats(hr_sampler_stats_t *out)
+{
+    if (out) {
+        *out = stats;
+    }
+}
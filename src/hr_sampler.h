@@ -0,0 +1,62 @@
+#ifndef HR_SAMPLER_H
+#define HR_SAMPLER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Sampling core for the heart-rate front end.
+ *
+ * Raw ADC conversions (from the continuous-mode DMA driver on target, or a
+ * synthetic source on the host) are box-car decimated to a fixed output
+ * rate and packed into fixed-size blocks. Completed blocks sit in a small
+ * single-producer/single-consumer ring until the detector pops them.
+ * No ESP-IDF dependencies so it builds on the host as-is.
+ */
+
+/* Decimated samples per block handed to the detector */
+#define HR_SAMPLER_BLOCK_SAMPLES  32
+
+/* Blocks buffered between producer and consumer (power of two) */
+#define HR_SAMPLER_RING_BLOCKS    8
+
+typedef struct {
+    uint32_t seq;           /* Block sequence number (gaps mean overruns) */
+    uint32_t first_index;   /* Sample index of samples[0] since init */
+    uint16_t samples[HR_SAMPLER_BLOCK_SAMPLES];  /* Decimated raw codes */
+} hr_block_t;
+
+typedef struct {
+    uint32_t raw_samples;   /* Raw conversions consumed */
+    uint32_t blocks;        /* Blocks completed */
+    uint32_t overruns;      /* Blocks dropped because the ring was full */
+} hr_sampler_stats_t;
+
+/* Reset the sampler. raw_rate_hz is rounded down to a whole multiple of
+ * out_rate_hz; returns the decimation factor actually used. */
+uint32_t hr_sampler_init(uint32_t raw_rate_hz, uint32_t out_rate_hz);
+
+/* Output (decimated) sample rate in Hz */
+uint32_t hr_sampler_rate_hz(void);
+
+/* Producer side: feed raw 12-bit conversions */
+void hr_sampler_push_raw(const uint16_t *raw, size_t count);
+
+/* Consumer side: pop the oldest complete block, false if none ready */
+bool hr_sampler_pop_block(hr_block_t *out);
+
+/* Convert an output sample index to milliseconds since init (no division) */
+uint32_t hr_sampler_index_to_ms(uint32_t index);
+
+void hr_sampler_get_stats(hr_sampler_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HR_SAMPLER_H */
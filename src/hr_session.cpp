@@ -2,34 +2,46 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <atomic>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/timers.h"
 #include "esp_log.h"
 
 #include "heart_rate.h"
 #include "ble_client.h"
+#include "app_mqtt.h"
+#include "workout_codec.h"
 
 static const char *TAG = "HR_SESSION";
 
-/* How long to collect HR before reporting back to MAX (ms) */
-#define HR_CAPTURE_WINDOW_MS 5000
+static_assert(HR_SESSION_MAX_PEERS >= BLE_MAX_PEERS, "Every tracker slot needs a timeline");
 
 /* Static resources sized for embedded target */
-#define HR_QUEUE_LENGTH         4
+#define HR_QUEUE_LENGTH         8
 #define HR_TASK_STACK_WORDS  2048
 
-//Command queue 
+/* Task notification bits: what woke the session task */
+#define HR_EVT_CMD    (1u << 0)
+#define HR_EVT_TIMER  (1u << 1)
+#define HR_EVT_BEAT   (1u << 2)
+
+//Command queue
 
 typedef enum {
     HR_CMD_START,
-    HR_CMD_CANCEL
+    HR_CMD_CANCEL,
+    HR_CMD_WORKOUT_BEGIN,
+    HR_CMD_WORKOUT_END
 } hr_cmd_type_t;
 
 typedef struct {
     hr_cmd_type_t type;
-    uint8_t lap;
+    uint8_t peer;
+    uint16_t lap;
+    uint32_t window_ms;
 } hr_cmd_t;
 
 static QueueHandle_t hr_cmd_queue = NULL;
@@ -39,73 +51,156 @@ static uint8_t hr_queue_storage[HR_QUEUE_LENGTH * sizeof(hr_cmd_t)];
 static StaticTask_t hr_task_tcb;
 static StackType_t hr_task_stack[HR_TASK_STACK_WORDS];
 
-// Internal helpers 
+// One-shot timer armed for the nearest capture deadline
+static TimerHandle_t hr_timer = NULL;
+static StaticTimer_t hr_timer_struct;
 
-static void hr_task(void *param)
+// Only the session task touches the state machine
+static hr_session_fsm_t fsm;
+
+// Beats only wake the task while a live capture wants them
+static std::atomic<bool> capturing(false);
+
+// Internal helpers
+
+static uint32_t now_ms(void)
 {
-    (void)param;
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+static void on_done(void *ctx, const hr_lap_timeline_t *lap)
+{
+    const hr_stats_summary_t *sum = &lap->summary;
+    const workout_hr_done_t hr = {
+        .lap = lap->lap,
+        .bpm = sum->last_bpm,
+        .min_bpm = sum->min_bpm,
+        .max_bpm = sum->max_bpm,
+        .mean_bpm = sum->mean_bpm,
+        .median_bpm = sum->median_bpm,
+        .beats = sum->beats,
+        .flagged = sum->flagged,
+        .quality = sum->quality,
+        .window_ms = lap->window_ms,
+        .live = lap->live
+    };
+    bool sent;
+
+    if (ble_client_peer_binary(lap->peer)) {
+        uint8_t frame[WORKOUT_CODEC_MAX_FRAME];
+        size_t len = workout_codec_encode_hr_done(&hr, frame, sizeof(frame));
+        sent = len > 0 && ble_client_send_acked(lap->peer, frame, len);
+    } else {
+        char msg[200];
+        int len = workout_codec_hr_done_json(&hr, msg, sizeof(msg));
+        // Without bin1 or fragments the full summary may not fit one write
+        if (len > 0 && (size_t)len > ble_client_peer_max_message(lap->peer)) {
+            len = workout_codec_hr_done_compact_json(&hr, msg, sizeof(msg));
+        }
+        sent = len > 0 && len < (int)sizeof(msg) &&
+               ble_client_send_acked(lap->peer, (const uint8_t *)msg, (size_t)len);
+    }
 
-    hr_cmd_t cmd;
+    // The TX worker logs it if the MAX never confirms
+    if (sent) {
+        ESP_LOGI(TAG, "Queued hr_done for %s lap %u (%s: bpm=%u mean=%u median=%u %u-%u, "
+                      "%u beats, q=%u)",
+                 ble_client_peer_name(lap->peer), lap->lap, lap->live ? "live" : "history", sum->last_bpm, sum->mean_bpm,
+                 sum->median_bpm, sum->min_bpm, sum->max_bpm, sum->beats, sum->quality);
+    } else {
+        ESP_LOGW(TAG, "Failed to queue hr_done for %s lap %u",
+                 ble_client_peer_name(lap->peer), lap->lap);
+    }
+}
 
-    while (1) {
-        if (xQueueReceive(hr_cmd_queue, &cmd, portMAX_DELAY) != pdTRUE) {
-            continue;
+static void on_timeline(void *ctx, const hr_lap_timeline_t *lap, uint32_t index, uint32_t count)
+{
+    const char *name = ble_client_peer_name(lap->peer);
+    if (!mqtt_publish_hr_timeline(name, lap, index, count)) {
+        ESP_LOGW(TAG, "HR timeline %s lap %u not queued", name, lap->lap);
+    }
+    if (index + 1 == count) {
+        ESP_LOGI(TAG, "HR timeline for %s published (%lu laps)", name, (unsigned long)count);
+    }
+}
+
+static void on_timer(TimerHandle_t timer)
+{
+    xTaskNotify(hr_task_handle, HR_EVT_TIMER, eSetBits);
+}
+
+// Beat channel hook: runs in the heart-rate sampling task
+static void on_beat(void *ctx)
+{
+    if (capturing.load(std::memory_order_relaxed)) {
+        xTaskNotify(hr_task_handle, HR_EVT_BEAT, eSetBits);
+    }
+}
+
+static void handle_cmd(const hr_cmd_t *cmd)
+{
+    switch (cmd->type) {
+    case HR_CMD_START: {
+        uint32_t duplicates = fsm.duplicates;
+        uint32_t evicted = fsm.evicted;
+
+        hr_session_fsm_start(&fsm, now_ms(), heart_rate_now_us(), cmd->peer, cmd->lap,
+                             cmd->window_ms);
+
+        if (fsm.duplicates != duplicates) {
+            ESP_LOGW(TAG, "%s lap %u already being captured",
+                     ble_client_peer_name(cmd->peer), cmd->lap);
+        } else if (fsm.evicted != evicted) {
+            ESP_LOGW(TAG, "HR sessions full, oldest lap finished early");
         }
+        break;
+    }
 
-        if (cmd.type == HR_CMD_CANCEL) {
-            ESP_LOGI(TAG, "HR session cancelled");
-            continue;
+    case HR_CMD_CANCEL:
+        if (hr_session_fsm_cancel_peer(&fsm, cmd->peer) > 0) {
+            ESP_LOGI(TAG, "HR sessions for %s cancelled", ble_client_peer_name(cmd->peer));
         }
+        break;
 
-        /* HR_CMD_START */
-        ESP_LOGI(TAG, "HR session started for lap %u", cmd.lap);
-
-        uint32_t start_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
-        uint32_t last_ms = start_ms;
-        int last_bpm = -1;
-
-        while (1) {
-            /* Poll sensor; keep latest valid BPM */
-            float bpm_f = 0.0f;
-            if (heart_rate_update(&bpm_f) && heart_rate_is_valid()) {
-                last_bpm = (int)bpm_f;
-            }
-
-            /* Exit after capture window or if cancelled */
-            uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
-            if (now_ms - start_ms >= HR_CAPTURE_WINDOW_MS) {
-                break;
-            }
-
-            /* Non-blocking check for cancel while waiting */
-            if (xQueueReceive(hr_cmd_queue, &cmd, pdMS_TO_TICKS(10)) == pdTRUE) {
-                if (cmd.type == HR_CMD_CANCEL) {
-                    ESP_LOGI(TAG, "HR session cancelled mid-flight");
-                    last_bpm = -1;
-                    break;
-                } else {
-                    /* Ignore nested start until current completes */
-                    ESP_LOGW(TAG, "Nested HR start ignored");
-                }
-            }
-
-            vTaskDelay(pdMS_TO_TICKS(50));
-            last_ms = now_ms;
+    case HR_CMD_WORKOUT_BEGIN:
+        hr_session_fsm_workout_begin(&fsm, cmd->peer);
+        break;
+
+    case HR_CMD_WORKOUT_END:
+        hr_session_fsm_workout_end(&fsm, cmd->peer);
+        break;
+    }
+}
+
+// Idle until a command, the capture timer or (while capturing) a beat
+static void hr_task(void *param)
+{
+    (void)param;
+
+    while (1) {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+
+        /* Bring every capture up to date before acting on anything */
+        hr_session_fsm_beats(&fsm);
+
+        hr_cmd_t cmd;
+        while (xQueueReceive(hr_cmd_queue, &cmd, 0) == pdTRUE) {
+            handle_cmd(&cmd);
         }
 
-        char msg[64];
-        int bpm_to_send = (last_bpm > 0) ? last_bpm : 0;
-        int len = snprintf(msg, sizeof(msg),
-                           "{\"cmd\":\"hr_done\",\"bpm\":%d}", bpm_to_send);
-        if (len > 0 && ble_client_send_message(msg)) {
-            ESP_LOGI(TAG, "Sent hr_done (bpm=%d)", bpm_to_send);
+        uint32_t next = hr_session_fsm_tick(&fsm, now_ms());
+        if (next == HR_SESSION_IDLE) {
+            xTimerStop(hr_timer, 0);
         } else {
-            ESP_LOGW(TAG, "Failed to send hr_done");
+            TickType_t ticks = pdMS_TO_TICKS(next);
+            xTimerChangePeriod(hr_timer, ticks ? ticks : 1, 0);
         }
+        capturing.store(next != HR_SESSION_IDLE, std::memory_order_relaxed);
     }
 }
 
-// Public API 
+// Public API
 
 void hr_session_init(void)
 {
@@ -113,6 +208,13 @@ void hr_session_init(void)
         return;
     }
 
+    static const hr_session_ops_t ops = {
+        .done = on_done,
+        .timeline = on_timeline,
+        .ctx = NULL
+    };
+    hr_session_fsm_init(&fsm, &ops);
+
     hr_cmd_queue = xQueueCreateStatic(
         HR_QUEUE_LENGTH,
         sizeof(hr_cmd_t),
@@ -124,6 +226,14 @@ void hr_session_init(void)
         return;
     }
 
+    hr_timer = xTimerCreateStatic(
+        "hr_session",
+        1,
+        pdFALSE,
+        NULL,
+        on_timer,
+        &hr_timer_struct);
+
     hr_task_handle = xTaskCreateStatic(
         hr_task,
         "hr_session",
@@ -136,10 +246,13 @@ void hr_session_init(void)
     if (hr_task_handle == NULL) {
         ESP_LOGE(TAG, "Failed to start HR task");
         hr_cmd_queue = NULL;
+        return;
     }
+
+    heart_rate_notify_on_beat(on_beat, NULL);
 }
 
-void hr_session_start(uint8_t lap_number)
+static void send_cmd(hr_cmd_type_t type, uint8_t peer, uint16_t lap, uint32_t window_ms)
 {
     if (hr_cmd_queue == NULL) {
         ESP_LOGW(TAG, "HR session not initialised");
@@ -147,17 +260,42 @@ void hr_session_start(uint8_t lap_number)
     }
 
     hr_cmd_t cmd = {
-        .type = HR_CMD_START,
-        .lap = lap_number
+        .type = type,
+        .peer = peer,
+        .lap = lap,
+        .window_ms = window_ms
     };
-    xQueueSend(hr_cmd_queue, &cmd, 0);
+    if (xQueueSend(hr_cmd_queue, &cmd, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "HR command queue full, command %d dropped", (int)type);
+        return;
+    }
+    xTaskNotify(hr_task_handle, HR_EVT_CMD, eSetBits);
 }
 
-void hr_session_cancel(void)
+void hr_session_start(uint8_t peer, uint16_t lap_number, uint32_t window_ms)
 {
-    if (hr_cmd_queue == NULL) {
-        return;
+    if (window_ms == 0) {
+        window_ms = HR_SESSION_WINDOW_MS;
+    } else if (window_ms < HR_SESSION_WINDOW_MIN_MS) {
+        window_ms = HR_SESSION_WINDOW_MIN_MS;
+    } else if (window_ms > HR_SESSION_WINDOW_MAX_MS) {
+        window_ms = HR_SESSION_WINDOW_MAX_MS;
     }
-    hr_cmd_t cmd = { .type = HR_CMD_CANCEL, .lap = 0 };
-    xQueueSend(hr_cmd_queue, &cmd, 0);
+
+    send_cmd(HR_CMD_START, peer, lap_number, window_ms);
+}
+
+void hr_session_cancel(uint8_t peer)
+{
+    send_cmd(HR_CMD_CANCEL, peer, 0, 0);
+}
+
+void hr_session_workout_begin(uint8_t peer)
+{
+    send_cmd(HR_CMD_WORKOUT_BEGIN, peer, 0, 0);
+}
+
+void hr_session_workout_end(uint8_t peer)
+{
+    send_cmd(HR_CMD_WORKOUT_END, peer, 0, 0);
 }
@@ -4,6 +4,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "hr_session_fsm.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -11,11 +13,21 @@ extern "C" {
 /* Initialise HR session handler (creates background task) */
 void hr_session_init(void);
 
-/* Start a heart-rate capture session for a lap (runs ~5s then notifies MAX) */
-void hr_session_start(uint8_t lap_number);
+/* Start a heart-rate capture session for a lap and send the summary of
+ * the last window_ms (0 = default, clamped to HR_SESSION_WINDOW_MIN_MS..
+ * HR_SESSION_WINDOW_MAX_MS, see hr_session_fsm.h) as hr_done to the
+ * tracker (ble_client peer) that asked. Answered at once from the beat
+ * history when it covers the window with a live signal, otherwise
+ * captured for window_ms. Sessions for different laps run side by side. */
+void hr_session_start(uint8_t peer, uint16_t lap_number, uint32_t window_ms);
+
+/* Cancel a tracker's in-progress HR sessions (used on disconnect) */
+void hr_session_cancel(uint8_t peer);
 
-/* Cancel any in-progress HR session (used on disconnect/stop) */
-void hr_session_cancel(void);
+/* A tracker's workout boundaries: begin clears its lap timeline, end
+ * publishes it */
+void hr_session_workout_begin(uint8_t peer);
+void hr_session_workout_end(uint8_t peer);
 
 #ifdef __cplusplus
 }
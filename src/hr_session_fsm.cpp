@@ -0,0 +1,242 @@
+#include "hr_session_fsm.h"
+
+#include <string.h>
+
+/* History must hold a full max-length window at the highest tracked rate */
+static_assert(HR_BEAT_CHANNEL_LEN >= (HR_SESSION_WINDOW_MAX_MS / 1000) * HR_STATS_MAX_BPM / 60,
+              "Beat channel too short for HR_SESSION_WINDOW_MAX_MS");
+
+static bool good_beat(const hr_beat_event_t *beat)
+{
+    return beat->bpm > 0 && beat->quality >= HR_QUALITY_MIN;
+}
+
+static void capture_begin(hr_session_capture_t *cap, uint8_t peer, uint16_t lap,
+                          uint32_t window_ms, uint64_t from_us)
+{
+    cap->active = true;
+    cap->peer = peer;
+    cap->lap = lap;
+    cap->window_ms = window_ms;
+    cap->from_us = from_us;
+    hr_stats_reset(&cap->stats);
+    memset(cap->bpm, 0, sizeof(cap->bpm));
+}
+
+static void capture_beat(hr_session_capture_t *cap, const hr_beat_event_t *beat)
+{
+    if (beat->timestamp_us < cap->from_us) {
+        return;
+    }
+
+    hr_stats_add(&cap->stats, beat->bpm, beat->quality, HR_QUALITY_MIN);
+
+    if (good_beat(beat)) {
+        uint64_t second = (beat->timestamp_us - cap->from_us) / 1000000;
+        if (second < HR_TIMELINE_POINTS) {
+            cap->bpm[second] = beat->bpm > UINT8_MAX ? UINT8_MAX : (uint8_t)beat->bpm;
+        }
+    }
+}
+
+// Fill cap from beats already held in the channel. False if the history
+// does not reach back a whole window or the signal is not live right now.
+static bool capture_from_history(hr_session_capture_t *cap, uint64_t now_us,
+                                 uint8_t peer, uint16_t lap, uint32_t window_ms)
+{
+    uint64_t window_us = (uint64_t)window_ms * 1000;
+
+    if (now_us < window_us) {
+        return false;  // Sampling has not been running that long
+    }
+    capture_begin(cap, peer, lap, window_ms, now_us - window_us);
+
+    hr_beat_sub_t sub;
+    hr_beat_channel_subscribe_history(&sub);
+
+    // A cursor of 0 means every beat since boot is still held; otherwise
+    // the oldest held beat must predate the window
+    bool complete = sub.cursor == 0;
+    uint64_t last_good_us = 0;
+
+    hr_beat_event_t beat;
+    while (hr_beat_channel_read(&sub, &beat)) {
+        if (beat.timestamp_us < cap->from_us) {
+            complete = true;
+            continue;
+        }
+        capture_beat(cap, &beat);
+        if (good_beat(&beat)) {
+            last_good_us = beat.timestamp_us;
+        }
+    }
+
+    cap->active = false;
+    return complete && sub.dropped == 0 && cap->stats.count >= 2 &&
+           last_good_us + HR_SESSION_FRESH_US >= now_us;
+}
+
+static void finish_capture(hr_session_fsm_t *fsm, hr_session_capture_t *cap, bool live)
+{
+    // Ring: a long workout keeps its most recent laps. A peer without a
+    // timeline reports from the spare entry.
+    hr_lap_timeline_t spare;
+    hr_lap_timeline_t *t = &spare;
+    if (cap->peer < HR_SESSION_MAX_PEERS) {
+        hr_session_timeline_t *tl = &fsm->timelines[cap->peer];
+        t = &tl->laps[tl->count % HR_TIMELINE_LAPS];
+        tl->count++;
+    }
+
+    t->peer = cap->peer;
+    t->lap = cap->lap;
+    t->live = live;
+    t->window_ms = cap->window_ms;
+    t->points = (uint8_t)((cap->window_ms + 999) / 1000);
+    hr_stats_get(&cap->stats, &t->summary);
+    memcpy(t->bpm, cap->bpm, sizeof(t->bpm));
+
+    cap->active = false;
+
+    if (fsm->ops.done) {
+        fsm->ops.done(fsm->ops.ctx, t);
+    }
+}
+
+void hr_session_fsm_init(hr_session_fsm_t *fsm, const hr_session_ops_t *ops)
+{
+    memset(fsm, 0, sizeof(*fsm));
+    fsm->ops = *ops;
+    hr_beat_channel_subscribe(&fsm->beats);
+}
+
+void hr_session_fsm_start(hr_session_fsm_t *fsm, uint32_t now_ms, uint64_t now_us,
+                          uint8_t peer, uint16_t lap, uint32_t window_ms)
+{
+    if (capture_from_history(&fsm->history, now_us, peer, lap, window_ms)) {
+        finish_capture(fsm, &fsm->history, false);
+        return;
+    }
+
+    hr_session_capture_t *slot = NULL;
+    hr_session_capture_t *oldest = NULL;
+
+    for (int i = 0; i < HR_SESSION_MAX_ACTIVE; i++) {
+        hr_session_capture_t *cap = &fsm->captures[i];
+        if (cap->active && cap->peer == peer && cap->lap == lap) {
+            fsm->duplicates++;
+            return;
+        }
+        if (!cap->active) {
+            if (slot == NULL) slot = cap;
+        } else if (oldest == NULL || cap->from_us < oldest->from_us) {
+            oldest = cap;
+        }
+    }
+
+    // All slots busy: the oldest lap reports what it has so far
+    if (slot == NULL) {
+        fsm->evicted++;
+        finish_capture(fsm, oldest, true);
+        slot = oldest;
+    }
+
+    capture_begin(slot, peer, lap, window_ms, now_us);
+    slot->deadline_ms = now_ms + window_ms;
+}
+
+void hr_session_fsm_cancel(hr_session_fsm_t *fsm)
+{
+    for (int i = 0; i < HR_SESSION_MAX_ACTIVE; i++) {
+        fsm->captures[i].active = false;
+    }
+}
+
+uint32_t hr_session_fsm_cancel_peer(hr_session_fsm_t *fsm, uint8_t peer)
+{
+    uint32_t cancelled = 0;
+    for (int i = 0; i < HR_SESSION_MAX_ACTIVE; i++) {
+        if (fsm->captures[i].active && fsm->captures[i].peer == peer) {
+            fsm->captures[i].active = false;
+            cancelled++;
+        }
+    }
+    return cancelled;
+}
+
+void hr_session_fsm_workout_begin(hr_session_fsm_t *fsm, uint8_t peer)
+{
+    if (peer < HR_SESSION_MAX_PEERS) {
+        fsm->timelines[peer].count = 0;
+    }
+}
+
+void hr_session_fsm_workout_end(hr_session_fsm_t *fsm, uint8_t peer)
+{
+    // The peer's laps still capturing report what they have so they make
+    // its timeline
+    hr_session_fsm_beats(fsm);
+    for (int i = 0; i < HR_SESSION_MAX_ACTIVE; i++) {
+        if (fsm->captures[i].active && fsm->captures[i].peer == peer) {
+            finish_capture(fsm, &fsm->captures[i], true);
+        }
+    }
+
+    if (peer >= HR_SESSION_MAX_PEERS) {
+        return;
+    }
+
+    hr_session_timeline_t *tl = &fsm->timelines[peer];
+    uint32_t n = tl->count < HR_TIMELINE_LAPS ? tl->count : HR_TIMELINE_LAPS;
+    uint32_t first = tl->count - n;
+
+    if (fsm->ops.timeline) {
+        for (uint32_t i = 0; i < n; i++) {
+            fsm->ops.timeline(fsm->ops.ctx, &tl->laps[(first + i) % HR_TIMELINE_LAPS], i, n);
+        }
+    }
+    tl->count = 0;
+}
+
+void hr_session_fsm_beats(hr_session_fsm_t *fsm)
+{
+    hr_beat_event_t beat;
+    while (hr_beat_channel_read(&fsm->beats, &beat)) {
+        for (int i = 0; i < HR_SESSION_MAX_ACTIVE; i++) {
+            if (fsm->captures[i].active) {
+                capture_beat(&fsm->captures[i], &beat);
+            }
+        }
+    }
+}
+
+uint32_t hr_session_fsm_tick(hr_session_fsm_t *fsm, uint32_t now_ms)
+{
+    uint32_t next = HR_SESSION_IDLE;
+
+    for (int i = 0; i < HR_SESSION_MAX_ACTIVE; i++) {
+        hr_session_capture_t *cap = &fsm->captures[i];
+        if (!cap->active) {
+            continue;
+        }
+
+        int32_t left = (int32_t)(cap->deadline_ms - now_ms);
+        if (left <= 0) {
+            hr_session_fsm_beats(fsm);
+            finish_capture(fsm, cap, true);
+        } else if ((uint32_t)left < next) {
+            next = (uint32_t)left;
+        }
+    }
+    return next;
+}
+
+bool hr_session_fsm_active(const hr_session_fsm_t *fsm)
+{
+    for (int i = 0; i < HR_SESSION_MAX_ACTIVE; i++) {
+        if (fsm->captures[i].active) {
+            return true;
+        }
+    }
+    return false;
+}
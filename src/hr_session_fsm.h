@@ -0,0 +1,128 @@
+#ifndef HR_SESSION_FSM_H
+#define HR_SESSION_FSM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "hr_beat_channel.h"
+#include "hr_quality.h"
+#include "hr_stats.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * HR session state machine, free of RTOS calls so it runs on the host.
+ *
+ * Each capture slot is idle or capturing a lap's window. Time only moves
+ * when the caller says so: commands and ticks carry the current time of a
+ * millisecond clock (wraps, compared by difference) and tick returns how
+ * long until the next deadline, which the caller arms a timer for. Beats
+ * are pulled from the beat channel when the caller is told new ones are
+ * there. Results leave through the ops callbacks, from inside these calls.
+ */
+
+/* Capture window: default, and the range accepted from hr_req (ms) */
+#define HR_SESSION_WINDOW_MS      5000
+#define HR_SESSION_WINDOW_MIN_MS  1000
+#define HR_SESSION_WINDOW_MAX_MS  60000
+
+/* Live captures that can overlap (one per lap) */
+#define HR_SESSION_MAX_ACTIVE     4
+
+/* Laps kept per tracker for the end-of-workout timeline (oldest dropped first) */
+#define HR_TIMELINE_LAPS          32
+
+/* Trackers with a timeline of their own; peer numbers at or above this
+ * still get their hr_done but no timeline */
+#define HR_SESSION_MAX_PEERS      4
+
+/* One BPM point per second over the longest window */
+#define HR_TIMELINE_POINTS        (HR_SESSION_WINDOW_MAX_MS / 1000)
+
+/* An answer from history needs a good beat this recent (signal still live) */
+#define HR_SESSION_FRESH_US       2000000
+
+/* hr_session_fsm_tick() result when nothing is capturing */
+#define HR_SESSION_IDLE           UINT32_MAX
+
+/* HR for one lap: the hr_done summary plus the BPM of the last good beat
+ * in each second of the window (0 = no beat that second) */
+typedef struct {
+    uint8_t peer;           /* Tracker that asked, see ble_client.h */
+    uint16_t lap;
+    bool live;              /* Captured after the request, not from history */
+    uint8_t points;         /* Seconds in the window */
+    uint32_t window_ms;
+    hr_stats_summary_t summary;
+    uint8_t bpm[HR_TIMELINE_POINTS];
+} hr_lap_timeline_t;
+
+typedef struct {
+    void (*done)(void *ctx, const hr_lap_timeline_t *lap);
+    void (*timeline)(void *ctx, const hr_lap_timeline_t *lap, uint32_t index, uint32_t count);
+    void *ctx;
+} hr_session_ops_t;
+
+typedef struct {
+    bool active;
+    uint8_t peer;
+    uint16_t lap;
+    uint32_t window_ms;
+    uint32_t deadline_ms;   /* Live captures end here */
+    uint64_t from_us;       /* Window start on the beat clock */
+    hr_stats_t stats;
+    uint8_t bpm[HR_TIMELINE_POINTS];
+} hr_session_capture_t;
+
+/* One tracker's laps this workout, a ring of the most recent */
+typedef struct {
+    hr_lap_timeline_t laps[HR_TIMELINE_LAPS];
+    uint32_t count;             /* Laps recorded this workout */
+} hr_session_timeline_t;
+
+typedef struct {
+    hr_session_ops_t ops;
+    hr_beat_sub_t beats;
+    hr_session_capture_t captures[HR_SESSION_MAX_ACTIVE];
+    hr_session_capture_t history;
+    hr_session_timeline_t timelines[HR_SESSION_MAX_PEERS];
+    uint32_t duplicates;        /* Starts ignored: peer's lap already capturing */
+    uint32_t evicted;           /* Captures finished early to free a slot */
+} hr_session_fsm_t;
+
+void hr_session_fsm_init(hr_session_fsm_t *fsm, const hr_session_ops_t *ops);
+
+/* Request a lap's HR over the last window_ms for a peer. now_us is the
+ * beat clock (heart_rate_now_us); answers at once from the channel
+ * history when it covers the window, otherwise starts a live capture.
+ * Laps are told apart per peer, so trackers may reuse lap numbers. */
+void hr_session_fsm_start(hr_session_fsm_t *fsm, uint32_t now_ms, uint64_t now_us,
+                          uint8_t peer, uint16_t lap, uint32_t window_ms);
+
+/* Drop every live capture without reporting */
+void hr_session_fsm_cancel(hr_session_fsm_t *fsm);
+
+/* Drop one peer's live captures without reporting; returns how many */
+uint32_t hr_session_fsm_cancel_peer(hr_session_fsm_t *fsm, uint8_t peer);
+
+/* A peer's workout: begin clears its timeline; end finishes its live
+ * captures early and publishes its timeline. Other peers' workouts run on. */
+void hr_session_fsm_workout_begin(hr_session_fsm_t *fsm, uint8_t peer);
+void hr_session_fsm_workout_end(hr_session_fsm_t *fsm, uint8_t peer);
+
+/* Feed beats published since the last call to the live captures */
+void hr_session_fsm_beats(hr_session_fsm_t *fsm);
+
+/* Finish captures that are due; ms until the next deadline or HR_SESSION_IDLE */
+uint32_t hr_session_fsm_tick(hr_session_fsm_t *fsm, uint32_t now_ms);
+
+/* True while any live capture is running */
+bool hr_session_fsm_active(const hr_session_fsm_t *fsm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HR_SESSION_FSM_H */
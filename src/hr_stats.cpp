@@ -0,0 +1,67 @@
+#include "hr_stats.h"
+
+#include <string.h>
+
+void hr_stats_reset(hr_stats_t *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+void hr_stats_add(hr_stats_t *s, uint16_t bpm, uint8_t quality, uint8_t min_quality)
+{
+    if (bpm == 0) {
+        return;
+    }
+    if (quality < min_quality) {
+        s->flagged++;
+        return;
+    }
+
+    uint16_t bin = bpm;
+    if (bin < HR_STATS_MIN_BPM) bin = HR_STATS_MIN_BPM;
+    if (bin > HR_STATS_MAX_BPM) bin = HR_STATS_MAX_BPM;
+    bin -= HR_STATS_MIN_BPM;
+
+    // Saturate rather than wrap; the count alone is enough for the median
+    if (s->hist[bin] < UINT16_MAX) {
+        s->hist[bin]++;
+    } else {
+        return;
+    }
+
+    if (s->count == 0 || bpm < s->min_bpm) s->min_bpm = bpm;
+    if (s->count == 0 || bpm > s->max_bpm) s->max_bpm = bpm;
+    s->count++;
+    s->bpm_sum += bpm;
+    s->quality_sum += quality;
+    s->last_bpm = bpm;
+}
+
+bool hr_stats_get(const hr_stats_t *s, hr_stats_summary_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->flagged = (uint16_t)(s->flagged > UINT16_MAX ? UINT16_MAX : s->flagged);
+
+    if (s->count == 0) {
+        return false;
+    }
+
+    out->beats = (uint16_t)(s->count > UINT16_MAX ? UINT16_MAX : s->count);
+    out->min_bpm = s->min_bpm;
+    out->max_bpm = s->max_bpm;
+    out->mean_bpm = (uint16_t)((s->bpm_sum + s->count / 2) / s->count);
+    out->last_bpm = s->last_bpm;
+    out->quality = (uint8_t)((s->quality_sum + s->count / 2) / s->count);
+
+    // Lower median: the bin holding beat number (count + 1) / 2
+    uint32_t target = (s->count + 1) / 2;
+    uint32_t seen = 0;
+    for (uint16_t i = 0; i < HR_STATS_BINS; i++) {
+        seen += s->hist[i];
+        if (seen >= target) {
+            out->median_bpm = (uint16_t)(i + HR_STATS_MIN_BPM);
+            break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef HR_STATS_H
+#define HR_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Summary statistics of the BPM values seen over a capture window.
+ *
+ * Beats are counted into a 1 BPM histogram alongside a running min, max,
+ * sum and quality sum, so adding a beat is O(1) and the memory is fixed
+ * however long the window is. The median is read off the histogram when
+ * the summary is taken. Values outside the histogram range are clamped
+ * into its edge bins for the median only; min, max and mean stay exact.
+ */
+
+#define HR_STATS_MIN_BPM 30
+#define HR_STATS_MAX_BPM 240
+#define HR_STATS_BINS    (HR_STATS_MAX_BPM - HR_STATS_MIN_BPM + 1)
+
+typedef struct {
+    uint16_t hist[HR_STATS_BINS];
+    uint32_t count;         /* Beats counted */
+    uint32_t flagged;       /* Beats seen but below the quality gate */
+    uint32_t bpm_sum;
+    uint32_t quality_sum;
+    uint16_t min_bpm;
+    uint16_t max_bpm;
+    uint16_t last_bpm;
+} hr_stats_t;
+
+typedef struct {
+    uint16_t beats;
+    uint16_t flagged;
+    uint16_t min_bpm;
+    uint16_t max_bpm;
+    uint16_t mean_bpm;      /* Rounded */
+    uint16_t median_bpm;
+    uint16_t last_bpm;
+    uint8_t quality;        /* Mean quality of the counted beats */
+} hr_stats_summary_t;
+
+void hr_stats_reset(hr_stats_t *s);
+
+/* Count one beat, or only note it as flagged if quality < min_quality */
+void hr_stats_add(hr_stats_t *s, uint16_t bpm, uint8_t quality, uint8_t min_quality);
+
+/* Fill out; false (all zeros) if no beat was counted */
+bool hr_stats_get(const hr_stats_t *s, hr_stats_summary_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HR_STATS_H */
@@ -0,0 +1,133 @@
+#include "hr_wave_codec.h"
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+// Small deltas of either sign map to small unsigned codes
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+void hr_wave_begin(hr_wave_encoder_t *enc, uint8_t *buf, size_t cap,
+                   uint32_t seq, uint64_t start_us, uint16_t rate_hz)
+{
+    enc->buf = buf;
+    enc->cap = cap;
+    enc->len = HR_WAVE_HEADER_BYTES;
+    enc->count = 0;
+    enc->prev = 0;
+
+    buf[0] = HR_WAVE_MAGIC;
+    buf[1] = HR_WAVE_VERSION;
+    put_u16(buf + 2, rate_hz);
+    put_u32(buf + 4, seq);
+    put_u32(buf + 8, (uint32_t)start_us);
+    put_u32(buf + 12, (uint32_t)(start_us >> 32));
+    put_u16(buf + 16, 0);
+    put_u16(buf + 18, 0);
+}
+
+bool hr_wave_add(hr_wave_encoder_t *enc, int16_t sample)
+{
+    if (enc->count == UINT16_MAX) {
+        return false;
+    }
+
+    if (enc->count == 0) {
+        put_u16(enc->buf + 18, (uint16_t)sample);
+    } else {
+        uint32_t code = zigzag((int32_t)sample - enc->prev);
+        uint8_t tmp[3];
+        size_t n = 0;
+
+        do {
+            uint8_t byte = code & 0x7F;
+            code >>= 7;
+            tmp[n++] = code ? (byte | 0x80) : byte;
+        } while (code);
+
+        if (enc->len + n > enc->cap) {
+            return false;
+        }
+        for (size_t i = 0; i < n; i++) {
+            enc->buf[enc->len++] = tmp[i];
+        }
+    }
+
+    enc->prev = sample;
+    enc->count++;
+    return true;
+}
+
+size_t hr_wave_finish(hr_wave_encoder_t *enc)
+{
+    put_u16(enc->buf + 16, enc->count);
+    return enc->len;
+}
+
+size_t hr_wave_decode(const uint8_t *frame, size_t len, hr_wave_header_t *hdr,
+                      int16_t *out, size_t max)
+{
+    if (len < HR_WAVE_HEADER_BYTES || frame[0] != HR_WAVE_MAGIC ||
+        frame[1] != HR_WAVE_VERSION) {
+        return 0;
+    }
+
+    hdr->rate_hz = get_u16(frame + 2);
+    hdr->seq = get_u32(frame + 4);
+    hdr->start_us = (uint64_t)get_u32(frame + 8) | ((uint64_t)get_u32(frame + 12) << 32);
+    hdr->count = get_u16(frame + 16);
+
+    if (hdr->count == 0 || hdr->count > max) {
+        return 0;
+    }
+
+    int32_t prev = (int16_t)get_u16(frame + 18);
+    out[0] = (int16_t)prev;
+
+    size_t pos = HR_WAVE_HEADER_BYTES;
+    for (size_t i = 1; i < hdr->count; i++) {
+        uint32_t code = 0;
+        int shift = 0;
+        uint8_t byte;
+
+        do {
+            if (pos >= len || shift > 14) {
+                return 0;
+            }
+            byte = frame[pos++];
+            code |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        prev += unzigzag(code);
+        out[i] = (int16_t)prev;
+    }
+
+    return hdr->count;
+}
@@ -0,0 +1,79 @@
+#ifndef HR_WAVE_CODEC_H
+#define HR_WAVE_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Compact binary frames for streaming the raw pulse waveform.
+ *
+ * Samples (mV, int16) are delta encoded against the previous sample,
+ * zigzag mapped and written as LEB128 varints, so a PPG at a few hundred
+ * Hz costs about one byte per sample. Frames are self-contained (the
+ * first sample is stored verbatim) and carry a sequence number so gaps
+ * are visible to the receiver. The encoder writes into a caller-owned
+ * buffer and never allocates.
+ *
+ * Layout, little-endian:
+ *   0  u8  'W'
+ *   1  u8  version (1)
+ *   2  u16 sample rate (Hz)
+ *   4  u32 sequence number
+ *   8  u64 timestamp of the first sample (us since sampling started)
+ *  16  u16 sample count
+ *  18  i16 first sample
+ *  20  varint zigzag deltas for the remaining samples
+ */
+
+#define HR_WAVE_MAGIC        'W'
+#define HR_WAVE_VERSION      1
+#define HR_WAVE_HEADER_BYTES 20
+
+/* Samples per streamed frame (1 s at the default 500 Hz) */
+#ifndef HR_WAVE_FRAME_SAMPLES
+#define HR_WAVE_FRAME_SAMPLES 500
+#endif
+
+/* Worst case bytes for a frame of n samples (17-bit deltas, 3-byte varints) */
+#define HR_WAVE_FRAME_BYTES(n) (HR_WAVE_HEADER_BYTES + 3 * ((n) - 1))
+
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    uint16_t count;
+    int16_t prev;
+} hr_wave_encoder_t;
+
+typedef struct {
+    uint16_t rate_hz;
+    uint32_t seq;
+    uint64_t start_us;
+    uint16_t count;
+} hr_wave_header_t;
+
+/* Start a frame in buf (cap bytes, at least HR_WAVE_HEADER_BYTES) */
+void hr_wave_begin(hr_wave_encoder_t *enc, uint8_t *buf, size_t cap,
+                   uint32_t seq, uint64_t start_us, uint16_t rate_hz);
+
+/* Append one sample; false if it would not fit (frame is left intact) */
+bool hr_wave_add(hr_wave_encoder_t *enc, int16_t sample);
+
+/* Finalise the header and return the frame length in bytes */
+size_t hr_wave_finish(hr_wave_encoder_t *enc);
+
+/* Decode a frame into out (max samples). Returns the samples decoded,
+ * or 0 if the frame is malformed or does not fit. */
+size_t hr_wave_decode(const uint8_t *frame, size_t len, hr_wave_header_t *hdr,
+                      int16_t *out, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HR_WAVE_CODEC_H */
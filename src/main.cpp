@@ -2,6 +2,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "app_mqtt.h"
 #include "ble_client.h"
@@ -12,38 +13,151 @@
 
 static const char *TAG = "MAIN";
 
-// Heart rate publish rate limiting
+// Heart rate publish rate limiting (beats in between are coalesced)
 static const uint32_t PUBLISH_INTERVAL_MS = 1000;  // max 1/sec
 
+// HRV + RR batch publish period
+static const uint32_t HRV_PUBLISH_INTERVAL_MS = 5000;
 
+// Signal quality publish period (one quality window)
+static const uint32_t QUALITY_PUBLISH_INTERVAL_MS = HR_QUALITY_WINDOW_MS;
+
+// RR intervals published per HRV batch
+static const size_t RR_BATCH_MAX = 32;
+
+// Publisher wakeup/CPU accounting log period
+static const uint32_t STATS_INTERVAL_MS = 60000;
+
+// Beat channel hook: runs in the heart-rate sampling task
+static void wake_publisher(void *ctx)
+{
+    xTaskNotifyGive((TaskHandle_t)ctx);
+}
+
+static bool deadline_due(TickType_t now, TickType_t deadline)
+{
+    return (int32_t)(now - deadline) >= 0;
+}
+
+static TickType_t ticks_until(TickType_t now, TickType_t deadline)
+{
+    return deadline_due(now, deadline) ? 0 : deadline - now;
+}
+
+// Sleeps until a beat is published or a periodic deadline is due. Beats
+// that arrive inside the rate limit are coalesced into the next publish
+// (latest BPM wins) instead of being dropped.
 static void heart_rate_task(void *pvParameters)
 {
     ESP_LOGI(TAG, "Heart rate task started");
 
-    TickType_t last_publish = 0;
+    uint32_t rr_cursor = 0;
+    heart_rate_rr_t rr_batch[RR_BATCH_MAX];
+
+    TickType_t now = xTaskGetTickCount();
+    TickType_t next_publish = now;  // Earliest the next BPM may go out
+    TickType_t next_hrv = now + pdMS_TO_TICKS(HRV_PUBLISH_INTERVAL_MS);
+    TickType_t next_quality = now + pdMS_TO_TICKS(QUALITY_PUBLISH_INTERVAL_MS);
+    TickType_t next_stats = now + pdMS_TO_TICKS(STATS_INTERVAL_MS);
+
+    bool pending = false;
+    int pending_bpm = 0;
+
+    uint32_t wakeups = 0;
+    uint32_t beats_seen = 0;
+    uint32_t coalesced = 0;
+    uint32_t publishes = 0;
+    int64_t busy_us = 0;
+
+    heart_rate_sub_t beats;
+    heart_rate_subscribe(&beats);
+    heart_rate_notify_on_beat(wake_publisher, xTaskGetCurrentTaskHandle());
 
     while (1) {
-        float bpm;
-        bool new_beat = heart_rate_update(&bpm);
+        TickType_t wait = ticks_until(now, next_hrv);
+        TickType_t t = ticks_until(now, next_quality);
+        if (t < wait) wait = t;
+        t = ticks_until(now, next_stats);
+        if (t < wait) wait = t;
+        if (pending) {
+            t = ticks_until(now, next_publish);
+            if (t < wait) wait = t;
+        }
+
+        ulTaskNotifyTake(pdTRUE, wait);
+        int64_t t0 = esp_timer_get_time();
+        wakeups++;
+        now = xTaskGetTickCount();
+
+        // Drain our own view of the beat stream; keep the latest BPM from
+        // beats that are not artifacts
+        heart_rate_beat_t beat;
+        while (heart_rate_next_beat(&beats, &beat)) {
+            if (beat.bpm > 0 && beat.quality >= HEART_RATE_QUALITY_MIN) {
+                if (pending) {
+                    coalesced++;
+                }
+                pending = true;
+                pending_bpm = beat.bpm;
+                beats_seen++;
+            }
+        }
+
+        if (pending && deadline_due(now, next_publish)) {
+            pending = false;
+
+            // Nothing goes out while the signal window is poor
+            if (heart_rate_is_valid()) {
+                next_publish = now + pdMS_TO_TICKS(PUBLISH_INTERVAL_MS);
+                publishes++;
+
+                ESP_LOGI(TAG, "Mode=%s | BPM=%d | Q=%d | BLE=%s",
+                         mqtt_get_mode(),
+                         pending_bpm,
+                         heart_rate_get_quality(NULL),
+                         ble_client_is_connected() ? "connected" : "scanning");
 
-        TickType_t now = xTaskGetTickCount();
-        uint32_t elapsed = (now - last_publish) * portTICK_PERIOD_MS;
+                mqtt_publish_heart_rate(pending_bpm);
+            }
+        }
+
+        if (deadline_due(now, next_hrv)) {
+            next_hrv = now + pdMS_TO_TICKS(HRV_PUBLISH_INTERVAL_MS);
 
-        if (new_beat && elapsed >= PUBLISH_INTERVAL_MS) {
-            last_publish = now;
+            heart_rate_hrv_t hrv;
+            bool hrv_valid = heart_rate_get_hrv(&hrv);
+            size_t rr_count = heart_rate_read_rr(&rr_cursor, rr_batch, RR_BATCH_MAX);
 
-            int bpm_int = (int)(bpm + 0.5f);
+            if (hrv_valid || rr_count > 0) {
+                mqtt_publish_hrv(&hrv, rr_batch, rr_count);
+            }
+        }
 
-            ESP_LOGI(TAG, "Mode=%s | BPM=%d | BLE=%s",
-                     mqtt_get_mode(),
-                     bpm_int,
-                     ble_client_is_connected() ? "connected" : "scanning");
+        if (deadline_due(now, next_quality)) {
+            next_quality = now + pdMS_TO_TICKS(QUALITY_PUBLISH_INTERVAL_MS);
 
-            mqtt_publish_heart_rate(bpm_int);
+            heart_rate_quality_t quality;
+            heart_rate_get_quality(&quality);
+            mqtt_publish_quality(&quality, heart_rate_get_bpm());
         }
 
-        // Small delay to prevent task starvation
-        vTaskDelay(pdMS_TO_TICKS(5));
+        busy_us += esp_timer_get_time() - t0;
+
+        if (deadline_due(now, next_stats)) {
+            next_stats = now + pdMS_TO_TICKS(STATS_INTERVAL_MS);
+
+            ESP_LOGI(TAG, "Publisher: %lu wakeups, %lu beats (%lu coalesced), "
+                          "%lu publishes, %lld us busy in %lu s",
+                     (unsigned long)wakeups, (unsigned long)beats_seen,
+                     (unsigned long)coalesced, (unsigned long)publishes,
+                     (long long)busy_us, (unsigned long)(STATS_INTERVAL_MS / 1000));
+
+            wakeups = 0;
+            beats_seen = 0;
+            coalesced = 0;
+            publishes = 0;
+            busy_us = 0;
+        }
     }
 }
 
@@ -85,6 +199,7 @@ extern "C" void app_main(void)
     // Initialize WiFi and MQTT (blocks until WiFi connected)
     ESP_LOGI(TAG, "Initializing WiFi and MQTT...");
     mqtt_init();
+    heart_rate_stream_set_sink(mqtt_publish_waveform);
 
     // Initialize BLE client (starts scanning for MAX32655)
     ESP_LOGI(TAG, "Initializing BLE client...");
@@ -3,6 +3,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/message_buffer.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
@@ -16,6 +17,7 @@
 #include "app_mqtt.h"  // Our app header
 #include "config.h"    // Configuration definitions
 #include "buzzer.h"    // Buzzer control
+#include "hr_wave_codec.h"
 
 static const char *TAG = "MQTT_CLIENT";
 
@@ -23,8 +25,14 @@ static const char *TAG = "MQTT_CLIENT";
 #define MQTT_BROKER    "mqtt://200.69.13.70:1883"
 #define TOPIC_MODE     "pulsetracker/mode"
 #define TOPIC_HEART    "pulsetracker/heartRate"
+#define TOPIC_HRV      "pulsetracker/hrv"
+#define TOPIC_QUALITY  "pulsetracker/quality"
+#define TOPIC_WAVE     "pulsetracker/waveform"
+#define TOPIC_WAVE_CMD "pulsetracker/waveform/cmd"
 #define TOPIC_WORKOUT  "pulsetracker/workout"
+#define TOPIC_HR_TIMELINE "pulsetracker/hrTimeline"
 #define TOPIC_BUZZER   "pulsetracker/buzzer"
+#define TOPIC_DIAG     "pulsetracker/diag"
 
 // Connection Settings
 #define MAX_RETRY      10
@@ -39,6 +47,19 @@ static esp_mqtt_client_handle_t mqtt_client = NULL;
 static bool mqtt_connected = false;
 static char current_mode[32] = "unknown";
 
+// Waveform frames are handed over by the heart-rate task and published
+// from a task of their own, so enqueue's outbox lock (held while the
+// MQTT task does network I/O) is never taken on the sampling path
+#define WAVE_FRAME_MAX        HR_WAVE_FRAME_BYTES(HR_WAVE_FRAME_SAMPLES)
+#define WAVE_BUFFER_BYTES     (3 * (WAVE_FRAME_MAX + sizeof(size_t)))
+#define WAVE_TASK_STACK_WORDS 2048
+
+static MessageBufferHandle_t wave_buffer = NULL;
+static StaticMessageBuffer_t wave_buffer_struct;
+static uint8_t wave_buffer_storage[WAVE_BUFFER_BYTES + 1];
+static StaticTask_t wave_task_tcb;
+static StackType_t wave_task_stack[WAVE_TASK_STACK_WORDS];
+
 // WiFi event handler
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                int32_t event_id, void* event_data)
@@ -82,6 +103,9 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
             // Subscribe to buzzer topic
             esp_mqtt_client_subscribe(mqtt_client, TOPIC_BUZZER, 0);
             ESP_LOGI(TAG, "Subscribed to: %s", TOPIC_BUZZER);
+            // Subscribe to waveform streaming control
+            esp_mqtt_client_subscribe(mqtt_client, TOPIC_WAVE_CMD, 0);
+            ESP_LOGI(TAG, "Subscribed to: %s", TOPIC_WAVE_CMD);
             break;
 
         case MQTT_EVENT_DISCONNECTED:
@@ -108,6 +132,13 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
                 ESP_LOGI(TAG, "Buzzer command received");
                 buzzer_trigger_remote();
             }
+            // Check if it's the waveform command topic ("on"/"1" or "off"/"0")
+            else if (event->topic_len == strlen(TOPIC_WAVE_CMD) &&
+                     strncmp(event->topic, TOPIC_WAVE_CMD, event->topic_len) == 0) {
+                bool on = (event->data_len == 2 && strncmp(event->data, "on", 2) == 0) ||
+                          (event->data_len == 1 && event->data[0] == '1');
+                heart_rate_stream_enable(on);
+            }
             break;
 
         case MQTT_EVENT_ERROR:
@@ -167,6 +198,24 @@ static void wifi_init_sta(void)
     }
 }
 
+// Drains the waveform buffer; this task is the one that may wait on
+// the outbox
+static void wave_task(void *param)
+{
+    static uint8_t frame[WAVE_FRAME_MAX];
+
+    while (1) {
+        size_t len = xMessageBufferReceive(wave_buffer, frame, sizeof(frame), portMAX_DELAY);
+        if (len == 0 || !mqtt_connected) {
+            continue;
+        }
+        esp_mqtt_client_enqueue(mqtt_client, TOPIC_WAVE,
+                                (const char *)frame, (int)len,
+                                0 /* qos */, 0 /* retain */,
+                                true /* store */);
+    }
+}
+
 // Initialize MQTT client
 static void mqtt_app_start(void)
 {
@@ -177,6 +226,15 @@ static void mqtt_app_start(void)
     esp_mqtt_client_register_event(mqtt_client, (esp_mqtt_event_id_t)ESP_EVENT_ANY_ID,
                                    mqtt_event_handler, NULL);
     esp_mqtt_client_start(mqtt_client);
+
+    wave_buffer = xMessageBufferCreateStatic(sizeof(wave_buffer_storage) - 1,
+                                             wave_buffer_storage, &wave_buffer_struct);
+    if (wave_buffer == NULL ||
+        xTaskCreateStatic(wave_task, "mqtt_wave", WAVE_TASK_STACK_WORDS, NULL, 4,
+                          wave_task_stack, &wave_task_tcb) == NULL) {
+        ESP_LOGE(TAG, "Failed to start waveform publisher");
+        wave_buffer = NULL;
+    }
 }
 
 
@@ -205,13 +263,105 @@ bool mqtt_publish_heart_rate(int bpm)
     return msg_id >= 0;
 }
 
-bool mqtt_publish_workout_data(const char* json_data)
+bool mqtt_publish_hrv(const heart_rate_hrv_t *hrv, const heart_rate_rr_t *rr, size_t rr_count)
+{
+    if (!mqtt_connected || mqtt_client == NULL || hrv == NULL) return false;
+
+    // {"bpm":..,"rmssd":..,"sdnn":..,"pnn50":..,"n":..,"rr":[[t_ms,rr_ms],...]}
+    // RR keeps its microsecond resolution as three decimals
+    char payload[1024];
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"bpm\":%u,\"rmssd\":%u,\"sdnn\":%u,\"pnn50\":%u,\"n\":%u,\"rr\":[",
+                       hrv->mean_bpm, hrv->rmssd_ms, hrv->sdnn_ms, hrv->pnn50, hrv->beats);
+
+    for (size_t i = 0; i < rr_count && len > 0 && len < (int)sizeof(payload) - 32; i++) {
+        len += snprintf(payload + len, sizeof(payload) - len, "%s[%lu,%lu.%03lu]",
+                        i ? "," : "", (unsigned long)(rr[i].timestamp_us / 1000),
+                        (unsigned long)(rr[i].rr_us / 1000), (unsigned long)(rr[i].rr_us % 1000));
+    }
+    if (len <= 0 || len >= (int)sizeof(payload) - 2) return false;
+    len += snprintf(payload + len, sizeof(payload) - len, "]}");
+
+    int msg_id = esp_mqtt_client_publish(mqtt_client, TOPIC_HRV, payload, len, 0, 0);
+    return msg_id >= 0;
+}
+
+bool mqtt_publish_quality(const heart_rate_quality_t *quality, int bpm)
+{
+    if (!mqtt_connected || mqtt_client == NULL || quality == NULL) return false;
+
+    // heartRate stays a bare integer for existing consumers; quality rides
+    // on its own topic with the BPM it applies to
+    char payload[128];
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"bpm\":%d,\"q\":%u,\"valid\":%s,\"corr\":%u,\"clip\":%u,"
+                       "\"amp\":%u,\"flat\":%s}",
+                       bpm, quality->score,
+                       quality->score >= HEART_RATE_QUALITY_MIN ? "true" : "false",
+                       quality->correlation, quality->clipped_pct, quality->amp_dev_pct,
+                       quality->flatline ? "true" : "false");
+    if (len <= 0 || len >= (int)sizeof(payload)) return false;
+
+    int msg_id = esp_mqtt_client_publish(mqtt_client, TOPIC_QUALITY, payload, len, 0, 0);
+    return msg_id >= 0;
+}
+
+bool mqtt_publish_waveform(const uint8_t *frame, size_t len)
+{
+    if (!mqtt_connected || wave_buffer == NULL) return false;
+
+    // Copy into the buffer without waiting: when the publisher has fallen
+    // behind the frame is dropped (and counted by the heart-rate task)
+    return xMessageBufferSend(wave_buffer, frame, len, 0) == len;
+}
+
+bool mqtt_publish_hr_timeline(const char *peer, const hr_lap_timeline_t *lap, size_t index,
+                              size_t count)
+{
+    if (mqtt_client == NULL || lap == NULL) return false;
+
+    // {"lap":..,"i":..,"n":..,"src":..,"window_ms":..,<summary>,"t":[bpm per second]}
+    const hr_stats_summary_t *sum = &lap->summary;
+    char payload[512];
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"lap\":%u,\"i\":%u,\"n\":%u,\"src\":\"%s\",\"window_ms\":%lu,"
+                       "\"bpm\":%u,\"min\":%u,\"max\":%u,\"mean\":%u,\"median\":%u,"
+                       "\"beats\":%u,\"flagged\":%u,\"q\":%u,\"t\":[",
+                       lap->lap, (unsigned)index, (unsigned)count, lap->live ? "live" : "hist",
+                       (unsigned long)lap->window_ms, sum->last_bpm, sum->min_bpm,
+                       sum->max_bpm, sum->mean_bpm, sum->median_bpm, sum->beats,
+                       sum->flagged, sum->quality);
+
+    for (uint8_t i = 0; i < lap->points && i < HR_TIMELINE_POINTS && len > 0 &&
+                        len < (int)sizeof(payload) - 8; i++) {
+        len += snprintf(payload + len, sizeof(payload) - len, "%s%u", i ? "," : "", lap->bpm[i]);
+    }
+    if (len <= 0 || len >= (int)sizeof(payload) - 2) return false;
+    len += snprintf(payload + len, sizeof(payload) - len, "]}");
+
+    // One topic per tracker, as for its workout data
+    char topic[48];
+    snprintf(topic, sizeof(topic), TOPIC_HR_TIMELINE "/%s", peer);
+
+    // Published in a burst at workout end: queue rather than block, and
+    // keep it through a connection blip
+    int msg_id = esp_mqtt_client_enqueue(mqtt_client, topic,
+                                         payload, len,
+                                         1 /* qos */, 0 /* retain */,
+                                         true /* store offline */);
+    return msg_id >= 0;
+}
+
+bool mqtt_publish_workout_data(const char *peer, const char* json_data, size_t len)
 {
     if (mqtt_client == NULL) return false;
 
+    // One topic per tracker so a gateway's trackers can be told apart
+    char topic[48];
+    snprintf(topic, sizeof(topic), TOPIC_WORKOUT "/%s", peer);
+
     // QoS2 + enqueue to get exactly-once delivery and queue if connection blips
-    size_t len = strlen(json_data);
-    int msg_id = esp_mqtt_client_enqueue(mqtt_client, TOPIC_WORKOUT,
+    int msg_id = esp_mqtt_client_enqueue(mqtt_client, topic,
                                          json_data, len,
                                          2 /* qos */, 0 /* retain */,
                                          true /* store offline */);
@@ -219,10 +369,23 @@ bool mqtt_publish_workout_data(const char* json_data)
         ESP_LOGW(TAG, "Failed to publish workout data (len=%d)", (int)len);
         return false;
     }
-    ESP_LOGI(TAG, "Workout publish queued (msg_id=%d, len=%d, qos=2)", msg_id, (int)len);
+    ESP_LOGI(TAG, "Workout publish queued to %s (msg_id=%d, len=%d, qos=2)",
+             topic, msg_id, (int)len);
     return true;
 }
 
+bool mqtt_publish_diag(const char *json, size_t len)
+{
+    if (!mqtt_connected || mqtt_client == NULL) return false;
+
+    // Called from the BLE RX worker: queue, never wait on the network
+    int msg_id = esp_mqtt_client_enqueue(mqtt_client, TOPIC_DIAG,
+                                         json, (int)len,
+                                         0 /* qos */, 0 /* retain */,
+                                         true /* store */);
+    return msg_id >= 0;
+}
+
 const char* mqtt_get_mode(void)
 {
     return current_mode;
@@ -0,0 +1,335 @@
+#include "workout_codec.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Type byte on the wire; fixed here so the enum can change freely
+#define WIRE_START    1
+#define WIRE_LAP      2
+#define WIRE_DONE     3
+#define WIRE_STOP     4
+#define WIRE_STATUS   5
+#define WIRE_HR_REQ   6
+#define WIRE_HR_DONE  7
+
+#define HR_DONE_LEN   17
+
+typedef struct {
+    uint8_t *p;
+    uint8_t *end;
+} writer_t;
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+} reader_t;
+
+static void put_u8(writer_t *w, uint32_t v)
+{
+    if (w->p < w->end) {
+        *w->p = (uint8_t)v;
+    }
+    w->p++;
+}
+
+static void put_u16(writer_t *w, uint32_t v)
+{
+    put_u8(w, v & 0xFF);
+    put_u8(w, v >> 8);
+}
+
+static void put_u32(writer_t *w, uint32_t v)
+{
+    put_u16(w, v & 0xFFFF);
+    put_u16(w, v >> 16);
+}
+
+static void put_str(writer_t *w, const char *s)
+{
+    size_t n = strnlen(s, WORKOUT_EVENT_STR_LEN - 1);
+    put_u8(w, n);
+    for (size_t i = 0; i < n; i++) {
+        put_u8(w, (uint8_t)s[i]);
+    }
+}
+
+static uint32_t sat(int64_t v, uint32_t max)
+{
+    return v < 0 ? 0 : v > max ? max : (uint32_t)v;
+}
+
+static bool get_u8(reader_t *r, uint8_t *v)
+{
+    if (r->p >= r->end) {
+        return false;
+    }
+    *v = *r->p++;
+    return true;
+}
+
+static bool get_u16(reader_t *r, uint16_t *v)
+{
+    if (r->end - r->p < 2) {
+        return false;
+    }
+    *v = (uint16_t)(r->p[0] | (r->p[1] << 8));
+    r->p += 2;
+    return true;
+}
+
+static bool get_u32(reader_t *r, uint32_t *v)
+{
+    if (r->end - r->p < 4) {
+        return false;
+    }
+    *v = (uint32_t)r->p[0] | ((uint32_t)r->p[1] << 8) | ((uint32_t)r->p[2] << 16) |
+         ((uint32_t)r->p[3] << 24);
+    r->p += 4;
+    return true;
+}
+
+static bool get_str(reader_t *r, char *out)
+{
+    uint8_t n;
+    if (!get_u8(r, &n) || n >= WORKOUT_EVENT_STR_LEN || r->end - r->p < n) {
+        return false;
+    }
+    memcpy(out, r->p, n);
+    out[n] = '\0';
+    r->p += n;
+    return true;
+}
+
+bool workout_codec_is_frame(const uint8_t *data, size_t len)
+{
+    return len >= 2 && data[0] == WORKOUT_CODEC_MAGIC;
+}
+
+size_t workout_codec_encode(const workout_event_t *ev, uint8_t *out, size_t cap)
+{
+    writer_t w = { out, out + cap };
+
+    put_u8(&w, WORKOUT_CODEC_MAGIC);
+
+    switch (ev->type) {
+    case WORKOUT_EVT_START:
+        put_u8(&w, WIRE_START);
+        put_u16(&w, sat(ev->laps, UINT16_MAX));
+        put_str(&w, ev->mode);
+        break;
+    case WORKOUT_EVT_LAP:
+        put_u8(&w, WIRE_LAP);
+        put_u16(&w, sat(ev->lap, UINT16_MAX));
+        put_u32(&w, ev->lap_ms);
+        put_u32(&w, ev->split_ms);
+        break;
+    case WORKOUT_EVT_DONE:
+    case WORKOUT_EVT_STOP:
+        put_u8(&w, ev->type == WORKOUT_EVT_DONE ? WIRE_DONE : WIRE_STOP);
+        put_u16(&w, sat(ev->laps, UINT16_MAX));
+        put_u32(&w, ev->total_ms);
+        break;
+    case WORKOUT_EVT_STATUS:
+        put_u8(&w, WIRE_STATUS);
+        put_u16(&w, sat(ev->lap, UINT16_MAX));
+        put_u32(&w, ev->elapsed_ms);
+        put_str(&w, ev->state);
+        break;
+    case WORKOUT_EVT_HR_REQ:
+        put_u8(&w, WIRE_HR_REQ);
+        put_u16(&w, sat(ev->lap, UINT16_MAX));
+        put_u32(&w, ev->window_ms);
+        break;
+    default:
+        return 0;
+    }
+
+    return w.p <= w.end ? (size_t)(w.p - out) : 0;
+}
+
+bool workout_codec_decode(const uint8_t *data, size_t len, workout_event_t *ev)
+{
+    reader_t r = { data, data + len };
+    uint8_t magic, type;
+    uint16_t n16 = 0;
+    const char *name;
+    bool ok;
+
+    memset(ev, 0, sizeof(*ev));
+
+    if (!get_u8(&r, &magic) || magic != WORKOUT_CODEC_MAGIC || !get_u8(&r, &type)) {
+        return false;
+    }
+
+    switch (type) {
+    case WIRE_START:
+        ev->type = WORKOUT_EVT_START;
+        name = "start";
+        ok = get_u16(&r, &n16) && get_str(&r, ev->mode);
+        ev->laps = n16;
+        ev->fields = WORKOUT_HAS_LAPS | WORKOUT_HAS_MODE;
+        break;
+    case WIRE_LAP:
+        ev->type = WORKOUT_EVT_LAP;
+        name = "lap";
+        ok = get_u16(&r, &n16) && get_u32(&r, &ev->lap_ms) && get_u32(&r, &ev->split_ms);
+        ev->lap = n16;
+        ev->fields = WORKOUT_HAS_LAP | WORKOUT_HAS_LAP_MS | WORKOUT_HAS_SPLIT_MS;
+        break;
+    case WIRE_DONE:
+    case WIRE_STOP:
+        ev->type = type == WIRE_DONE ? WORKOUT_EVT_DONE : WORKOUT_EVT_STOP;
+        name = type == WIRE_DONE ? "done" : "stop";
+        ok = get_u16(&r, &n16) && get_u32(&r, &ev->total_ms);
+        ev->laps = n16;
+        ev->fields = WORKOUT_HAS_LAPS | WORKOUT_HAS_TOTAL_MS;
+        break;
+    case WIRE_STATUS:
+        ev->type = WORKOUT_EVT_STATUS;
+        name = "status";
+        ok = get_u16(&r, &n16) && get_u32(&r, &ev->elapsed_ms) && get_str(&r, ev->state);
+        ev->lap = n16;
+        ev->fields = WORKOUT_HAS_LAP | WORKOUT_HAS_ELAPSED_MS | WORKOUT_HAS_STATE;
+        break;
+    case WIRE_HR_REQ:
+        ev->type = WORKOUT_EVT_HR_REQ;
+        name = "hr_req";
+        ok = get_u16(&r, &n16) && get_u32(&r, &ev->window_ms);
+        ev->lap = n16;
+        ev->fields = WORKOUT_HAS_LAP | WORKOUT_HAS_WINDOW_MS;
+        break;
+    default:
+        name = "";
+        ok = false;
+        break;
+    }
+
+    if (!ok || r.p != r.end) {
+        memset(ev, 0, sizeof(*ev));
+        return false;
+    }
+
+    strcpy(ev->name, name);
+    return true;
+}
+
+size_t workout_codec_encode_hr_done(const workout_hr_done_t *hr, uint8_t *out, size_t cap)
+{
+    writer_t w = { out, out + cap };
+
+    put_u8(&w, WORKOUT_CODEC_MAGIC);
+    put_u8(&w, WIRE_HR_DONE);
+    put_u16(&w, hr->lap);
+    put_u8(&w, sat(hr->bpm, UINT8_MAX));
+    put_u8(&w, sat(hr->min_bpm, UINT8_MAX));
+    put_u8(&w, sat(hr->max_bpm, UINT8_MAX));
+    put_u8(&w, sat(hr->mean_bpm, UINT8_MAX));
+    put_u8(&w, sat(hr->median_bpm, UINT8_MAX));
+    put_u16(&w, hr->beats);
+    put_u16(&w, hr->flagged);
+    put_u8(&w, hr->quality);
+    put_u16(&w, sat(hr->window_ms, UINT16_MAX));
+    put_u8(&w, hr->live ? 1 : 0);
+
+    return w.p <= w.end ? (size_t)(w.p - out) : 0;
+}
+
+bool workout_codec_decode_hr_done(const uint8_t *data, size_t len, workout_hr_done_t *hr)
+{
+    reader_t r = { data, data + len };
+    uint8_t magic, type, bpm[5] = {0}, flags = 0;
+    uint16_t window_ms = 0;
+
+    memset(hr, 0, sizeof(*hr));
+
+    if (len != HR_DONE_LEN || !get_u8(&r, &magic) || magic != WORKOUT_CODEC_MAGIC ||
+        !get_u8(&r, &type) || type != WIRE_HR_DONE) {
+        return false;
+    }
+
+    get_u16(&r, &hr->lap);
+    for (int i = 0; i < 5; i++) {
+        get_u8(&r, &bpm[i]);
+    }
+    get_u16(&r, &hr->beats);
+    get_u16(&r, &hr->flagged);
+    get_u8(&r, &hr->quality);
+    get_u16(&r, &window_ms);
+    get_u8(&r, &flags);
+
+    hr->bpm = bpm[0];
+    hr->min_bpm = bpm[1];
+    hr->max_bpm = bpm[2];
+    hr->mean_bpm = bpm[3];
+    hr->median_bpm = bpm[4];
+    hr->window_ms = window_ms;
+    hr->live = flags & 1;
+    return true;
+}
+
+// Copy s into out as a JSON string body, escaping what needs it
+static void escape(const char *s, char *out, size_t cap)
+{
+    size_t n = 0;
+
+    for (; *s && n + 7 < cap; s++) {
+        unsigned char ch = (unsigned char)*s;
+        if (ch == '"' || ch == '\\') {
+            out[n++] = '\\';
+            out[n++] = (char)ch;
+        } else if (ch < 0x20) {
+            n += snprintf(out + n, cap - n, "\\u%04x", ch);
+        } else {
+            out[n++] = (char)ch;
+        }
+    }
+    out[n] = '\0';
+}
+
+int workout_codec_event_json(const workout_event_t *ev, char *out, size_t cap)
+{
+    char text[WORKOUT_EVENT_STR_LEN * 6 + 8];
+
+    switch (ev->type) {
+    case WORKOUT_EVT_START:
+        escape(ev->mode, text, sizeof(text));
+        return snprintf(out, cap, "{\"event\":\"start\",\"mode\":\"%s\",\"laps\":%ld}",
+                        text, (long)ev->laps);
+    case WORKOUT_EVT_LAP:
+        return snprintf(out, cap, "{\"event\":\"lap\",\"lap\":%ld,\"lap_ms\":%lu,\"split_ms\":%lu}",
+                        (long)ev->lap, (unsigned long)ev->lap_ms, (unsigned long)ev->split_ms);
+    case WORKOUT_EVT_DONE:
+    case WORKOUT_EVT_STOP:
+        return snprintf(out, cap, "{\"event\":\"%s\",\"laps\":%ld,\"total_ms\":%lu}",
+                        ev->type == WORKOUT_EVT_DONE ? "done" : "stop",
+                        (long)ev->laps, (unsigned long)ev->total_ms);
+    case WORKOUT_EVT_STATUS:
+        escape(ev->state, text, sizeof(text));
+        return snprintf(out, cap,
+                        "{\"event\":\"status\",\"state\":\"%s\",\"lap\":%ld,\"elapsed_ms\":%lu}",
+                        text, (long)ev->lap, (unsigned long)ev->elapsed_ms);
+    case WORKOUT_EVT_HR_REQ:
+        return snprintf(out, cap, "{\"cmd\":\"hr_req\",\"lap\":%ld,\"window_ms\":%lu}",
+                        (long)ev->lap, (unsigned long)ev->window_ms);
+    default:
+        escape(ev->name, text, sizeof(text));
+        return snprintf(out, cap, "{\"event\":\"%s\"}", text);
+    }
+}
+
+int workout_codec_hr_done_json(const workout_hr_done_t *hr, char *out, size_t cap)
+{
+    /* "bpm" stays the last good BPM so older MAX firmware keeps working */
+    return snprintf(out, cap,
+                    "{\"cmd\":\"hr_done\",\"lap\":%u,\"bpm\":%u,\"min\":%u,\"max\":%u,"
+                    "\"mean\":%u,\"median\":%u,\"beats\":%u,\"flagged\":%u,"
+                    "\"q\":%u,\"window_ms\":%lu,\"src\":\"%s\"}",
+                    hr->lap, hr->bpm, hr->min_bpm, hr->max_bpm, hr->mean_bpm,
+                    hr->median_bpm, hr->beats, hr->flagged, hr->quality,
+                    (unsigned long)hr->window_ms, hr->live ? "live" : "hist");
+}
+
+int workout_codec_hr_done_compact_json(const workout_hr_done_t *hr, char *out, size_t cap)
+{
+    return snprintf(out, cap, "{\"cmd\":\"hr_done\",\"bpm\":%u}", hr->bpm);
+}
@@ -0,0 +1,82 @@
+#ifndef WORKOUT_CODEC_H
+#define WORKOUT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "workout_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Packed binary framing for workout messages ("bin1").
+ *
+ * JSON stays the default on the link. After subscribing, the ESP32 offers
+ * {"cmd":"caps","codec":"bin1"} on the RX characteristic; a MAX that
+ * understands it answers {"cmd":"caps","codec":"bin1"} and from then on
+ * both sides may send frames. Older firmware ignores the offer and
+ * everything stays JSON.
+ *
+ * A frame is a magic byte, a type byte and a fixed little-endian payload:
+ *
+ *   start    u16 laps, u8 n, mode[n]
+ *   lap      u16 lap, u32 lap_ms, u32 split_ms
+ *   done     u16 laps, u32 total_ms
+ *   stop     u16 laps, u32 total_ms
+ *   status   u16 lap, u32 elapsed_ms, u8 n, state[n]
+ *   hr_req   u16 lap, u32 window_ms (0 = default)
+ *   hr_done  u16 lap, u8 bpm, min, max, mean, median, u16 beats, flagged,
+ *            u8 q, u16 window_ms, u8 flags (bit 0 = live)
+ *
+ * The magic is never '{' or JSON whitespace, so each notification is
+ * classified by its first byte and the two encodings can be mixed.
+ * Decoding reads straight out of the received buffer. Counts saturate at
+ * 16 bits and BPM values at 8 bits when encoding.
+ */
+
+#define WORKOUT_CODEC_NAME      "bin1"
+#define WORKOUT_CODEC_MAGIC     0xB1
+#define WORKOUT_CODEC_MAX_FRAME 32      /* Largest frame any type needs */
+
+typedef struct {
+    uint16_t lap;
+    uint16_t bpm;           /* Last good BPM */
+    uint16_t min_bpm;
+    uint16_t max_bpm;
+    uint16_t mean_bpm;
+    uint16_t median_bpm;
+    uint16_t beats;
+    uint16_t flagged;
+    uint8_t quality;
+    uint32_t window_ms;
+    bool live;              /* Captured live rather than from history */
+} workout_hr_done_t;
+
+/* True if data starts like a frame rather than JSON */
+bool workout_codec_is_frame(const uint8_t *data, size_t len);
+
+/* Encode ev into out; bytes written, 0 if the type has no frame or cap is short */
+size_t workout_codec_encode(const workout_event_t *ev, uint8_t *out, size_t cap);
+
+/* Decode one frame into ev (zeroed first); false if malformed */
+bool workout_codec_decode(const uint8_t *data, size_t len, workout_event_t *ev);
+
+size_t workout_codec_encode_hr_done(const workout_hr_done_t *hr, uint8_t *out, size_t cap);
+bool workout_codec_decode_hr_done(const uint8_t *data, size_t len, workout_hr_done_t *hr);
+
+/* JSON equivalents, as snprintf: length that would be written */
+int workout_codec_event_json(const workout_event_t *ev, char *out, size_t cap);
+int workout_codec_hr_done_json(const workout_hr_done_t *hr, char *out, size_t cap);
+
+/* The original {"cmd":"hr_done","bpm":N}, for a MAX that can take
+ * neither bin1 nor fragments of the full summary */
+int workout_codec_hr_done_compact_json(const workout_hr_done_t *hr, char *out, size_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WORKOUT_CODEC_H */
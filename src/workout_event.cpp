@@ -0,0 +1,447 @@
+#include "workout_event.h"
+
+#include <stddef.h>
+#include <string.h>
+
+// Deepest nesting skipped inside unknown values
+#define MAX_DEPTH 8
+
+// Longest key we can match; anything longer is skipped unread
+#define KEY_LEN   16
+
+typedef enum {
+    KIND_EVENT,
+    KIND_CMD,
+    KIND_STR,
+    KIND_INT,
+    KIND_UINT
+} field_kind_t;
+
+typedef struct {
+    const char *key;
+    field_kind_t kind;
+    size_t offset;
+    uint32_t bit;
+} field_t;
+
+static const field_t field_table[] = {
+    { "event",      KIND_EVENT, 0, 0 },
+    { "cmd",        KIND_CMD,   0, 0 },
+    { "mode",       KIND_STR,   offsetof(workout_event_t, mode),       WORKOUT_HAS_MODE },
+    { "state",      KIND_STR,   offsetof(workout_event_t, state),      WORKOUT_HAS_STATE },
+    { "codec",      KIND_STR,   offsetof(workout_event_t, codec),      WORKOUT_HAS_CODEC },
+    { "lap",        KIND_INT,   offsetof(workout_event_t, lap),        WORKOUT_HAS_LAP },
+    { "laps",       KIND_INT,   offsetof(workout_event_t, laps),       WORKOUT_HAS_LAPS },
+    { "lap_ms",     KIND_UINT,  offsetof(workout_event_t, lap_ms),     WORKOUT_HAS_LAP_MS },
+    { "split_ms",   KIND_UINT,  offsetof(workout_event_t, split_ms),   WORKOUT_HAS_SPLIT_MS },
+    { "total_ms",   KIND_UINT,  offsetof(workout_event_t, total_ms),   WORKOUT_HAS_TOTAL_MS },
+    { "elapsed_ms", KIND_UINT,  offsetof(workout_event_t, elapsed_ms), WORKOUT_HAS_ELAPSED_MS },
+    { "window_ms",  KIND_UINT,  offsetof(workout_event_t, window_ms),  WORKOUT_HAS_WINDOW_MS },
+    { "frag",       KIND_UINT,  offsetof(workout_event_t, frag),       WORKOUT_HAS_FRAG },
+};
+
+#define FIELD_COUNT (sizeof(field_table) / sizeof(field_table[0]))
+
+static const struct {
+    const char *name;
+    workout_event_type_t type;
+} event_names[] = {
+    { "start",  WORKOUT_EVT_START },
+    { "lap",    WORKOUT_EVT_LAP },
+    { "done",   WORKOUT_EVT_DONE },
+    { "stop",   WORKOUT_EVT_STOP },
+    { "status", WORKOUT_EVT_STATUS },
+};
+
+typedef struct {
+    const char *p;
+    const char *end;
+} cursor_t;
+
+static void skip_ws(cursor_t *c)
+{
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\n' || *c->p == '\r')) {
+        c->p++;
+    }
+}
+
+static int hex_digit(char ch)
+{
+    if (ch >= '0' && ch <= '9') {
+        return ch - '0';
+    }
+    if (ch >= 'a' && ch <= 'f') {
+        return ch - 'a' + 10;
+    }
+    if (ch >= 'A' && ch <= 'F') {
+        return ch - 'A' + 10;
+    }
+    return -1;
+}
+
+// Consume a string at c->p (the opening quote). Decoded bytes go to out,
+// truncated to out_len - 1 and NUL-terminated; *full is cleared if they
+// did not all fit. out may be NULL to just skip it.
+static bool parse_string(cursor_t *c, char *out, size_t out_len, bool *full)
+{
+    size_t n = 0;
+    bool fit = true;
+
+    if (c->p >= c->end || *c->p != '"') {
+        return false;
+    }
+    c->p++;
+
+    while (c->p < c->end) {
+        char ch = *c->p++;
+
+        if (ch == '"') {
+            if (out) {
+                out[n] = '\0';
+            }
+            if (full) {
+                *full = fit;
+            }
+            return true;
+        }
+        if ((unsigned char)ch < 0x20) {
+            return false;
+        }
+
+        if (ch == '\\') {
+            if (c->p >= c->end) {
+                return false;
+            }
+            ch = *c->p++;
+            switch (ch) {
+            case '"': case '\\': case '/': break;
+            case 'b': ch = '\b'; break;
+            case 'f': ch = '\f'; break;
+            case 'n': ch = '\n'; break;
+            case 'r': ch = '\r'; break;
+            case 't': ch = '\t'; break;
+            case 'u': {
+                if (c->end - c->p < 4) {
+                    return false;
+                }
+                unsigned v = 0;
+                for (int i = 0; i < 4; i++) {
+                    int d = hex_digit(c->p[i]);
+                    if (d < 0) {
+                        return false;
+                    }
+                    v = (v << 4) | (unsigned)d;
+                }
+                c->p += 4;
+                // An embedded NUL would cut the key short ("lap\u0000x"
+                // matching "lap"), so the message is refused
+                if (v == 0) {
+                    return false;
+                }
+                // Nothing we match on is outside ASCII
+                ch = v < 0x80 ? (char)v : '?';
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+
+        if (out && n + 1 < out_len) {
+            out[n++] = ch;
+        } else {
+            fit = false;
+        }
+    }
+    return false;
+}
+
+// Consume a JSON number; the integer part saturates at +/-2^32
+static bool parse_number(cursor_t *c, int64_t *out)
+{
+    const int64_t limit = (int64_t)1 << 32;
+    bool neg = false;
+    int64_t v = 0;
+
+    if (c->p < c->end && *c->p == '-') {
+        neg = true;
+        c->p++;
+    }
+    if (c->p >= c->end || *c->p < '0' || *c->p > '9') {
+        return false;
+    }
+    while (c->p < c->end && *c->p >= '0' && *c->p <= '9') {
+        if (v < limit) {
+            v = v * 10 + (*c->p - '0');
+        }
+        c->p++;
+    }
+    if (v > limit) {
+        v = limit;
+    }
+
+    // Fraction and exponent are accepted but dropped
+    if (c->p < c->end && *c->p == '.') {
+        c->p++;
+        if (c->p >= c->end || *c->p < '0' || *c->p > '9') {
+            return false;
+        }
+        while (c->p < c->end && *c->p >= '0' && *c->p <= '9') {
+            c->p++;
+        }
+    }
+    if (c->p < c->end && (*c->p == 'e' || *c->p == 'E')) {
+        c->p++;
+        if (c->p < c->end && (*c->p == '+' || *c->p == '-')) {
+            c->p++;
+        }
+        if (c->p >= c->end || *c->p < '0' || *c->p > '9') {
+            return false;
+        }
+        while (c->p < c->end && *c->p >= '0' && *c->p <= '9') {
+            c->p++;
+        }
+    }
+
+    *out = neg ? -v : v;
+    return true;
+}
+
+static bool parse_literal(cursor_t *c, const char *word)
+{
+    size_t n = strlen(word);
+    if ((size_t)(c->end - c->p) < n || memcmp(c->p, word, n) != 0) {
+        return false;
+    }
+    c->p += n;
+    return true;
+}
+
+// Consume any value we have no field for
+static bool skip_value(cursor_t *c, int depth)
+{
+    int64_t num;
+
+    skip_ws(c);
+    if (c->p >= c->end) {
+        return false;
+    }
+
+    switch (*c->p) {
+    case '"':
+        return parse_string(c, NULL, 0, NULL);
+    case 't':
+        return parse_literal(c, "true");
+    case 'f':
+        return parse_literal(c, "false");
+    case 'n':
+        return parse_literal(c, "null");
+    case '{':
+    case '[': {
+        char close = *c->p == '{' ? '}' : ']';
+        bool object = close == '}';
+
+        if (depth >= MAX_DEPTH) {
+            return false;
+        }
+        c->p++;
+        skip_ws(c);
+        if (c->p < c->end && *c->p == close) {
+            c->p++;
+            return true;
+        }
+        while (1) {
+            if (object) {
+                skip_ws(c);
+                if (!parse_string(c, NULL, 0, NULL)) {
+                    return false;
+                }
+                skip_ws(c);
+                if (c->p >= c->end || *c->p != ':') {
+                    return false;
+                }
+                c->p++;
+            }
+            if (!skip_value(c, depth + 1)) {
+                return false;
+            }
+            skip_ws(c);
+            if (c->p >= c->end) {
+                return false;
+            }
+            if (*c->p == close) {
+                c->p++;
+                return true;
+            }
+            if (*c->p != ',') {
+                return false;
+            }
+            c->p++;
+        }
+    }
+    default:
+        return parse_number(c, &num);
+    }
+}
+
+static const field_t *find_field(const char *key)
+{
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (strcmp(field_table[i].key, key) == 0) {
+            return &field_table[i];
+        }
+    }
+    return NULL;
+}
+
+// Parse the value of a known key into ev. A value of the wrong JSON type
+// is skipped and the field left unset.
+static bool parse_field(cursor_t *c, const field_t *f, workout_event_t *ev,
+                        char *event, char *cmd)
+{
+    skip_ws(c);
+    if (c->p >= c->end) {
+        return false;
+    }
+
+    char *str = NULL;
+    switch (f->kind) {
+    case KIND_EVENT: str = event; break;
+    case KIND_CMD:   str = cmd; break;
+    case KIND_STR:   str = (char *)ev + f->offset; break;
+    default: break;
+    }
+
+    if (str) {
+        if (*c->p != '"') {
+            return skip_value(c, 0);
+        }
+        if (!parse_string(c, str, WORKOUT_EVENT_STR_LEN, NULL)) {
+            return false;
+        }
+        ev->fields |= f->bit;
+        return true;
+    }
+
+    if (*c->p != '-' && (*c->p < '0' || *c->p > '9')) {
+        return skip_value(c, 0);
+    }
+
+    int64_t v;
+    if (!parse_number(c, &v)) {
+        return false;
+    }
+
+    if (f->kind == KIND_INT) {
+        if (v > INT32_MAX) {
+            v = INT32_MAX;
+        }
+        if (v < INT32_MIN) {
+            v = INT32_MIN;
+        }
+        int32_t iv = (int32_t)v;
+        memcpy((char *)ev + f->offset, &iv, sizeof(iv));
+    } else {
+        if (v > (int64_t)UINT32_MAX) {
+            v = UINT32_MAX;
+        }
+        if (v < 0) {
+            v = 0;
+        }
+        uint32_t uv = (uint32_t)v;
+        memcpy((char *)ev + f->offset, &uv, sizeof(uv));
+    }
+    ev->fields |= f->bit;
+    return true;
+}
+
+static void resolve_type(workout_event_t *ev, const char *event, const char *cmd)
+{
+    if (strcmp(cmd, "hr_req") == 0 || strcmp(cmd, "caps") == 0) {
+        ev->type = cmd[0] == 'h' ? WORKOUT_EVT_HR_REQ : WORKOUT_EVT_CAPS;
+        strcpy(ev->name, cmd);
+        return;
+    }
+
+    const char *name = event[0] ? event : cmd;
+    if (name[0] == '\0') {
+        ev->type = WORKOUT_EVT_NONE;
+        return;
+    }
+
+    strcpy(ev->name, name);
+    ev->type = WORKOUT_EVT_UNKNOWN;
+    if (name == event) {
+        for (size_t i = 0; i < sizeof(event_names) / sizeof(event_names[0]); i++) {
+            if (strcmp(event_names[i].name, event) == 0) {
+                ev->type = event_names[i].type;
+                break;
+            }
+        }
+    }
+}
+
+bool workout_event_parse(const char *json, size_t len, workout_event_t *ev)
+{
+    cursor_t c = { json, json + len };
+    char event[WORKOUT_EVENT_STR_LEN] = "";
+    char cmd[WORKOUT_EVENT_STR_LEN] = "";
+
+    memset(ev, 0, sizeof(*ev));
+
+    skip_ws(&c);
+    if (c.p >= c.end || *c.p != '{') {
+        return false;
+    }
+    c.p++;
+
+    skip_ws(&c);
+    if (c.p < c.end && *c.p == '}') {
+        c.p++;
+    } else {
+        while (1) {
+            char key[KEY_LEN];
+            bool key_fits;
+
+            skip_ws(&c);
+            if (!parse_string(&c, key, sizeof(key), &key_fits)) {
+                return false;
+            }
+            skip_ws(&c);
+            if (c.p >= c.end || *c.p != ':') {
+                return false;
+            }
+            c.p++;
+
+            const field_t *f = key_fits ? find_field(key) : NULL;
+            if (f ? !parse_field(&c, f, ev, event, cmd) : !skip_value(&c, 0)) {
+                return false;
+            }
+
+            skip_ws(&c);
+            if (c.p >= c.end) {
+                return false;
+            }
+            if (*c.p == '}') {
+                c.p++;
+                break;
+            }
+            if (*c.p != ',') {
+                return false;
+            }
+            c.p++;
+        }
+    }
+
+    // The MAX firmware may send its C string terminator along
+    while (c.p < c.end && (*c.p == '\0' || *c.p == ' ' || *c.p == '\n' || *c.p == '\r' ||
+                           *c.p == '\t')) {
+        c.p++;
+    }
+    if (c.p != c.end) {
+        return false;
+    }
+
+    resolve_type(ev, event, cmd);
+    return true;
+}
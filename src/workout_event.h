@@ -0,0 +1,79 @@
+#ifndef WORKOUT_EVENT_H
+#define WORKOUT_EVENT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Typed view of one workout message from the MAX32655.
+ *
+ * Messages are flat JSON objects such as
+ *
+ *   {"event":"lap","lap":3,"lap_ms":61234,"split_ms":183702}
+ *   {"cmd":"hr_req","lap":3,"window_ms":10000}
+ *
+ * workout_event_parse() decodes one in a single linear pass with no
+ * allocation and no NUL terminator needed. Only top-level keys are
+ * matched, and only on their exact full name, so "lap" never matches
+ * "laps" or text inside a string value. Unknown keys are skipped, nested
+ * objects and arrays included. Strings longer than their field are
+ * truncated; integers saturate at the field's range.
+ */
+
+#define WORKOUT_EVENT_STR_LEN 16
+
+typedef enum {
+    WORKOUT_EVT_NONE = 0,   /* No "event" or "cmd" key */
+    WORKOUT_EVT_UNKNOWN,    /* Present but not one we know; see name */
+    WORKOUT_EVT_START,
+    WORKOUT_EVT_LAP,
+    WORKOUT_EVT_DONE,
+    WORKOUT_EVT_STOP,
+    WORKOUT_EVT_STATUS,
+    WORKOUT_EVT_HR_REQ,     /* "cmd":"hr_req" */
+    WORKOUT_EVT_CAPS        /* "cmd":"caps", reply to our codec offer */
+} workout_event_type_t;
+
+/* Bits in workout_event_t.fields, set for each key present */
+#define WORKOUT_HAS_MODE        (1u << 0)
+#define WORKOUT_HAS_STATE       (1u << 1)
+#define WORKOUT_HAS_LAP         (1u << 2)
+#define WORKOUT_HAS_LAPS        (1u << 3)
+#define WORKOUT_HAS_LAP_MS      (1u << 4)
+#define WORKOUT_HAS_SPLIT_MS    (1u << 5)
+#define WORKOUT_HAS_TOTAL_MS    (1u << 6)
+#define WORKOUT_HAS_ELAPSED_MS  (1u << 7)
+#define WORKOUT_HAS_WINDOW_MS   (1u << 8)
+#define WORKOUT_HAS_CODEC       (1u << 9)
+#define WORKOUT_HAS_FRAG        (1u << 10)
+
+typedef struct {
+    workout_event_type_t type;
+    uint32_t fields;
+    char name[WORKOUT_EVENT_STR_LEN];   /* "event" value, or "cmd" if set */
+    char mode[WORKOUT_EVENT_STR_LEN];
+    char state[WORKOUT_EVENT_STR_LEN];
+    char codec[WORKOUT_EVENT_STR_LEN];
+    int32_t lap;
+    int32_t laps;
+    uint32_t lap_ms;
+    uint32_t split_ms;
+    uint32_t total_ms;
+    uint32_t elapsed_ms;
+    uint32_t window_ms;
+    uint32_t frag;          /* caps: non-zero if ble_frag is understood */
+} workout_event_t;
+
+/* Decode len bytes of json into ev (zeroed first); false if malformed */
+bool workout_event_parse(const char *json, size_t len, workout_event_t *ev);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* WORKOUT_EVENT_H */
@@ -14,7 +14,7 @@ import sys
 BROKER = "200.69.13.70"
 PORT = 1883
 TOPIC_HEART = "pulsetracker/heartRate"
-TOPIC_WORKOUT = "pulsetracker/workout"
+TOPIC_WORKOUT = "pulsetracker/workout/sim"  # pulsetracker/workout/<tracker>
 TOPIC_MODE = "pulsetracker/mode"
 TOPIC_BUZZER = "pulsetracker/buzzer"
 
@@ -0,0 +1,148 @@
+/*
+ * Host check for the PPG filter bank.
+ *
+ * PpgFilter is swept with sine waves and its gain, from the sin/cos
+ * correlation of the settled output over whole cycles, checked at:
+ *
+ *   - a tenth of the high-pass corner (baseline wander)   <= -20 dB
+ *   - the high-pass and low-pass corners                  -3 dB +-0.5
+ *   - 1, 2 and 3 Hz (pass band)                           within 1 dB
+ *   - four times the low-pass corner (stop band)          <= -20 dB
+ *   - the mains notch, unless compiled out                <= -40 dB
+ *
+ * Its cost per sample is then timed against the (x*7 + v*3)/10 EMA
+ * smoothing it replaced.
+ *
+ * Usage: hr_filter_check
+ * Exits non-zero when any point is out of its limits.
+ */
+
+#include "hr_filter.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+#ifndef HR_SAMPLE_RATE_HZ
+#define HR_SAMPLE_RATE_HZ 500   // As the firmware builds it by default
+#endif
+
+#define SWEEP_AMPLITUDE (1 << 20)  // Input peak, large so -60 dB stays above rounding
+#define SWEEP_SETTLE_S        10   // Transients of the 0.5 Hz high-pass die out
+#define SWEEP_MEASURE_S       20   // Whole cycles of every swept frequency
+#define BENCH_SAMPLES (HR_SAMPLE_RATE_HZ * 600)
+
+struct sweep_point_t {
+    double hz;
+    double min_db;
+    double max_db;
+    const char *what;
+};
+
+// Gain of the firmware filter at hz (dB), from the sin/cos correlation of
+// the settled output over whole cycles
+static double filter_gain_db(double hz)
+{
+    hr_filter::PpgFilter<HR_SAMPLE_RATE_HZ> filter;
+    const double w = 2.0 * M_PI * hz / HR_SAMPLE_RATE_HZ;
+    const uint32_t settle = SWEEP_SETTLE_S * HR_SAMPLE_RATE_HZ;
+    const uint32_t n = SWEEP_MEASURE_S * HR_SAMPLE_RATE_HZ;
+    double si = 0.0, co = 0.0;
+
+    filter.reset(0);
+    for (uint32_t k = 0; k < settle + n; k++) {
+        int32_t y = filter.step((int32_t)lround(SWEEP_AMPLITUDE * sin(w * k)));
+        if (k >= settle) {
+            si += y * sin(w * k);
+            co += y * cos(w * k);
+        }
+    }
+    double gain = 2.0 * sqrt(si * si + co * co) / n / SWEEP_AMPLITUDE;
+    return gain > 0.0 ? 20.0 * log10(gain) : -200.0;
+}
+
+// The smoothing heart_rate.cpp ran before the biquad bank
+static int32_t ema_step(int32_t *state, int32_t x)
+{
+    *state = (*state * 7 + x * 3) / 10;
+    return *state;
+}
+
+static bool sweep(void)
+{
+    const double hp = HR_FILTER_HP_MHZ / 1000.0;
+    const double lp = HR_FILTER_LP_MHZ / 1000.0;
+    const sweep_point_t points[] = {
+        { hp / 10.0, -200.0, -20.0, "baseline wander" },
+        { hp,          -3.5,  -2.5, "high-pass corner" },
+        { 1.0,         -1.0,   1.0, "pass band" },
+        { 2.0,         -1.0,   1.0, "pass band" },
+        { 3.0,         -1.0,   1.0, "pass band" },
+        { lp,          -3.5,  -2.5, "low-pass corner" },
+        { lp * 4.0,  -200.0, -20.0, "stop band" },
+        { (double)HR_FILTER_NOTCH_HZ, -200.0, -40.0, "mains notch" },
+    };
+    bool ok = true;
+
+    printf("%-16s %8s %8s %8s\n", "point", "hz", "gain_db", "limit");
+    for (const sweep_point_t &p : points) {
+        if (p.hz <= 0.0) {
+            continue;   // Notch compiled out
+        }
+        double db = filter_gain_db(p.hz);
+        bool pass = db >= p.min_db && db <= p.max_db;
+        char limit[32];
+        if (p.min_db <= -200.0) {
+            snprintf(limit, sizeof(limit), "<= %.1f", p.max_db);
+        } else {
+            snprintf(limit, sizeof(limit), "%.1f..%.1f", p.min_db, p.max_db);
+        }
+        printf("%-16s %8.2f %8.2f %8s%s\n", p.what, p.hz, db, limit, pass ? "" : "  FAIL");
+        if (!pass) {
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// Cost on a noisy pulse-band input; the sink keeps the loops honest
+static void bench(void)
+{
+    std::vector<int32_t> in(BENCH_SAMPLES);
+    uint32_t seed = 1;
+    for (size_t k = 0; k < in.size(); k++) {
+        seed = seed * 1664525u + 1013904223u;
+        in[k] = 1800 + (int32_t)lround(150.0 * sin(2.0 * M_PI * 1.2 * k / HR_SAMPLE_RATE_HZ)) +
+                (int32_t)(seed >> 28) - 8;
+    }
+
+    volatile int32_t sink = 0;
+    int32_t ema = in[0];
+    auto t0 = std::chrono::steady_clock::now();
+    for (int32_t x : in) {
+        sink = ema_step(&ema, x);
+    }
+    double ema_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - t0).count() / in.size();
+
+    hr_filter::PpgFilter<HR_SAMPLE_RATE_HZ> filter;
+    filter.reset(in[0]);
+    t0 = std::chrono::steady_clock::now();
+    for (int32_t x : in) {
+        sink = filter.step(x);
+    }
+    double cascade_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - t0).count() / in.size();
+    (void)sink;
+
+    printf("ns/smp: ema %.1f, cascade %.1f (x%.1f)\n", ema_ns, cascade_ns,
+           ema_ns > 0.0 ? cascade_ns / ema_ns : 0.0);
+}
+
+int main(void)
+{
+    bool ok = sweep();
+    bench();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,835 @@
+/*
+ * Host replay harness for the heart-rate pipeline.
+ *
+ * Streams annotated waveforms through the exact firmware code path
+ * (hr_sampler decimation -> hr_pipeline filter/detector/RR validation)
+ * and scores the published beats against the annotations:
+ *
+ *   Se   = TP / (TP + FN)   sensitivity
+ *   PPV  = TP / (TP + FP)   positive predictivity
+ *   RR   mean absolute error of published intervals (us)
+ *   BPM  mean absolute error of the reported BPM (bpm)
+ *   ns/sample and real-time factor of sampler + pipeline
+ *
+ * A published beat matches an annotated onset when it lands within
+ * MATCH_WINDOW_MS after it. The first SKIP_MS of every trace is ignored
+ * while the detector learns its thresholds. Beats the pipeline flags as
+ * artifacts (quality below HR_QUALITY_MIN) are counted separately and
+ * not scored, as consumers drop them too.
+ *
+ * Traces come from a corpus file, one per line:
+ *
+ *   synth <name> <bpm> <jitter_ms> <amp> <noise> <drift> <seconds> <seed> [motion]
+ *   file  <path>
+ *
+ * Synthetic traces are generated at the raw DMA rate and decimated like
+ * the ADC front end. Recorded traces are either CSV ("mv[,beat]" per line,
+ * "# rate=<hz>" header, beat=1 on annotated onsets) or HRW1 binary:
+ *
+ *   "HRW1" u32 rate u32 samples u32 beats u32 beat_index[beats] i16 mv[samples]
+ *
+ * All values little-endian. Rates must be whole multiples of
+ * HR_SAMPLE_RATE_HZ.
+ *
+ * With --stall S the consumer stops popping blocks for STALL_MS once every
+ * S seconds, so the sampler overruns and drops blocks as it would on
+ * target. Beats must still land on the annotations; a trace where the
+ * pipeline saw no gap fails.
+ *
+ * With --codec the traces are instead streamed through the waveform
+ * codec in HR_WAVE_FRAME_SAMPLES frames: bytes per sample, encode time
+ * per frame and a decode round-trip check.
+ *
+ * With --session a fixed script of lap requests from two trackers, a
+ * cancel and their workout begin and end is played against the HR session
+ * state machine on the trace's own sample clock. Checked: live captures
+ * report exactly at their deadline, history answers come back inside the
+ * request, cancelled laps never report, every other lap reports once, a
+ * workout end finishes and publishes only its own tracker's laps (tline,
+ * both ends together), and each summary agrees exactly with the good
+ * beats the pipeline published in its window (diff). The
+ * worst summary BPM against the annotations (ann_bpm) and how often the
+ * state machine had to run (timer expiries and beat wakeups) are shown.
+ *
+ * Usage: hr_replay [--min-se X] [--min-ppv X] [--raw-rate HZ] [--stall S]
+ *                  [--codec | --session] corpus.txt
+ * Exits non-zero when any trace falls below the gates.
+ */
+
+#include "hr_pipeline.h"
+#include "hr_sampler.h"
+#include "hr_session_fsm.h"
+#include "hr_synth.h"
+#include "hr_wave_codec.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define MATCH_WINDOW_MS  500   // Detector reports ~one integration window late
+#define SKIP_MS         2500   // Learning period excluded from scoring
+#define BPM_TRUTH_BEATS   10   // Matches the pipeline's averaging length
+#define CHUNK_SAMPLES   1024   // Same as one DMA frame
+#define STALL_MS         800   // Consumer held off long enough to overrun the ring
+
+#define DEFAULT_RAW_RATE_HZ 20000
+
+
+struct trace_t {
+    char name[64];
+    uint32_t rate_hz;
+    std::vector<uint16_t> mv;       // Calibrated millivolts at rate_hz
+    std::vector<uint32_t> onsets;   // Annotated beat onsets (sample index)
+};
+
+struct result_t {
+    uint32_t truth;
+    uint32_t tp;
+    uint32_t fn;
+    uint32_t fp;
+    uint32_t flagged;
+    uint32_t quality_sum;
+    uint32_t windows;
+    double rr_mae_us;
+    double bpm_mae;
+    double ns_per_sample;
+    uint32_t gaps;          // Index jumps the pipeline saw
+};
+
+static uint32_t raw_rate_hz = DEFAULT_RAW_RATE_HZ;
+static uint32_t stall_every_s = 0;
+
+/* Trace sources */
+
+static bool make_synth(trace_t *t, const char *name, int bpm, int jitter, int amp,
+                       int noise, int drift, int seconds, uint32_t seed, int motion)
+{
+    hr_synth_config_t cfg = {};
+    cfg.rate_hz = raw_rate_hz;
+    cfg.bpm = (uint16_t)bpm;
+    cfg.rr_jitter_ms = (uint16_t)jitter;
+    cfg.baseline = 1800;
+    cfg.amplitude = (uint16_t)amp;
+    cfg.noise = (uint16_t)noise;
+    cfg.drift = (uint16_t)drift;
+    cfg.motion = (uint16_t)motion;
+    cfg.seed = seed;
+
+    hr_synth_t synth;
+    hr_synth_init(&synth, &cfg);
+
+    snprintf(t->name, sizeof(t->name), "%s", name);
+    t->rate_hz = raw_rate_hz;
+    t->mv.resize((size_t)raw_rate_hz * seconds);
+
+    uint16_t chunk[CHUNK_SAMPLES];
+    size_t pos = 0;
+    uint32_t beats = 0;
+    while (pos < t->mv.size()) {
+        size_t n = t->mv.size() - pos;
+        if (n > CHUNK_SAMPLES) n = CHUNK_SAMPLES;
+
+        hr_synth_fill(&synth, chunk, n);
+        if (synth.beats != beats) {
+            // A chunk is far shorter than any RR, so at most one new onset
+            t->onsets.push_back(synth.beat_start);
+            beats = synth.beats;
+        }
+
+        // Nominal 12 dB scale, as the uncalibrated firmware fallback
+        for (size_t i = 0; i < n; i++) {
+            t->mv[pos + i] = (uint16_t)((chunk[i] * 3300) >> 12);
+        }
+        pos += n;
+    }
+    return true;
+}
+
+static bool load_csv(trace_t *t, FILE *f)
+{
+    char line[128];
+    t->rate_hz = HR_SAMPLE_RATE_HZ;
+
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#') {
+            sscanf(line, "# rate=%u", &t->rate_hz);
+            continue;
+        }
+        int mv = 0, beat = 0;
+        int n = sscanf(line, "%d,%d", &mv, &beat);
+        if (n < 1) {
+            continue;
+        }
+        if (n == 2 && beat) {
+            t->onsets.push_back((uint32_t)t->mv.size());
+        }
+        t->mv.push_back((uint16_t)(mv < 0 ? 0 : mv));
+    }
+    return !t->mv.empty();
+}
+
+static bool load_hrw(trace_t *t, FILE *f)
+{
+    uint32_t hdr[3];
+    if (fread(hdr, sizeof(uint32_t), 3, f) != 3) {
+        return false;
+    }
+
+    t->rate_hz = hdr[0];
+    t->onsets.resize(hdr[2]);
+    std::vector<int16_t> samples(hdr[1]);
+    if (fread(t->onsets.data(), sizeof(uint32_t), hdr[2], f) != hdr[2] ||
+        fread(samples.data(), sizeof(int16_t), hdr[1], f) != hdr[1]) {
+        return false;
+    }
+
+    t->mv.resize(hdr[1]);
+    for (size_t i = 0; i < samples.size(); i++) {
+        t->mv[i] = (uint16_t)(samples[i] < 0 ? 0 : samples[i]);
+    }
+    return true;
+}
+
+static bool load_file(trace_t *t, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "hr_replay: cannot open %s\n", path);
+        return false;
+    }
+
+    const char *base = strrchr(path, '/');
+    snprintf(t->name, sizeof(t->name), "%s", base ? base + 1 : path);
+
+    char magic[4] = {};
+    bool ok;
+    if (fread(magic, 1, 4, f) == 4 && memcmp(magic, "HRW1", 4) == 0) {
+        ok = load_hrw(t, f);
+    } else {
+        rewind(f);
+        ok = load_csv(t, f);
+    }
+    fclose(f);
+
+    if (!ok) {
+        fprintf(stderr, "hr_replay: %s is not a valid trace\n", path);
+    }
+    return ok;
+}
+
+/* Replay and scoring */
+
+static bool replay(const trace_t *t, result_t *res)
+{
+    if (t->rate_hz % HR_SAMPLE_RATE_HZ != 0) {
+        fprintf(stderr, "hr_replay: %s: rate %u Hz is not a multiple of %d Hz\n",
+                t->name, t->rate_hz, HR_SAMPLE_RATE_HZ);
+        return false;
+    }
+
+    hr_sampler_init(t->rate_hz, HR_SAMPLE_RATE_HZ);
+    hr_pipeline_init();
+
+    std::vector<hr_beat_event_t> beats;
+    uint32_t samples = 0, quality_sum = 0, windows = 0;
+    hr_block_t block;
+    hr_beat_event_t ev;
+
+    // --stall: the consumer skips popping for STALL_MS at the end of every
+    // period, so the sampler drops blocks as when the task is held off
+    size_t stall_period = (size_t)stall_every_s * t->rate_hz;
+    size_t stall_len = (size_t)STALL_MS * t->rate_hz / 1000;
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos < t->mv.size(); pos += CHUNK_SAMPLES) {
+        size_t n = t->mv.size() - pos;
+        if (n > CHUNK_SAMPLES) n = CHUNK_SAMPLES;
+        hr_sampler_push_raw(&t->mv[pos], n);
+        if (stall_period && pos % stall_period >= stall_period - stall_len) {
+            continue;
+        }
+
+        while (hr_sampler_pop_block(&block)) {
+            for (uint32_t i = 0; i < HR_SAMPLER_BLOCK_SAMPLES; i++) {
+                uint32_t flags = hr_pipeline_push(block.first_index + i, block.samples[i], &ev);
+                if (flags & HR_PIPE_BEAT) {
+                    beats.push_back(ev);
+                }
+                if (flags & HR_PIPE_QUALITY) {
+                    quality_sum += hr_pipeline_quality();
+                    windows++;
+                }
+            }
+            samples += HR_SAMPLER_BLOCK_SAMPLES;
+        }
+    }
+    double elapsed_ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - t0).count();
+
+    // Annotation times at the trace's own rate; the fixed detector delay
+    // shifts every beat equally and only matters to the match window
+    std::vector<uint64_t> truth_us(t->onsets.size());
+    for (size_t i = 0; i < t->onsets.size(); i++) {
+        truth_us[i] = (uint64_t)t->onsets[i] * 1000000 / t->rate_hz;
+    }
+
+    hr_pipeline_stats_t pst;
+    hr_pipeline_get_stats(&pst);
+
+    memset(res, 0, sizeof(*res));
+    res->gaps = pst.gaps;
+    res->quality_sum = quality_sum;
+    res->windows = windows;
+    std::vector<bool> used(beats.size(), false);
+    double rr_err = 0.0, bpm_err = 0.0;
+    uint32_t rr_n = 0, bpm_n = 0;
+    size_t first = 0;
+
+    for (size_t a = 0; a < truth_us.size(); a++) {
+        uint64_t onset = truth_us[a];
+        if (onset < SKIP_MS * 1000ull) {
+            continue;
+        }
+        res->truth++;
+
+        // Greedy: earliest unused beat inside the window after the onset
+        while (first < beats.size() && beats[first].timestamp_us < onset) first++;
+        size_t k = first;
+        while (k < beats.size() && (used[k] || beats[k].timestamp_us < onset)) k++;
+        if (k == beats.size() || beats[k].timestamp_us >= onset + MATCH_WINDOW_MS * 1000ull) {
+            res->fn++;
+            continue;
+        }
+        used[k] = true;
+
+        // A real beat the pipeline flagged is lost to consumers
+        if (beats[k].quality < HR_QUALITY_MIN) {
+            res->flagged++;
+            res->fn++;
+            continue;
+        }
+        res->tp++;
+
+        if (a > 0) {
+            rr_err += abs((int)beats[k].rr_us - (int)(onset - truth_us[a - 1]));
+            rr_n++;
+        }
+        if (a >= BPM_TRUTH_BEATS && beats[k].bpm > 0) {
+            uint64_t span = onset - truth_us[a - BPM_TRUTH_BEATS];
+            double bpm = 60e6 * BPM_TRUTH_BEATS / span;
+            double diff = beats[k].bpm - bpm;
+            bpm_err += diff < 0 ? -diff : diff;
+            bpm_n++;
+        }
+    }
+
+    for (size_t k = 0; k < beats.size(); k++) {
+        if (used[k] || beats[k].timestamp_us < SKIP_MS * 1000ull) {
+            continue;
+        }
+        if (beats[k].quality < HR_QUALITY_MIN) {
+            res->flagged++;     // Artifact caught
+        } else {
+            res->fp++;
+        }
+    }
+
+    res->rr_mae_us = rr_n ? rr_err / rr_n : 0.0;
+    res->bpm_mae = bpm_n ? bpm_err / bpm_n : 0.0;
+    res->ns_per_sample = samples ? elapsed_ns / samples : 0.0;
+    return true;
+}
+
+/* Waveform codec benchmark */
+
+static bool codec_bench(const trace_t *t)
+{
+    if (t->rate_hz % HR_SAMPLE_RATE_HZ != 0) {
+        fprintf(stderr, "hr_replay: %s: rate %u Hz is not a multiple of %d Hz\n",
+                t->name, t->rate_hz, HR_SAMPLE_RATE_HZ);
+        return false;
+    }
+
+    // Decimate exactly as the firmware does before streaming
+    std::vector<int16_t> mv;
+    hr_block_t block;
+    hr_sampler_init(t->rate_hz, HR_SAMPLE_RATE_HZ);
+    for (size_t pos = 0; pos < t->mv.size(); pos += CHUNK_SAMPLES) {
+        size_t n = t->mv.size() - pos;
+        if (n > CHUNK_SAMPLES) n = CHUNK_SAMPLES;
+        hr_sampler_push_raw(&t->mv[pos], n);
+        while (hr_sampler_pop_block(&block)) {
+            mv.insert(mv.end(), block.samples, block.samples + HR_SAMPLER_BLOCK_SAMPLES);
+        }
+    }
+
+    static uint8_t frame[HR_WAVE_FRAME_BYTES(HR_WAVE_FRAME_SAMPLES)];
+    static int16_t decoded[HR_WAVE_FRAME_SAMPLES];
+    hr_wave_encoder_t enc;
+    hr_wave_header_t hdr;
+    size_t bytes = 0, frames = 0;
+    double encode_ns = 0.0;
+    bool ok = true;
+
+    for (size_t pos = 0; pos + HR_WAVE_FRAME_SAMPLES <= mv.size(); pos += HR_WAVE_FRAME_SAMPLES) {
+        auto t0 = std::chrono::steady_clock::now();
+        hr_wave_begin(&enc, frame, sizeof(frame), (uint32_t)frames,
+                      hr_pipeline_index_to_us((uint32_t)pos, 0), HR_SAMPLE_RATE_HZ);
+        for (size_t i = 0; i < HR_WAVE_FRAME_SAMPLES; i++) {
+            hr_wave_add(&enc, mv[pos + i]);
+        }
+        size_t len = hr_wave_finish(&enc);
+        encode_ns += std::chrono::duration<double, std::nano>(
+            std::chrono::steady_clock::now() - t0).count();
+
+        size_t n = hr_wave_decode(frame, len, &hdr, decoded, HR_WAVE_FRAME_SAMPLES);
+        if (n != HR_WAVE_FRAME_SAMPLES || hdr.seq != frames ||
+            memcmp(decoded, &mv[pos], n * sizeof(int16_t)) != 0) {
+            ok = false;
+        }
+        bytes += len;
+        frames++;
+    }
+
+    size_t samples = frames * HR_WAVE_FRAME_SAMPLES;
+    printf("%-14s %7zu %9zu %8.3f %10.0f %7.1f  %s\n", t->name, frames, bytes,
+           samples ? (double)bytes / samples : 0.0, frames ? encode_ns / frames : 0.0,
+           samples ? encode_ns / samples : 0.0, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+/* Session state machine on the virtual clock */
+
+struct session_step_t {
+    uint32_t at_ms;
+    char op;                // 'S' start, 'C' cancel, 'B'/'E' workout begin/end
+    uint16_t lap;
+    uint32_t window_ms;
+    uint8_t peer;
+};
+
+#define SESSION_PEERS 2
+#define SESSION_LAPS  512   // Lap numbers used by the script stay below this
+
+struct session_lap_t {
+    uint8_t peer;
+    bool pending;           // Live capture running
+    bool cancelled;
+    uint32_t reports;
+    uint32_t due_ms;
+    uint64_t from_us;
+};
+
+struct session_run_t {
+    const trace_t *trace;
+    session_lap_t laps[SESSION_LAPS];
+    uint32_t now_ms;
+    uint64_t now_us;
+    uint32_t hist, live, timeline;
+    uint32_t since_begin[SESSION_PEERS];    // Reports since the peer's workout began
+    int ending;             // Peer whose workout end is running, or -1
+    uint32_t max_late_ms;
+    uint32_t mismatches;    // Summaries that disagree with the beats
+    double bpm_err;
+    std::vector<hr_beat_event_t> beats;
+    bool ok;
+};
+
+// Annotated BPM over [from_us, to_us): mean of the BPM_TRUTH_BEATS
+// average ending at each onset inside, as the pipeline reports it
+static double truth_bpm(const trace_t *t, uint64_t from_us, uint64_t to_us)
+{
+    double sum = 0.0;
+    uint32_t n = 0;
+    for (size_t a = BPM_TRUTH_BEATS; a < t->onsets.size(); a++) {
+        uint64_t us = (uint64_t)t->onsets[a] * 1000000 / t->rate_hz;
+        if (us >= from_us && us < to_us) {
+            uint32_t span = t->onsets[a] - t->onsets[a - BPM_TRUTH_BEATS];
+            sum += 60.0 * BPM_TRUTH_BEATS * t->rate_hz / span;
+            n++;
+        }
+    }
+    return n ? sum / n : 0.0;
+}
+
+static void session_done(void *ctx, const hr_lap_timeline_t *lap)
+{
+    session_run_t *run = (session_run_t *)ctx;
+    session_lap_t *l = &run->laps[lap->lap];
+    uint64_t from_us, to_us = run->now_us;
+
+    if (l->cancelled || l->reports++ > 0 || lap->peer != l->peer) {
+        run->ok = false;    // Cancelled, reported twice or for the wrong tracker
+    }
+    if (run->ending >= 0 && lap->peer != run->ending) {
+        run->ok = false;    // Another tracker's workout end finished it
+    }
+    run->since_begin[lap->peer]++;
+
+    if (lap->live) {
+        // Early only when the workout ended under it
+        uint32_t late = run->now_ms - l->due_ms;
+        if (l->due_ms == UINT32_MAX) {
+            // Cut short
+        } else if ((int32_t)late < 0) {
+            run->ok = false;
+        } else if (late > run->max_late_ms) {
+            run->max_late_ms = late;
+        }
+        from_us = l->from_us;
+        l->pending = false;
+        run->live++;
+    } else {
+        from_us = run->now_us - (uint64_t)lap->window_ms * 1000;
+        run->hist++;
+    }
+
+    // The summary must be exactly the good beats published in the window
+    uint32_t n = 0, sum = 0;
+    for (const hr_beat_event_t &b : run->beats) {
+        if (b.timestamp_us >= from_us && b.bpm > 0 && b.quality >= HR_QUALITY_MIN) {
+            n++;
+            sum += b.bpm;
+        }
+    }
+    if (lap->summary.beats != n || (n && lap->summary.mean_bpm != (sum + n / 2) / n)) {
+        run->mismatches++;
+    }
+
+    // Against the annotations only for information: it includes the
+    // detector's own error, which the main replay scores. Windows reaching
+    // into the learning period are left out.
+    double truth = from_us >= SKIP_MS * 1000ull ? truth_bpm(run->trace, from_us, to_us) : 0.0;
+    if (truth > 0.0) {
+        double err = lap->summary.mean_bpm - truth;
+        err = err < 0 ? -err : err;
+        if (err > run->bpm_err) {
+            run->bpm_err = err;
+        }
+    }
+}
+
+static void session_timeline(void *ctx, const hr_lap_timeline_t *lap, uint32_t index,
+                             uint32_t count)
+{
+    session_run_t *run = (session_run_t *)ctx;
+    run->timeline++;
+    if (lap->peer != run->ending) {
+        run->ok = false;
+    }
+}
+
+static bool session_bench(const trace_t *t)
+{
+    // Sprint cadence: a lap every 3 s against 5 s windows, with a few
+    // live captures that overlap it, a duplicate, a cancel and the end
+    std::vector<session_step_t> script = {
+        {  1000, 'S',   1,  5000 },
+        {  2000, 'S',   2,  3000 },
+        {  2500, 'S',   2,  3000 },
+        {  3000, 'S',   3, 20000 },
+        {  4000, 'S', 259,  5000 },   // Not lap 3 again: laps are 16-bit
+        { 40000, 'S', 200, 50000 },
+        { 42000, 'C',   0,     0 },
+        { 45000, 'S', 201, 60000 },
+    };
+    for (uint32_t ms = 9000, lap = 10; ms < 100000; ms += 3000, lap++) {
+        script.push_back({ ms, 'S', (uint16_t)lap, HR_SESSION_WINDOW_MS });
+    }
+
+    // A second tracker with a short workout: a lap answered before it
+    // begins (kept out of its timeline), and an end that cuts its own
+    // live lap short but not the first tracker's lap 3
+    script.push_back({  1500, 'S', 150,  1000, 1 });
+    script.push_back({  6000, 'B',   0,     0, 1 });
+    script.push_back({  8000, 'S', 151,  5000, 1 });
+    script.push_back({ 10000, 'S', 152, 20000, 1 });
+    script.push_back({ 22000, 'E',   0,     0, 1 });
+
+    uint32_t end_ms = (uint32_t)((uint64_t)t->mv.size() * 1000 / t->rate_hz) - 100;
+    script.push_back({ end_ms, 'E', 0, 0, 0 });
+    std::stable_sort(script.begin(), script.end(),
+                     [](const session_step_t &a, const session_step_t &b) {
+                         return a.at_ms < b.at_ms;
+                     });
+
+    static session_run_t run;
+    run = session_run_t();
+    run.trace = t;
+    run.ok = true;
+    run.ending = -1;
+
+    hr_sampler_init(t->rate_hz, HR_SAMPLE_RATE_HZ);
+    hr_pipeline_init();
+    hr_beat_channel_reset();
+
+    static hr_session_fsm_t fsm;
+    hr_session_ops_t ops = { session_done, session_timeline, &run };
+    hr_session_fsm_init(&fsm, &ops);
+
+    size_t step = 0;
+    uint32_t due_ms = 0;
+    bool timer_armed = false;
+    uint32_t timer_runs = 0, beat_runs = 0, cmd_runs = 0, dones_at_end = 0;
+    hr_block_t block;
+    hr_beat_event_t ev;
+
+    for (size_t pos = 0; pos < t->mv.size(); pos += CHUNK_SAMPLES) {
+        size_t n = t->mv.size() - pos;
+        if (n > CHUNK_SAMPLES) n = CHUNK_SAMPLES;
+        hr_sampler_push_raw(&t->mv[pos], n);
+
+        while (hr_sampler_pop_block(&block)) {
+            for (uint32_t i = 0; i < HR_SAMPLER_BLOCK_SAMPLES; i++) {
+                uint32_t index = block.first_index + i;
+                uint32_t flags = hr_pipeline_push(index, block.samples[i], &ev);
+                bool run_fsm = false;
+                if (flags & HR_PIPE_BEAT) {
+                    run.beats.push_back(ev);
+                }
+
+                run.now_us = hr_pipeline_index_to_us(index, 0);
+                run.now_ms = (uint32_t)(run.now_us / 1000);
+
+                // The firmware wakes on each of these: a beat while
+                // capturing, the timer, a command
+                if ((flags & HR_PIPE_BEAT) && hr_session_fsm_active(&fsm)) {
+                    beat_runs++;
+                    run_fsm = true;
+                }
+                if (timer_armed && (int32_t)(run.now_ms - due_ms) >= 0) {
+                    timer_runs++;
+                    run_fsm = true;
+                }
+                while (step < script.size() && script[step].at_ms <= run.now_ms) {
+                    const session_step_t *s = &script[step++];
+                    session_lap_t *l = &run.laps[s->lap];
+                    cmd_runs++;
+                    run_fsm = true;
+                    hr_session_fsm_beats(&fsm);
+
+                    if (s->op == 'S') {
+                        bool dup = l->pending;
+                        uint32_t reports = l->reports;
+                        if (!dup) {
+                            l->due_ms = run.now_ms + s->window_ms;
+                            l->from_us = run.now_us;
+                        }
+                        l->peer = s->peer;
+                        hr_session_fsm_start(&fsm, run.now_ms, run.now_us, s->peer, s->lap,
+                                             s->window_ms);
+                        // No synchronous answer: it is capturing live
+                        if (!dup && l->reports == reports) {
+                            l->pending = true;
+                        }
+                    } else if (s->op == 'C') {
+                        hr_session_fsm_cancel(&fsm);
+                        for (session_lap_t &c : run.laps) {
+                            if (c.pending) {
+                                c.pending = false;
+                                c.cancelled = true;
+                            }
+                        }
+                    } else if (s->op == 'B') {
+                        hr_session_fsm_workout_begin(&fsm, s->peer);
+                        run.since_begin[s->peer] = 0;
+                    } else {
+                        for (session_lap_t &c : run.laps) {
+                            if (c.peer == s->peer && c.pending) {
+                                c.due_ms = UINT32_MAX;
+                            }
+                        }
+                        uint32_t dones = run.hist + run.live;
+                        uint32_t timeline = run.timeline;
+                        run.ending = s->peer;
+                        hr_session_fsm_workout_end(&fsm, s->peer);
+                        run.ending = -1;
+                        dones_at_end += run.hist + run.live - dones;
+
+                        // The tracker's laps since its workout began, or
+                        // the most recent of them
+                        uint32_t laps = run.since_begin[s->peer];
+                        laps = laps < HR_TIMELINE_LAPS ? laps : HR_TIMELINE_LAPS;
+                        if (run.timeline - timeline != laps) {
+                            run.ok = false;
+                        }
+                        run.since_begin[s->peer] = 0;
+                    }
+                }
+
+                if (run_fsm) {
+                    hr_session_fsm_beats(&fsm);
+                    uint32_t next = hr_session_fsm_tick(&fsm, run.now_ms);
+                    timer_armed = next != HR_SESSION_IDLE;
+                    due_ms = run.now_ms + next;
+                }
+            }
+        }
+    }
+
+    // Every lap that was not cancelled reported exactly once
+    uint32_t expected = 0;
+    for (const session_lap_t &l : run.laps) {
+        if (l.pending || (!l.cancelled && l.reports == 0 && l.due_ms != 0)) {
+            run.ok = false;
+        }
+        expected += l.reports;
+    }
+    uint32_t dones = run.hist + run.live;
+    if (expected != dones || fsm.duplicates != 1 ||
+        run.max_late_ms > 1000 / HR_SAMPLE_RATE_HZ || run.mismatches) {
+        run.ok = false;
+    }
+
+    double secs = (double)t->mv.size() / t->rate_hz;
+    printf("%-14s %5u %5u %5u %5u %5u %7u %5u %7.2f %6u %6u %7.2f  %s\n", t->name,
+           dones, run.hist, run.live, dones_at_end, run.timeline, run.max_late_ms,
+           run.mismatches, run.bpm_err,
+           timer_runs, beat_runs, (timer_runs + beat_runs + cmd_runs) / secs,
+           run.ok ? "ok" : "FAIL");
+    return run.ok;
+}
+
+static double ratio(uint32_t num, uint32_t den)
+{
+    return den ? (double)num / den : 1.0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: hr_replay [--min-se X] [--min-ppv X] [--raw-rate HZ] [--stall S]"
+            " [--codec | --session] corpus.txt\n");
+}
+
+int main(int argc, char **argv)
+{
+    double min_se = 0.0, min_ppv = 0.0;
+    const char *corpus = NULL;
+    bool codec = false;
+    bool session = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--min-se") && i + 1 < argc) {
+            min_se = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--min-ppv") && i + 1 < argc) {
+            min_ppv = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--raw-rate") && i + 1 < argc) {
+            raw_rate_hz = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--stall") && i + 1 < argc) {
+            stall_every_s = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--codec")) {
+            codec = true;
+        } else if (!strcmp(argv[i], "--session")) {
+            session = true;
+        } else if (argv[i][0] != '-' && !corpus) {
+            corpus = argv[i];
+        } else {
+            usage();
+            return 2;
+        }
+    }
+    if (!corpus) {
+        usage();
+        return 2;
+    }
+
+    FILE *f = fopen(corpus, "r");
+    if (!f) {
+        fprintf(stderr, "hr_replay: cannot open %s\n", corpus);
+        return 2;
+    }
+
+    if (codec) {
+        printf("%-14s %7s %9s %8s %10s %7s\n",
+               "trace", "frames", "bytes", "B/smp", "ns/frame", "ns/smp");
+    } else if (session) {
+        printf("%-14s %5s %5s %5s %5s %5s %7s %5s %7s %6s %6s %7s\n",
+               "trace", "done", "hist", "live", "end", "tline", "late_ms", "diff", "ann_bpm",
+               "timer", "beat", "wakes/s");
+    } else {
+        printf("%-14s %6s %6s %5s %5s %5s %7s %7s %8s %7s %5s %8s %8s\n",
+               "trace", "beats", "tp", "fn", "fp", "flag", "Se", "PPV", "rr_us", "bpm", "q",
+               "ns/smp", "xRT");
+    }
+
+    char line[256];
+    int failures = 0;
+    result_t total = {};
+
+    while (fgets(line, sizeof(line), f)) {
+        char kind[16], name[64];
+        int bpm, jitter, amp, noise, drift, seconds, motion = 0;
+        unsigned seed;
+        trace_t t;
+
+        if (line[0] == '#' || sscanf(line, "%15s", kind) != 1) {
+            continue;
+        }
+
+        bool ok;
+        if (!strcmp(kind, "synth") &&
+            sscanf(line, "%*s %63s %d %d %d %d %d %d %u %d", name, &bpm, &jitter, &amp,
+                   &noise, &drift, &seconds, &seed, &motion) >= 8) {
+            ok = make_synth(&t, name, bpm, jitter, amp, noise, drift, seconds, seed, motion);
+        } else if (!strcmp(kind, "file") && sscanf(line, "%*s %63s", name) == 1) {
+            ok = load_file(&t, name);
+        } else {
+            fprintf(stderr, "hr_replay: bad corpus line: %s", line);
+            ok = false;
+        }
+
+        if (ok && codec) {
+            if (!codec_bench(&t)) {
+                failures++;
+            }
+            continue;
+        }
+        if (ok && session) {
+            if (!session_bench(&t)) {
+                failures++;
+            }
+            continue;
+        }
+
+        result_t res;
+        if (!ok || !replay(&t, &res)) {
+            failures++;
+            continue;
+        }
+
+        double se = ratio(res.tp, res.tp + res.fn);
+        double ppv = ratio(res.tp, res.tp + res.fp);
+        double xrt = res.ns_per_sample > 0.0 ? (1e9 / HR_SAMPLE_RATE_HZ) / res.ns_per_sample : 0.0;
+        // A stall that the pipeline never saw as a gap tested nothing
+        bool pass = se >= min_se && ppv >= min_ppv && (stall_every_s == 0 || res.gaps > 0);
+
+        printf("%-14s %6u %6u %5u %5u %5u %7.3f %7.3f %8.1f %7.2f %5u %8.1f %8.0f%s\n",
+               t.name, res.truth, res.tp, res.fn, res.fp, res.flagged, se, ppv,
+               res.rr_mae_us, res.bpm_mae, res.windows ? res.quality_sum / res.windows : 0,
+               res.ns_per_sample, xrt, pass ? "" : "  FAIL");
+
+        total.truth += res.truth;
+        total.tp += res.tp;
+        total.fn += res.fn;
+        total.fp += res.fp;
+        total.flagged += res.flagged;
+        if (!pass) {
+            failures++;
+        }
+    }
+    fclose(f);
+
+    if (codec || session) {
+        return failures ? 1 : 0;
+    }
+
+    printf("%-14s %6u %6u %5u %5u %5u %7.3f %7.3f\n", "total", total.truth, total.tp,
+           total.fn, total.fp, total.flagged, ratio(total.tp, total.tp + total.fn),
+           ratio(total.tp, total.tp + total.fp));
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,191 @@
+/*
+ * Host check for the heart-rate sampling core.
+ *
+ * Feeds hr_synth codes at the raw DMA rate through hr_sampler in DMA
+ * frame sized chunks and checks that:
+ *
+ *   - every decimated sample is the box-car mean of its raw window (+-1
+ *     code for the Q16 reciprocal)
+ *   - blocks come out in sequence with contiguous sample indices
+ *   - a consumer that falls behind loses the newest blocks, counted as
+ *     overruns, and the blocks after the gap keep their true sample index
+ *   - sample indices convert to milliseconds exactly at whole seconds
+ *
+ * and times hr_sampler_push_raw per raw conversion.
+ *
+ * Usage: hr_sampler_check
+ * Exits non-zero on any failed check.
+ */
+
+#include "hr_sampler.h"
+#include "hr_synth.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define RAW_RATE_HZ   20000
+#define OUT_RATE_HZ     500
+#define CHUNK_SAMPLES  1024    // Same as one DMA frame
+#define RUN_S            60
+#define BENCH_S         600
+
+static int failures;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-44s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) {
+        failures++;
+    }
+}
+
+static void synth_init(hr_synth_t *synth)
+{
+    hr_synth_config_t cfg = {};
+    cfg.rate_hz = RAW_RATE_HZ;
+    cfg.bpm = 72;
+    cfg.rr_jitter_ms = 40;
+    cfg.baseline = 1800;
+    cfg.amplitude = 400;
+    cfg.noise = 20;
+    cfg.drift = 60;
+    cfg.seed = 1;
+    hr_synth_init(synth, &cfg);
+}
+
+// Decimated output against the raw codes, with the consumer keeping up
+static void check_stream(void)
+{
+    uint32_t decimation = hr_sampler_init(RAW_RATE_HZ, OUT_RATE_HZ);
+    check(decimation == RAW_RATE_HZ / OUT_RATE_HZ && hr_sampler_rate_hz() == OUT_RATE_HZ,
+          "decimation factor and output rate");
+
+    hr_synth_t synth;
+    synth_init(&synth);
+
+    std::vector<uint16_t> raw((size_t)RUN_S * RAW_RATE_HZ);
+    hr_synth_fill(&synth, raw.data(), raw.size());
+
+    bool mean_ok = true;
+    bool order_ok = true;
+    uint32_t expect_seq = 0;
+    hr_block_t block;
+
+    for (size_t pos = 0; pos < raw.size(); pos += CHUNK_SAMPLES) {
+        size_t n = raw.size() - pos < CHUNK_SAMPLES ? raw.size() - pos : CHUNK_SAMPLES;
+        hr_sampler_push_raw(&raw[pos], n);
+
+        while (hr_sampler_pop_block(&block)) {
+            if (block.seq != expect_seq ||
+                block.first_index != expect_seq * HR_SAMPLER_BLOCK_SAMPLES) {
+                order_ok = false;
+            }
+            expect_seq++;
+
+            for (uint32_t i = 0; i < HR_SAMPLER_BLOCK_SAMPLES; i++) {
+                size_t start = (size_t)(block.first_index + i) * decimation;
+                uint32_t sum = 0;
+                for (uint32_t k = 0; k < decimation; k++) {
+                    sum += raw[start + k];
+                }
+                int diff = (int)block.samples[i] - (int)((sum + decimation / 2) / decimation);
+                if (diff < -1 || diff > 1) {
+                    mean_ok = false;
+                }
+            }
+        }
+    }
+
+    hr_sampler_stats_t st;
+    hr_sampler_get_stats(&st);
+    check(mean_ok, "samples are box-car means of the raw codes");
+    check(order_ok, "blocks in sequence, indices contiguous");
+    check(st.overruns == 0 && st.raw_samples == raw.size() && st.blocks == expect_seq &&
+          expect_seq == (uint32_t)(RUN_S * OUT_RATE_HZ / HR_SAMPLER_BLOCK_SAMPLES),
+          "every block delivered, none overrun");
+}
+
+// A stalled consumer: the ring fills, newer blocks are dropped, and the
+// first block after the gap still carries its own sample index
+static void check_overrun(void)
+{
+    uint32_t decimation = hr_sampler_init(RAW_RATE_HZ, OUT_RATE_HZ);
+    const uint32_t extra = 4;
+    const size_t block_raw = (size_t)HR_SAMPLER_BLOCK_SAMPLES * decimation;
+
+    hr_synth_t synth;
+    synth_init(&synth);
+    std::vector<uint16_t> raw(block_raw);
+
+    for (uint32_t b = 0; b < HR_SAMPLER_RING_BLOCKS + extra; b++) {
+        hr_synth_fill(&synth, raw.data(), raw.size());
+        hr_sampler_push_raw(raw.data(), raw.size());
+    }
+
+    hr_block_t block;
+    uint32_t popped = 0;
+    bool kept_oldest = true;
+    while (hr_sampler_pop_block(&block)) {
+        kept_oldest = kept_oldest && block.seq == popped;
+        popped++;
+    }
+
+    hr_sampler_stats_t st;
+    hr_sampler_get_stats(&st);
+    check(popped == HR_SAMPLER_RING_BLOCKS && kept_oldest && st.overruns == extra,
+          "full ring drops the newest blocks");
+
+    hr_synth_fill(&synth, raw.data(), raw.size());
+    hr_sampler_push_raw(raw.data(), raw.size());
+    uint32_t after = HR_SAMPLER_RING_BLOCKS + extra;
+    check(hr_sampler_pop_block(&block) && block.seq == after &&
+          block.first_index == after * HR_SAMPLER_BLOCK_SAMPLES,
+          "sample index runs on across the gap");
+}
+
+static void check_index_to_ms(void)
+{
+    hr_sampler_init(RAW_RATE_HZ, OUT_RATE_HZ);
+    bool ok = true;
+    for (uint32_t s = 0; s <= 3600; s++) {
+        if (hr_sampler_index_to_ms(s * OUT_RATE_HZ) != s * 1000) {
+            ok = false;
+        }
+    }
+    check(ok && hr_sampler_index_to_ms(OUT_RATE_HZ / 2) == 500, "sample index to ms");
+}
+
+static void bench(void)
+{
+    uint32_t decimation = hr_sampler_init(RAW_RATE_HZ, OUT_RATE_HZ);
+
+    hr_synth_t synth;
+    synth_init(&synth);
+    std::vector<uint16_t> raw((size_t)BENCH_S * RAW_RATE_HZ);
+    hr_synth_fill(&synth, raw.data(), raw.size());
+
+    hr_block_t block;
+    auto t0 = std::chrono::steady_clock::now();
+    for (size_t pos = 0; pos + CHUNK_SAMPLES <= raw.size(); pos += CHUNK_SAMPLES) {
+        hr_sampler_push_raw(&raw[pos], CHUNK_SAMPLES);
+        while (hr_sampler_pop_block(&block)) {
+        }
+    }
+    double ns = std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now() - t0).count();
+
+    printf("ns/raw sample %.2f, ns/output sample %.1f (%ux decimation)\n",
+           ns / raw.size(), ns * decimation / raw.size(), (unsigned)decimation);
+}
+
+int main(void)
+{
+    check_stream();
+    check_overrun();
+    check_index_to_ms();
+    bench();
+
+    return failures ? 1 : 0;
+}
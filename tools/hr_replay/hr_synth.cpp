@@ -0,0 +1,94 @@
+#include "hr_synth.h"
+
+#include <math.h>
+
+#define SYNTH_PI 3.14159265f
+
+static uint32_t xorshift32(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Uniform integer in [-range, +range]
+static int32_t rand_range(uint32_t *state, uint32_t range)
+{
+    if (range == 0) {
+        return 0;
+    }
+    return (int32_t)(xorshift32(state) % (2 * range + 1)) - (int32_t)range;
+}
+
+static void next_beat(hr_synth_t *s)
+{
+    uint32_t bpm = s->cfg.bpm ? s->cfg.bpm : 60;
+    int32_t rr_ms = (int32_t)(60000 / bpm) + rand_range(&s->rng, s->cfg.rr_jitter_ms);
+    if (rr_ms < 200) {
+        rr_ms = 200;
+    }
+
+    s->beat_start = s->index;
+    s->beat_len = (uint32_t)(((uint64_t)rr_ms * s->cfg.rate_hz) / 1000);
+    if (s->beat_len == 0) {
+        s->beat_len = 1;
+    }
+    s->beats++;
+}
+
+void hr_synth_init(hr_synth_t *s, const hr_synth_config_t *cfg)
+{
+    s->cfg = *cfg;
+    if (s->cfg.rate_hz == 0) {
+        s->cfg.rate_hz = 500;
+    }
+    s->rng = cfg->seed ? cfg->seed : 0x2545F491u;
+    s->index = 0;
+    s->beats = 0;
+    next_beat(s);
+}
+
+size_t hr_synth_fill(hr_synth_t *s, uint16_t *raw, size_t count)
+{
+    const float rate = (float)s->cfg.rate_hz;
+
+    for (size_t i = 0; i < count; i++) {
+        if (s->index - s->beat_start >= s->beat_len) {
+            next_beat(s);
+        }
+
+        // Pulse shape as a function of phase within the beat
+        float phase = (float)(s->index - s->beat_start) / (float)s->beat_len;
+        float sys = (phase - 0.15f) / 0.06f;
+        float dia = (phase - 0.42f) / 0.09f;
+        float pulse = expf(-0.5f * sys * sys) + 0.35f * expf(-0.5f * dia * dia);
+
+        float wander = 0.0f;
+        if (s->cfg.drift) {
+            wander = (float)s->cfg.drift * sinf(2.0f * SYNTH_PI * 0.2f * (float)s->index / rate);
+        }
+
+        float motion = 0.0f;
+        if (s->cfg.motion && (s->index % (8 * s->cfg.rate_hz)) >= 6 * s->cfg.rate_hz) {
+            float t = (float)s->index / rate;
+            motion = (float)s->cfg.motion * (0.7f * sinf(2.0f * SYNTH_PI * 1.3f * t) +
+                                             0.3f * sinf(2.0f * SYNTH_PI * 2.9f * t));
+        }
+
+        int32_t v = (int32_t)s->cfg.baseline
+                  + (int32_t)(pulse * (float)s->cfg.amplitude + wander + motion)
+                  + rand_range(&s->rng, s->cfg.noise);
+
+        if (v < 0) {
+            v = 0;
+        } else if (v > 4095) {
+            v = 4095;
+        }
+        raw[i] = (uint16_t)v;
+        s->index++;
+    }
+    return count;
+}
@@ -0,0 +1,52 @@
+#ifndef HR_SYNTH_H
+#define HR_SYNTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Synthetic pulse-sensor source.
+ *
+ * Produces raw 12-bit ADC codes shaped like a finger PPG pulse (systolic
+ * peak plus dicrotic wave) with configurable rate, RR jitter, noise and
+ * baseline wander. Optional motion bursts (2 s of 1.3 + 2.9 Hz sway,
+ * every 8 s) overlap the heart-rate band the way arm swing does.
+ * Used in place of the DMA driver by the host checks; it lives under
+ * tools/ so the firmware build does not pick it up.
+ */
+
+typedef struct {
+    uint32_t rate_hz;        /* Sample rate of generated codes */
+    uint16_t bpm;            /* Mean heart rate */
+    uint16_t rr_jitter_ms;   /* Max beat-to-beat RR variation (+/-) */
+    uint16_t baseline;       /* DC level in raw codes */
+    uint16_t amplitude;      /* Systolic peak height in raw codes */
+    uint16_t noise;          /* Peak uniform noise in raw codes */
+    uint16_t drift;          /* Baseline wander (0.2 Hz) in raw codes */
+    uint16_t motion;         /* Motion artifact bursts in raw codes, 0 off */
+    uint32_t seed;           /* PRNG seed, 0 picks a fixed default */
+} hr_synth_config_t;
+
+typedef struct {
+    hr_synth_config_t cfg;
+    uint32_t index;          /* Samples generated so far */
+    uint32_t beat_start;     /* Sample index of the current beat onset */
+    uint32_t beat_len;       /* Length of the current beat in samples */
+    uint32_t beats;          /* Beat onsets generated so far */
+    uint32_t rng;
+} hr_synth_t;
+
+void hr_synth_init(hr_synth_t *synth, const hr_synth_config_t *cfg);
+
+/* Generate the next count samples; returns count */
+size_t hr_synth_fill(hr_synth_t *synth, uint16_t *raw, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HR_SYNTH_H */
@@ -0,0 +1,1079 @@
+/*
+ * Host checks for the workout message tokenizer (src/workout_event.cpp),
+ * the binary framing (src/workout_codec.cpp) and BLE fragmentation
+ * (src/ble_frag.cpp).
+ *
+ * Passes, all on fixed seeds so a failure reproduces:
+ *
+ *   cases     hand-written messages with their expected decode, including
+ *             the ones the old strstr helpers got wrong ("lap" text inside
+ *             a string value, keys nested in unknown objects, a "cmd"
+ *             that only appears inside another value)
+ *   roundtrip random events serialised with shuffled key order, random
+ *             whitespace, escapes, fractions, out-of-range numbers and
+ *             decoy keys; the decode must equal the event exactly
+ *   mutate    the same messages with bytes flipped, dropped, inserted or
+ *             the tail cut off, parsed from a buffer of exactly their
+ *             length; the decode must stay in bounds and NUL-terminated,
+ *             and a message cut before its closing brace must be rejected
+ *   frames    random events encoded and decoded again must come back
+ *             exactly, and must match what their JSON rendering parses
+ *             to; hr_done likewise
+ *   framemut  mutated and truncated frames from exact-size buffers; a
+ *             short frame must be rejected
+ *   frag      random messages up to twice the reassembly buffer, cut at
+ *             random ATT payload sizes and fed through one long-lived
+ *             reassembler; some lose a fragment. Intact ones must come
+ *             back byte for byte, damaged and oversize ones never, every
+ *             loss must be counted as missing, and the next message must
+ *             get through
+ *   peers     random messages from up to PEERS_MAX trackers, each at its
+ *             own ATT payload size, with their packets interleaved at
+ *             random as one gateway receives them; each tracker's
+ *             reassembler must give back exactly its own messages, in
+ *             order, and each must parse to the event it was made from
+ *   bench     ns per message for workout_event_parse against the legacy
+ *             per-key helpers doing the same extraction as the old
+ *             process_workout_event, then bytes on air and decode time
+ *             for JSON against binary frames, then notifications per
+ *             second through the receive path as 1, 2 and 4 trackers
+ *             interleave
+ *
+ * Build with sanitizers (make workout_check does) so the mutate pass
+ * catches any read past the buffer.
+ *
+ * Usage: workout_fuzz [--iters N] [--seed N] [--bench]
+ * Exits non-zero on the first failing check.
+ */
+
+#include "ble_frag.h"
+#include "workout_codec.h"
+#include "workout_event.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define DEFAULT_ITERS  20000
+#define BENCH_ROUNDS   20000
+
+static uint32_t rng_state = 1;
+
+static uint32_t rnd(void)
+{
+    // xorshift32
+    uint32_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng_state = x;
+    return x;
+}
+
+static uint32_t rnd_below(uint32_t n)
+{
+    return rnd() % n;
+}
+
+/* Legacy helpers, as ble_client.cpp had them before the tokenizer */
+
+static const char *mem_find(const char *hay, size_t hay_len, const char *needle)
+{
+    size_t n = strlen(needle);
+    if (n == 0 || n > hay_len)
+        return NULL;
+
+    for (size_t i = 0; i + n <= hay_len; i++) {
+        if (hay[i] == needle[0] && memcmp(hay + i, needle, n) == 0)
+            return hay + i;
+    }
+    return NULL;
+}
+
+static const char *json_find_value(const char *json, size_t len, const char *key, bool quoted)
+{
+    char search[64];
+    snprintf(search, sizeof(search), quoted ? "\"%s\":\"" : "\"%s\":", key);
+
+    const char *start = mem_find(json, len, search);
+    if (start == NULL)
+        return NULL;
+
+    return start + strlen(search);
+}
+
+static bool json_get_string(const char *json, size_t json_len, const char *key,
+                            char *out, size_t out_len)
+{
+    const char *start = json_find_value(json, json_len, key, true);
+    if (start == NULL)
+        return false;
+
+    const char *end = (const char *)memchr(start, '"', json + json_len - start);
+    if (end == NULL)
+        return false;
+
+    size_t len = end - start;
+    if (len >= out_len)
+        len = out_len - 1;
+
+    memcpy(out, start, len);
+    out[len] = '\0';
+    return true;
+}
+
+static bool json_get_ulong(const char *json, size_t json_len, const char *key, unsigned long *out)
+{
+    const char *p = json_find_value(json, json_len, key, false);
+    if (p == NULL)
+        return false;
+
+    const char *end = json + json_len;
+    while (p < end && *p == ' ')
+        p++;
+
+    unsigned long v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (unsigned long)(*p - '0');
+        p++;
+    }
+    *out = v;
+    return true;
+}
+
+static bool json_get_int(const char *json, size_t json_len, const char *key, int *out)
+{
+    const char *p = json_find_value(json, json_len, key, false);
+    if (p == NULL)
+        return false;
+
+    const char *end = json + json_len;
+    while (p < end && *p == ' ')
+        p++;
+
+    bool neg = p < end && *p == '-';
+    if (neg)
+        p++;
+
+    int v = 0;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (*p - '0');
+        p++;
+    }
+    *out = neg ? -v : v;
+    return true;
+}
+
+// The lookups the old process_workout_event made for each message
+static int legacy_extract(const char *json, size_t len)
+{
+    char event_type[16] = {0};
+    char text[16] = {0};
+    int a = 0, b = 0;
+    unsigned long x = 0, y = 0;
+
+    if (mem_find(json, len, "\"cmd\":\"hr_req\"")) {
+        json_get_int(json, len, "lap", &a);
+        json_get_int(json, len, "window_ms", &b);
+        return a + b;
+    }
+    if (!json_get_string(json, len, "event", event_type, sizeof(event_type)))
+        return -1;
+
+    if (strcmp(event_type, "start") == 0) {
+        json_get_string(json, len, "mode", text, sizeof(text));
+        json_get_int(json, len, "laps", &a);
+    } else if (strcmp(event_type, "lap") == 0) {
+        json_get_int(json, len, "lap", &a);
+        json_get_ulong(json, len, "lap_ms", &x);
+        json_get_ulong(json, len, "split_ms", &y);
+    } else if (strcmp(event_type, "done") == 0 || strcmp(event_type, "stop") == 0) {
+        json_get_int(json, len, "laps", &a);
+        json_get_ulong(json, len, "total_ms", &x);
+    } else if (strcmp(event_type, "status") == 0) {
+        json_get_string(json, len, "state", text, sizeof(text));
+        json_get_int(json, len, "lap", &a);
+        json_get_ulong(json, len, "elapsed_ms", &x);
+    }
+    return a + b + (int)x + (int)y + text[0];
+}
+
+/* Hand-written cases */
+
+struct case_t {
+    const char *json;
+    bool ok;
+    workout_event_type_t type;
+    uint32_t fields;
+    int32_t lap;
+    int32_t laps;
+    uint32_t ms;            // lap_ms, total_ms, elapsed_ms or window_ms
+    const char *text;       // mode, state or name
+};
+
+static const case_t cases[] = {
+    { "{\"event\":\"lap\",\"lap\":3,\"lap_ms\":61234,\"split_ms\":183702}", true,
+      WORKOUT_EVT_LAP, WORKOUT_HAS_LAP | WORKOUT_HAS_LAP_MS | WORKOUT_HAS_SPLIT_MS,
+      3, 0, 61234, "lap" },
+    { "{\"cmd\":\"hr_req\",\"lap\":2,\"window_ms\":10000}", true,
+      WORKOUT_EVT_HR_REQ, WORKOUT_HAS_LAP | WORKOUT_HAS_WINDOW_MS, 2, 0, 10000, "hr_req" },
+    { " {\"event\" : \"start\" , \"mode\":\"laps\",\"laps\":8}\n", true,
+      WORKOUT_EVT_START, WORKOUT_HAS_MODE | WORKOUT_HAS_LAPS, 0, 8, 0, "laps" },
+    { "{\"event\":\"done\",\"laps\":8,\"total_ms\":480000}", true,
+      WORKOUT_EVT_DONE, WORKOUT_HAS_LAPS | WORKOUT_HAS_TOTAL_MS, 0, 8, 480000, "done" },
+    { "{\"event\":\"status\",\"state\":\"running\",\"lap\":4,\"elapsed_ms\":2500}", true,
+      WORKOUT_EVT_STATUS, WORKOUT_HAS_STATE | WORKOUT_HAS_LAP | WORKOUT_HAS_ELAPSED_MS,
+      4, 0, 2500, "running" },
+    // Trailing C string terminator from the MAX
+    { "{\"event\":\"stop\",\"laps\":2,\"total_ms\":90000}\0", true,
+      WORKOUT_EVT_STOP, WORKOUT_HAS_LAPS | WORKOUT_HAS_TOTAL_MS, 0, 2, 90000, "stop" },
+    // "lap" inside a string value and inside a nested object are not the key
+    { "{\"note\":\"\\\"lap\\\":99\",\"meta\":{\"lap\":77},\"event\":\"lap\",\"lap\":5}", true,
+      WORKOUT_EVT_LAP, WORKOUT_HAS_LAP, 5, 0, 0, "lap" },
+    // hr_req only mentioned inside another value
+    { "{\"event\":\"status\",\"note\":\"\\\"cmd\\\":\\\"hr_req\\\"\"}", true,
+      WORKOUT_EVT_STATUS, 0, 0, 0, 0, "status" },
+    // "laps" and "lap_ms" do not satisfy "lap"
+    { "{\"event\":\"lap\",\"laps\":9,\"lap_ms\":1}", true,
+      WORKOUT_EVT_LAP, WORKOUT_HAS_LAPS | WORKOUT_HAS_LAP_MS, 0, 9, 1, "lap" },
+    // Wrong type leaves the field unset; saturation; unknown event
+    { "{\"event\":\"sprint\",\"lap\":\"3\",\"lap_ms\":-5,\"laps\":99999999999}", true,
+      WORKOUT_EVT_UNKNOWN, WORKOUT_HAS_LAP_MS | WORKOUT_HAS_LAPS, 0, INT32_MAX, 0, "sprint" },
+    { "{\"cmd\":\"caps\",\"codec\":\"bin1\"}", true,
+      WORKOUT_EVT_CAPS, WORKOUT_HAS_CODEC, 0, 0, 0, "caps" },
+    { "{\"lap\":1}", true, WORKOUT_EVT_NONE, WORKOUT_HAS_LAP, 1, 0, 0, "" },
+    { "{}", true, WORKOUT_EVT_NONE, 0, 0, 0, 0, "" },
+    { "{\"event\":\"lap\",\"lap\":3", false, WORKOUT_EVT_NONE, 0, 0, 0, 0, "" },
+    // An escaped NUL must not shorten a key or value into a match
+    { "{\"event\":\"lap\",\"lap\\u0000x\":5}", false, WORKOUT_EVT_NONE, 0, 0, 0, 0, "" },
+    { "{\"event\":\"lap\\u0000\"}", false, WORKOUT_EVT_NONE, 0, 0, 0, 0, "" },
+    { "{\"event\":\"lap\",}", false, WORKOUT_EVT_NONE, 0, 0, 0, 0, "" },
+    { "{\"event\":\"lap\"} x", false, WORKOUT_EVT_NONE, 0, 0, 0, 0, "" },
+    { "[1,2]", false, WORKOUT_EVT_NONE, 0, 0, 0, 0, "" },
+    { "", false, WORKOUT_EVT_NONE, 0, 0, 0, 0, "" },
+};
+
+static bool run_case(const case_t *c, size_t len)
+{
+    workout_event_t ev;
+    bool ok = workout_event_parse(c->json, len, &ev);
+
+    if (ok != c->ok)
+        return false;
+    if (!ok)
+        return true;
+    if (ev.type != c->type || ev.fields != c->fields || ev.lap != c->lap || ev.laps != c->laps)
+        return false;
+
+    uint32_t ms = ev.lap_ms | ev.total_ms | ev.elapsed_ms | ev.window_ms;
+    const char *text = ev.mode[0] ? ev.mode : ev.state[0] ? ev.state : ev.name;
+    return ms == c->ms && strcmp(text, c->text) == 0;
+}
+
+static int check_cases(void)
+{
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const case_t *c = &cases[i];
+        size_t len = strlen(c->json);
+        if (c->ok && c->type == WORKOUT_EVT_STOP)
+            len++;      // Include the embedded terminator
+
+        if (!run_case(c, len)) {
+            printf("case %zu FAIL: %s\n", i, c->json);
+            failures++;
+        }
+    }
+    printf("cases      %5zu  %s\n", sizeof(cases) / sizeof(cases[0]), failures ? "FAIL" : "ok");
+    return failures;
+}
+
+/* Random messages */
+
+static const char *const decoy_keys[] = {
+    "lap_count", "laps_total", "Lap", "lap ", "note", "meta", "list", "flag", "x",
+    "a_key_much_longer_than_any_field_name",
+};
+
+static void put_ws(std::string &s)
+{
+    static const char ws[] = " \t\r\n";
+    uint32_t n = rnd_below(4) == 0 ? rnd_below(3) : 0;
+    while (n--)
+        s += ws[rnd_below(4)];
+}
+
+static void put_string(std::string &s, const std::string &text)
+{
+    s += '"';
+    for (unsigned char ch : text) {
+        char esc[8];
+        if (ch == '"' || ch == '\\') {
+            s += '\\';
+            s += (char)ch;
+        } else if (ch < 0x20 || rnd_below(16) == 0) {
+            snprintf(esc, sizeof(esc), "\\u%04x", ch);
+            s += esc;
+        } else {
+            s += (char)ch;
+        }
+    }
+    s += '"';
+}
+
+static std::string random_text(uint32_t max_len)
+{
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz_0123456789 \"\\:{},[]\n";
+    std::string t;
+    uint32_t n = rnd_below(max_len + 1);
+    for (uint32_t i = 0; i < n; i++)
+        t += alphabet[rnd_below(sizeof(alphabet) - 1)];
+    return t;
+}
+
+static void copy_text(char *dst, const std::string &src)
+{
+    size_t n = src.size() < WORKOUT_EVENT_STR_LEN - 1 ? src.size() : WORKOUT_EVENT_STR_LEN - 1;
+    memcpy(dst, src.data(), n);
+    dst[n] = '\0';
+}
+
+// A number whose decode is v, sometimes written out of range or with a fraction
+static void put_number(std::string &s, int64_t v, bool is_signed, int32_t *i_out, uint32_t *u_out)
+{
+    char buf[32];
+
+    if (rnd_below(10) == 0)
+        v = (rnd_below(2) ? 1 : -1) * (int64_t)(rnd() % 100000) * 1000000LL;
+
+    snprintf(buf, sizeof(buf), "%lld", (long long)v);
+    s += buf;
+    if (rnd_below(8) == 0) {
+        snprintf(buf, sizeof(buf), ".%u", rnd_below(1000));
+        s += buf;
+    }
+
+    if (is_signed) {
+        *i_out = v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : (int32_t)v;
+    } else {
+        *u_out = v > (int64_t)UINT32_MAX ? UINT32_MAX : v < 0 ? 0 : (uint32_t)v;
+    }
+}
+
+static void put_decoy_value(std::string &s, int depth)
+{
+    switch (rnd_below(depth < 3 ? 7 : 4)) {
+    case 0: s += "true"; break;
+    case 1: s += "null"; break;
+    case 2: put_string(s, rnd_below(2) ? "\"lap\":99,\"cmd\":\"hr_req\"" : random_text(24)); break;
+    case 3: s += "-12.5e+3"; break;
+    case 4:
+        s += "{\"lap\":";
+        put_ws(s);
+        s += "77,\"event\":\"stop\",\"cmd\":\"hr_req\",\"inner\":";
+        put_decoy_value(s, depth + 1);
+        s += '}';
+        break;
+    case 5:
+        s += '[';
+        put_decoy_value(s, depth + 1);
+        s += ",\"lap\",";
+        put_decoy_value(s, depth + 1);
+        s += ']';
+        break;
+    default:
+        s += "{}";
+        break;
+    }
+}
+
+// Build a random message and the decode it must produce
+static std::string random_message(workout_event_t *exp)
+{
+    static const char *const events[] = { "start", "lap", "done", "stop", "status" };
+    static const workout_event_type_t types[] = {
+        WORKOUT_EVT_START, WORKOUT_EVT_LAP, WORKOUT_EVT_DONE, WORKOUT_EVT_STOP, WORKOUT_EVT_STATUS
+    };
+    std::vector<std::string> members;
+    std::string m;
+
+    memset(exp, 0, sizeof(*exp));
+
+    uint32_t pick = rnd_below(8);
+    if (pick < 5) {
+        exp->type = types[pick];
+        copy_text(exp->name, events[pick]);
+        m = "\"event\":";
+        put_ws(m);
+        put_string(m, events[pick]);
+        members.push_back(m);
+    } else if (pick == 5) {
+        exp->type = WORKOUT_EVT_HR_REQ;
+        copy_text(exp->name, "hr_req");
+        members.push_back("\"cmd\":\"hr_req\"");
+    } else if (pick == 6) {
+        std::string name = "x" + random_text(20);
+        exp->type = WORKOUT_EVT_UNKNOWN;
+        copy_text(exp->name, name);
+        m = "\"event\":";
+        put_string(m, name);
+        members.push_back(m);
+    }
+
+    struct { const char *key; uint32_t bit; bool is_signed; int32_t *i; uint32_t *u; } nums[] = {
+        { "lap",        WORKOUT_HAS_LAP,        true,  &exp->lap,  NULL },
+        { "laps",       WORKOUT_HAS_LAPS,       true,  &exp->laps, NULL },
+        { "lap_ms",     WORKOUT_HAS_LAP_MS,     false, NULL, &exp->lap_ms },
+        { "split_ms",   WORKOUT_HAS_SPLIT_MS,   false, NULL, &exp->split_ms },
+        { "total_ms",   WORKOUT_HAS_TOTAL_MS,   false, NULL, &exp->total_ms },
+        { "elapsed_ms", WORKOUT_HAS_ELAPSED_MS, false, NULL, &exp->elapsed_ms },
+        { "window_ms",  WORKOUT_HAS_WINDOW_MS,  false, NULL, &exp->window_ms },
+    };
+    for (auto &n : nums) {
+        if (rnd_below(2))
+            continue;
+        m = "\"";
+        m += n.key;
+        m += "\":";
+        put_ws(m);
+        int64_t v = rnd_below(4) == 0 ? -(int64_t)rnd_below(100) : (int64_t)rnd_below(4000000);
+        put_number(m, v, n.is_signed, n.i, n.u);
+        exp->fields |= n.bit;
+        members.push_back(m);
+    }
+
+    struct { const char *key; uint32_t bit; char *out; } strs[] = {
+        { "mode",  WORKOUT_HAS_MODE,  exp->mode },
+        { "state", WORKOUT_HAS_STATE, exp->state },
+    };
+    for (auto &st : strs) {
+        if (rnd_below(2))
+            continue;
+        std::string text = random_text(20);
+        m = "\"";
+        m += st.key;
+        m += "\":";
+        put_string(m, text);
+        copy_text(st.out, text);
+        exp->fields |= st.bit;
+        members.push_back(m);
+    }
+
+    uint32_t decoys = rnd_below(4);
+    while (decoys--) {
+        m.clear();
+        put_string(m, decoy_keys[rnd_below(sizeof(decoy_keys) / sizeof(decoy_keys[0]))]);
+        m += ':';
+        put_ws(m);
+        put_decoy_value(m, 0);
+        members.push_back(m);
+    }
+
+    // Shuffle so no key order is assumed
+    for (size_t i = members.size(); i > 1; i--)
+        std::swap(members[i - 1], members[rnd_below((uint32_t)i)]);
+
+    std::string s;
+    put_ws(s);
+    s += '{';
+    for (size_t i = 0; i < members.size(); i++) {
+        if (i)
+            s += ',';
+        put_ws(s);
+        s += members[i];
+        put_ws(s);
+    }
+    s += '}';
+    put_ws(s);
+    return s;
+}
+
+// Parse from an exact-size heap copy so any overread trips the sanitizer
+static bool parse_exact(const std::string &s, workout_event_t *ev)
+{
+    char *buf = (char *)malloc(s.size() ? s.size() : 1);
+    memcpy(buf, s.data(), s.size());
+    bool ok = workout_event_parse(buf, s.size(), ev);
+    free(buf);
+    return ok;
+}
+
+static bool terminated(const workout_event_t *ev)
+{
+    return memchr(ev->name, 0, sizeof(ev->name)) && memchr(ev->mode, 0, sizeof(ev->mode)) &&
+           memchr(ev->state, 0, sizeof(ev->state)) && memchr(ev->codec, 0, sizeof(ev->codec));
+}
+
+static int check_roundtrip(uint32_t iters)
+{
+    for (uint32_t i = 0; i < iters; i++) {
+        workout_event_t exp, got;
+        std::string s = random_message(&exp);
+
+        if (!parse_exact(s, &got) || memcmp(&exp, &got, sizeof(exp)) != 0) {
+            printf("roundtrip FAIL at %u: %s\n", i, s.c_str());
+            return 1;
+        }
+    }
+    printf("roundtrip  %5u  ok\n", iters);
+    return 0;
+}
+
+static int check_mutate(uint32_t iters)
+{
+    uint32_t accepted = 0;
+
+    for (uint32_t i = 0; i < iters; i++) {
+        workout_event_t exp, got;
+        std::string s = random_message(&exp);
+        size_t close = s.rfind('}');
+        bool must_fail = false;
+
+        switch (rnd_below(4)) {
+        case 0:
+            s[rnd_below((uint32_t)s.size())] = (char)rnd();
+            break;
+        case 1:
+            s.erase(rnd_below((uint32_t)s.size()), 1);
+            break;
+        case 2:
+            s.insert(rnd_below((uint32_t)s.size() + 1), 1, (char)rnd());
+            break;
+        default:
+            s.resize(rnd_below((uint32_t)close + 1));
+            must_fail = true;
+            break;
+        }
+
+        bool ok = parse_exact(s, &got);
+        if (!terminated(&got) || (must_fail && ok)) {
+            printf("mutate FAIL at %u: %s\n", i, s.c_str());
+            return 1;
+        }
+        accepted += ok;
+    }
+    printf("mutate     %5u  ok (%u still valid)\n", iters, accepted);
+    return 0;
+}
+
+/* Binary frames */
+
+// A random event of a type that has a frame, with every value in range
+static void random_frame_event(workout_event_t *ev)
+{
+    static const workout_event_type_t types[] = {
+        WORKOUT_EVT_START, WORKOUT_EVT_LAP, WORKOUT_EVT_DONE, WORKOUT_EVT_STOP,
+        WORKOUT_EVT_STATUS, WORKOUT_EVT_HR_REQ
+    };
+    static const char *const names[] = { "start", "lap", "done", "stop", "status", "hr_req" };
+    uint32_t pick = rnd_below(6);
+
+    memset(ev, 0, sizeof(*ev));
+    ev->type = types[pick];
+    copy_text(ev->name, names[pick]);
+
+    switch (ev->type) {
+    case WORKOUT_EVT_START:
+        ev->laps = (int32_t)rnd_below(65536);
+        copy_text(ev->mode, random_text(20));
+        ev->fields = WORKOUT_HAS_LAPS | WORKOUT_HAS_MODE;
+        break;
+    case WORKOUT_EVT_LAP:
+        ev->lap = (int32_t)rnd_below(65536);
+        ev->lap_ms = rnd();
+        ev->split_ms = rnd();
+        ev->fields = WORKOUT_HAS_LAP | WORKOUT_HAS_LAP_MS | WORKOUT_HAS_SPLIT_MS;
+        break;
+    case WORKOUT_EVT_DONE:
+    case WORKOUT_EVT_STOP:
+        ev->laps = (int32_t)rnd_below(65536);
+        ev->total_ms = rnd();
+        ev->fields = WORKOUT_HAS_LAPS | WORKOUT_HAS_TOTAL_MS;
+        break;
+    case WORKOUT_EVT_STATUS:
+        ev->lap = (int32_t)rnd_below(65536);
+        ev->elapsed_ms = rnd();
+        copy_text(ev->state, random_text(20));
+        ev->fields = WORKOUT_HAS_LAP | WORKOUT_HAS_ELAPSED_MS | WORKOUT_HAS_STATE;
+        break;
+    default:
+        ev->lap = (int32_t)rnd_below(65536);
+        ev->window_ms = rnd();
+        ev->fields = WORKOUT_HAS_LAP | WORKOUT_HAS_WINDOW_MS;
+        break;
+    }
+}
+
+static void random_hr_done(workout_hr_done_t *hr)
+{
+    memset(hr, 0, sizeof(*hr));
+    hr->lap = (uint16_t)rnd();
+    hr->bpm = (uint16_t)rnd_below(256);
+    hr->min_bpm = (uint16_t)rnd_below(256);
+    hr->max_bpm = (uint16_t)rnd_below(256);
+    hr->mean_bpm = (uint16_t)rnd_below(256);
+    hr->median_bpm = (uint16_t)rnd_below(256);
+    hr->beats = (uint16_t)rnd();
+    hr->flagged = (uint16_t)rnd();
+    hr->quality = (uint8_t)rnd_below(101);
+    hr->window_ms = rnd_below(65536);
+    hr->live = rnd_below(2);
+}
+
+static bool decode_exact(const uint8_t *frame, size_t len, workout_event_t *ev)
+{
+    uint8_t *buf = (uint8_t *)malloc(len ? len : 1);
+    memcpy(buf, frame, len);
+    bool ok = workout_codec_decode(buf, len, ev);
+    free(buf);
+    return ok;
+}
+
+static int check_frames(uint32_t iters)
+{
+    for (uint32_t i = 0; i < iters; i++) {
+        workout_event_t exp, got, via_json;
+        uint8_t frame[WORKOUT_CODEC_MAX_FRAME];
+        char json[256];
+
+        random_frame_event(&exp);
+        size_t len = workout_codec_encode(&exp, frame, sizeof(frame));
+        int jlen = workout_codec_event_json(&exp, json, sizeof(json));
+
+        if (len == 0 || !workout_codec_is_frame(frame, len) ||
+            !decode_exact(frame, len, &got) || memcmp(&exp, &got, sizeof(exp)) != 0 ||
+            jlen <= 0 || jlen >= (int)sizeof(json) ||
+            !workout_event_parse(json, (size_t)jlen, &via_json) ||
+            memcmp(&exp, &via_json, sizeof(exp)) != 0) {
+            printf("frames FAIL at %u: %s\n", i, json);
+            return 1;
+        }
+
+        workout_hr_done_t hr, hr_got;
+        random_hr_done(&hr);
+        len = workout_codec_encode_hr_done(&hr, frame, sizeof(frame));
+        if (len == 0 || !workout_codec_decode_hr_done(frame, len, &hr_got) ||
+            memcmp(&hr, &hr_got, sizeof(hr)) != 0) {
+            printf("frames FAIL at %u: hr_done lap %u\n", i, hr.lap);
+            return 1;
+        }
+    }
+    printf("frames     %5u  ok\n", iters);
+    return 0;
+}
+
+static int check_frame_mutate(uint32_t iters)
+{
+    uint32_t accepted = 0;
+
+    for (uint32_t i = 0; i < iters; i++) {
+        workout_event_t ev, got;
+        uint8_t frame[WORKOUT_CODEC_MAX_FRAME + 1];
+
+        random_frame_event(&ev);
+        size_t len = workout_codec_encode(&ev, frame, WORKOUT_CODEC_MAX_FRAME);
+        bool must_fail = false;
+
+        switch (rnd_below(3)) {
+        case 0:
+            frame[rnd_below((uint32_t)len)] = (uint8_t)rnd();
+            break;
+        case 1:
+            frame[len++] = (uint8_t)rnd();
+            must_fail = true;
+            break;
+        default:
+            len = rnd_below((uint32_t)len);
+            must_fail = true;
+            break;
+        }
+
+        bool ok = decode_exact(frame, len, &got);
+        if (!terminated(&got) || (must_fail && ok)) {
+            printf("framemut FAIL at %u\n", i);
+            return 1;
+        }
+        accepted += ok;
+    }
+    printf("framemut   %5u  ok (%u still valid)\n", iters, accepted);
+    return 0;
+}
+
+/* Fragmentation */
+
+#define FRAG_BUF_LEN 2048
+
+static std::vector<std::vector<uint8_t>> fragment(ble_frag_tx_t *tx, const std::vector<uint8_t> &msg,
+                                                  size_t payload)
+{
+    std::vector<std::vector<uint8_t>> frags;
+    std::vector<uint8_t> out(payload);
+    size_t offset = 0;
+    size_t n;
+
+    while ((n = ble_frag_tx_next(tx, msg.data(), msg.size(), &offset, out.data(), payload)) > 0)
+        frags.push_back(std::vector<uint8_t>(out.begin(), out.begin() + n));
+    return frags;
+}
+
+// Feed each fragment from an exact-size copy; how many messages came out
+static uint32_t feed(ble_frag_rx_t *rx, const std::vector<std::vector<uint8_t>> &frags,
+                     const std::vector<uint8_t> &expect, bool *match)
+{
+    uint32_t delivered = 0;
+
+    *match = false;
+    for (const std::vector<uint8_t> &f : frags) {
+        const uint8_t *msg;
+        size_t msg_len;
+        uint8_t *buf = (uint8_t *)malloc(f.size());
+        memcpy(buf, f.data(), f.size());
+        if (ble_frag_rx_push(rx, buf, f.size(), &msg, &msg_len)) {
+            delivered++;
+            *match = msg_len == expect.size() && memcmp(msg, expect.data(), msg_len) == 0;
+        }
+        free(buf);
+    }
+    return delivered;
+}
+
+static int check_frag(uint32_t iters)
+{
+    std::vector<uint8_t> buf(FRAG_BUF_LEN);
+    ble_frag_rx_t rx;
+    ble_frag_tx_t tx = {};
+    uint32_t lost = 0, oversize = 0;
+
+    ble_frag_rx_init(&rx, buf.data(), buf.size());
+
+    for (uint32_t i = 0; i < iters; i++) {
+        size_t payload = BLE_FRAG_MIN_PAYLOAD + rnd_below(225);
+        size_t len = rnd_below(8) == 0 ? FRAG_BUF_LEN + 1 + rnd_below(FRAG_BUF_LEN)
+                                       : payload + 1 + rnd_below(FRAG_BUF_LEN - payload);
+        std::vector<uint8_t> msg(len);
+        for (uint8_t &b : msg)
+            b = (uint8_t)rnd();
+
+        std::vector<std::vector<uint8_t>> frags = fragment(&tx, msg, payload);
+        bool drop = frags.size() >= 2 && rnd_below(4) == 0;
+        uint32_t dropped = 0;
+        if (drop) {
+            dropped = rnd_below((uint32_t)frags.size());
+            frags.erase(frags.begin() + dropped);
+            lost++;
+        }
+        // Only the first fragment announces the length
+        oversize += len > FRAG_BUF_LEN && !(drop && dropped == 0);
+
+        bool match;
+        uint32_t delivered = feed(&rx, frags, msg, &match);
+        bool intact = !drop && len <= FRAG_BUF_LEN;
+        if (intact ? delivered != 1 || !match : delivered != 0) {
+            printf("frag FAIL at %u: %zu B at payload %zu, %s\n", i, len, payload,
+                   drop ? "dropped one" : "intact");
+            return 1;
+        }
+    }
+
+    // A loss at the very end only shows once the next fragment arrives
+    std::vector<uint8_t> tail(BLE_FRAG_MIN_PAYLOAD * 2, 'x');
+    bool match;
+    if (feed(&rx, fragment(&tx, tail, BLE_FRAG_MIN_PAYLOAD), tail, &match) != 1 || !match ||
+        rx.missing != lost || rx.oversize != oversize) {
+        printf("frag FAIL: %u missing of %u lost, %u of %u oversize\n",
+               rx.missing, lost, rx.oversize, oversize);
+        return 1;
+    }
+
+    printf("frag       %5u  ok (%u messages, %u fragments, %u missing, %u aborted)\n",
+           iters, rx.messages, rx.fragments, rx.missing, rx.aborted);
+    return 0;
+}
+
+/* Several trackers */
+
+#define PEERS_MAX 4
+
+typedef struct {
+    std::vector<uint8_t> buf;
+    ble_frag_rx_t rx;
+    ble_frag_tx_t tx;
+    size_t payload;
+    std::vector<std::vector<uint8_t>> packets;  // Not yet received
+    size_t next;
+    std::vector<std::string> sent;              // Messages in flight, oldest first
+    std::vector<workout_event_t> events;
+    uint32_t received;
+} peer_t;
+
+static void peer_init(peer_t *p, size_t payload)
+{
+    p->buf.assign(FRAG_BUF_LEN, 0);
+    ble_frag_rx_init(&p->rx, p->buf.data(), p->buf.size());
+    p->tx = ble_frag_tx_t();
+    p->payload = payload;
+    p->packets.clear();
+    p->next = 0;
+    p->sent.clear();
+    p->events.clear();
+    p->received = 0;
+}
+
+// Queue one message the way the MAX sends it: whole when it fits
+static void peer_send(peer_t *p, const std::string &msg)
+{
+    std::vector<uint8_t> bytes(msg.begin(), msg.end());
+    if (!ble_frag_needed(bytes.size(), p->payload)) {
+        p->packets.push_back(bytes);
+    } else {
+        for (std::vector<uint8_t> &f : fragment(&p->tx, bytes, p->payload))
+            p->packets.push_back(f);
+    }
+}
+
+// One notification as the gateway handles it: whole messages straight to
+// the parser, fragments through that tracker's reassembler. Returns true
+// when a message came out, in *msg / *msg_len.
+static bool peer_receive(peer_t *p, const uint8_t **msg, size_t *msg_len)
+{
+    const std::vector<uint8_t> &pkt = p->packets[p->next++];
+
+    if (!ble_frag_is_fragment(pkt.data(), pkt.size())) {
+        *msg = pkt.data();
+        *msg_len = pkt.size();
+        return true;
+    }
+    return ble_frag_rx_push(&p->rx, pkt.data(), pkt.size(), msg, msg_len);
+}
+
+static int check_peers(uint32_t iters)
+{
+    peer_t peers[PEERS_MAX];
+    uint32_t messages = 0;
+
+    for (int i = 0; i < PEERS_MAX; i++) {
+        peer_init(&peers[i], BLE_FRAG_MIN_PAYLOAD + rnd_below(225));
+        for (uint32_t m = 0; m < iters / PEERS_MAX; m++) {
+            workout_event_t exp;
+            std::string s = random_message(&exp);
+            peer_send(&peers[i], s);
+            peers[i].sent.push_back(s);
+            peers[i].events.push_back(exp);
+        }
+    }
+
+    for (;;) {
+        int live[PEERS_MAX];
+        int n = 0;
+        for (int i = 0; i < PEERS_MAX; i++) {
+            if (peers[i].next < peers[i].packets.size())
+                live[n++] = i;
+        }
+        if (n == 0)
+            break;
+
+        peer_t *p = &peers[live[rnd_below(n)]];
+        const uint8_t *msg;
+        size_t msg_len;
+        if (!peer_receive(p, &msg, &msg_len))
+            continue;
+
+        uint32_t k = p->received++;
+        workout_event_t got;
+        std::string s((const char *)msg, msg_len);
+        if (k >= p->sent.size() || s != p->sent[k] || !parse_exact(s, &got) ||
+            memcmp(&got, &p->events[k], sizeof(got)) != 0) {
+            printf("peers FAIL: tracker %d message %u at payload %zu\n",
+                   (int)(p - peers), k, p->payload);
+            return 1;
+        }
+        messages++;
+    }
+
+    for (int i = 0; i < PEERS_MAX; i++) {
+        if (peers[i].received != peers[i].sent.size() || peers[i].rx.missing != 0 ||
+            peers[i].rx.aborted != 0) {
+            printf("peers FAIL: tracker %d got %u of %zu, %u missing, %u aborted\n", i,
+                   peers[i].received, peers[i].sent.size(), peers[i].rx.missing,
+                   peers[i].rx.aborted);
+            return 1;
+        }
+    }
+
+    printf("peers      %5u  ok (%d trackers, payloads %zu/%zu/%zu/%zu)\n", messages, PEERS_MAX,
+           peers[0].payload, peers[1].payload, peers[2].payload, peers[3].payload);
+    return 0;
+}
+
+/* Bench */
+
+// Receive path for 1, 2 and 4 trackers sending the same mix, half at the
+// default MTU (so longer messages fragment) and half at a 247 byte MTU,
+// their notifications taken round robin
+static void bench_peers(const std::vector<std::string> &msgs)
+{
+    static const int counts[] = { 1, 2, 4 };
+    volatile int sink = 0;
+
+    for (int count : counts) {
+        peer_t peers[PEERS_MAX];
+        size_t notifications = 0;
+        uint32_t messages = 0;
+
+        for (int i = 0; i < count; i++) {
+            peer_init(&peers[i], i % 2 ? 244 : BLE_FRAG_MIN_PAYLOAD);
+            for (int r = 0; r < BENCH_ROUNDS / 10; r++) {
+                for (const std::string &m : msgs)
+                    peer_send(&peers[i], m);
+            }
+            notifications += peers[i].packets.size();
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (bool more = true; more;) {
+            more = false;
+            for (int i = 0; i < count; i++) {
+                peer_t *p = &peers[i];
+                if (p->next == p->packets.size())
+                    continue;
+                more = true;
+
+                const uint8_t *msg;
+                size_t msg_len;
+                if (peer_receive(p, &msg, &msg_len)) {
+                    workout_event_t ev;
+                    workout_event_parse((const char *)msg, msg_len, &ev);
+                    sink = sink + ev.lap;
+                    messages++;
+                }
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(t1 - t0).count();
+
+        printf("bench      %d tracker%s %8.0f k notifications/s  %8.0f k msgs/s\n",
+               count, count == 1 ? " " : "s", notifications / s / 1000, messages / s / 1000);
+    }
+}
+
+
+static void bench(void)
+{
+    std::vector<std::string> msgs;
+    static const char *const typical[] = {
+        "{\"event\":\"start\",\"mode\":\"laps\",\"laps\":8}",
+        "{\"event\":\"lap\",\"lap\":3,\"lap_ms\":61234,\"split_ms\":183702}",
+        "{\"cmd\":\"hr_req\",\"lap\":3,\"window_ms\":10000}",
+        "{\"event\":\"status\",\"state\":\"running\",\"lap\":4,\"elapsed_ms\":245000}",
+        "{\"event\":\"done\",\"laps\":8,\"total_ms\":480000}",
+    };
+    for (const char *m : typical)
+        msgs.push_back(m);
+
+    volatile int sink = 0;
+    double ns[2];
+
+    for (int pass = 0; pass < 2; pass++) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int r = 0; r < BENCH_ROUNDS; r++) {
+            for (const std::string &m : msgs) {
+                if (pass == 0) {
+                    sink = sink + legacy_extract(m.data(), m.size());
+                } else {
+                    workout_event_t ev;
+                    workout_event_parse(m.data(), m.size(), &ev);
+                    sink = sink + ev.lap;
+                }
+            }
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        ns[pass] = std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                   ((double)BENCH_ROUNDS * msgs.size());
+    }
+
+    printf("bench      legacy %7.1f ns/msg  tokenizer %7.1f ns/msg  (%.2fx)\n",
+           ns[0], ns[1], ns[0] / ns[1]);
+
+    // The same messages as binary frames
+    std::vector<std::vector<uint8_t>> frames;
+    size_t json_bytes = 0, frame_bytes = 0;
+    for (const std::string &m : msgs) {
+        workout_event_t ev;
+        uint8_t frame[WORKOUT_CODEC_MAX_FRAME];
+        workout_event_parse(m.data(), m.size(), &ev);
+        size_t len = workout_codec_encode(&ev, frame, sizeof(frame));
+        frames.push_back(std::vector<uint8_t>(frame, frame + len));
+        json_bytes += m.size();
+        frame_bytes += len;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int r = 0; r < BENCH_ROUNDS; r++) {
+        for (const std::vector<uint8_t> &f : frames) {
+            workout_event_t ev;
+            workout_codec_decode(f.data(), f.size(), &ev);
+            sink = sink + ev.lap;
+        }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    double frame_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                      ((double)BENCH_ROUNDS * frames.size());
+
+    printf("bench      json %5.1f B/msg %7.1f ns/msg  bin1 %5.1f B/msg %7.1f ns/msg\n",
+           (double)json_bytes / msgs.size(), ns[1],
+           (double)frame_bytes / frames.size(), frame_ns);
+
+    workout_hr_done_t hr = { 3, 152, 148, 157, 152, 152, 25, 1, 96, 10000, true };
+    uint8_t frame[WORKOUT_CODEC_MAX_FRAME];
+    char json[200];
+    printf("bench      hr_done json %d B  compact %d B  bin1 %zu B\n",
+           workout_codec_hr_done_json(&hr, json, sizeof(json)),
+           workout_codec_hr_done_compact_json(&hr, json, sizeof(json)),
+           workout_codec_encode_hr_done(&hr, frame, sizeof(frame)));
+
+    bench_peers(msgs);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: workout_fuzz [--iters N] [--seed N] [--bench]\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iters = DEFAULT_ITERS;
+    uint32_t seed = 1;
+    bool do_bench = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--iters") && i + 1 < argc) {
+            iters = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = (uint32_t)atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--bench")) {
+            do_bench = true;
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    if (do_bench) {
+        bench();
+        return 0;
+    }
+
+    rng_state = seed ? seed : 1;
+    int failures = check_cases();
+    failures += check_roundtrip(iters);
+    failures += check_mutate(iters);
+    failures += check_frames(iters);
+    failures += check_frame_mutate(iters);
+    failures += check_frag(iters);
+    failures += check_peers(iters);
+    return failures ? 1 : 0;
+}